@@ -10,6 +10,7 @@ class MqttModule extends BaseSettingsModule {
     this.user = document.getElementById("mqtt-user");
     this.password = document.getElementById("mqtt-password");
     this.toggleBtn = document.getElementById("toggle-mqtt-password");
+    this.jsonToggle = document.getElementById("mqtt-json-toggle");
 
     this.mqttTestBtn = document.getElementById("test-mqtt-btn");
     this.mqttTestLoader = document.getElementById("mqtt-test-loader");
@@ -85,6 +86,7 @@ class MqttModule extends BaseSettingsModule {
       port: portNum.toString(),
       user,
       password,
+      json: (this.jsonToggle?.checked || false).toString(),
     };
   }
 
@@ -174,6 +176,8 @@ class MqttModule extends BaseSettingsModule {
         if (this.port) this.port.value = parseInt(load_data.port) || 0;
         if (this.user) this.user.value = load_data.user || "";
         if (this.password) this.password.value = load_data.password || "";
+        if (this.jsonToggle)
+          this.jsonToggle.checked = this.parseBoolean(load_data.json);
       }
     },
     error_mqtt: (data) => {
@@ -23,10 +23,12 @@ let pongTimeout = null;
 function initWebSocket() {
   const protocol = window.location.protocol === "https:" ? "wss:" : "ws:";
   const host = window.location.hostname || "192.168.4.1";
-  const port = window.location.port ? `:${window.location.port}` : ":8810";
-  const url = `${protocol}//${host}${port}`;
+  const port = window.location.port ? `:${window.location.port}` : "";
+  const query = window.SettingsCore ? window.SettingsCore.getEncodingQuery() : "";
+  const url = `${protocol}//${host}${port}/ws${query}`; // WebSocket на том же сервере, что и страница
   try {
     window.webSocket = new WebSocket(url);
+    window.webSocket.binaryType = "arraybuffer"; // Бинарные кадры приходят в CBOR
     window.webSocket.onopen = () => {
       reconnectAttempts = 0;
       console.log("WebSocket connected");
@@ -34,7 +36,7 @@ function initWebSocket() {
     };
     window.webSocket.onmessage = (event) => {
       try {
-        const data = JSON.parse(event.data);
+        const data = window.SettingsCore.decodeMessage(event.data);
 
         // Обработка pong
         if (data.type === "response" && data.target === "websocket" && data.status === "pong") {
@@ -45,6 +47,7 @@ function initWebSocket() {
 
         if (data.type === "event" && data.target === "system" && data.status === "ws_ready") {
           window.SettingsCore.callAllModulesAndSendWS("onAppStart");
+          sendPageTiming();
           return;
         }
 
@@ -125,7 +128,42 @@ function sendWS(data) {
   }
 }
 
+// Время холодной загрузки портала: отправляется устройству один раз и пишется в его лог
+let pageTimingSent = false;
+
+function sendPageTiming() {
+  if (pageTimingSent || !window.performance || !performance.getEntriesByType) return;
+
+  const nav = performance.getEntriesByType("navigation")[0];
+  if (!nav || !nav.loadEventEnd) {
+    window.addEventListener("load", () => setTimeout(sendPageTiming, 0), { once: true });
+    return;
+  }
+
+  pageTimingSent = true;
+  const timing = {
+    ttfb: Math.round(nav.responseStart),
+    dom_ready: Math.round(nav.domContentLoadedEventEnd),
+    load: Math.round(nav.loadEventEnd),
+    requests: performance.getEntriesByType("resource").length + 1,
+  };
+  console.log("Page timing:", timing);
+  sendWS({ type: "request", target: "websocket", action: "page_timing", data: timing });
+}
+
 function routeMessage(data) {
+  // Медленные действия выполняются на устройстве в фоне: сначала приходит
+  // подтверждение с номером задачи, затем результат событием с тем же номером
+  if (data.status === "job_accepted") {
+    console.log(`Job ${data.data?.job} accepted: ${data.target}/${data.data?.action}`);
+    return;
+  }
+
+  if (data.type === "event" && data.job !== undefined) {
+    handleResponse(data);
+    return;
+  }
+
   const handler = handlers[data.type] || handlers.default;
   handler(data);
 }
@@ -1,8 +1,165 @@
+// Декодер CBOR для бинарных сообщений устройства (та же схема, что и в JSON).
+// Поддерживает то, что отправляет устройство: целые, строки, массивы и объекты
+// (в том числе неопределённой длины), true/false/null и числа с плавающей точкой.
+class CborDecoder {
+  constructor() {
+    this.textDecoder = new TextDecoder();
+    this.view = null;
+    this.bytes = null;
+    this.pos = 0;
+  }
+
+  decode(buffer) {
+    this.view = new DataView(buffer);
+    this.bytes = new Uint8Array(buffer);
+    this.pos = 0;
+    const value = this.readItem();
+    this.view = null;
+    this.bytes = null;
+    return value;
+  }
+
+  readArgument(info) {
+    const view = this.view;
+    let value;
+    if (info < 24) return info;
+    switch (info) {
+      case 24:
+        value = view.getUint8(this.pos);
+        this.pos += 1;
+        return value;
+      case 25:
+        value = view.getUint16(this.pos);
+        this.pos += 2;
+        return value;
+      case 26:
+        value = view.getUint32(this.pos);
+        this.pos += 4;
+        return value;
+      case 27:
+        value = view.getUint32(this.pos) * 0x100000000 + view.getUint32(this.pos + 4);
+        this.pos += 8;
+        return value;
+      case 31:
+        return -1; // Неопределённая длина
+      default:
+        throw new Error(`CBOR: неверный аргумент ${info}`);
+    }
+  }
+
+  readItem() {
+    const initial = this.view.getUint8(this.pos++);
+    const major = initial >> 5;
+    const info = initial & 0x1f;
+
+    if (major === 7) return this.readSimple(info);
+
+    const arg = this.readArgument(info);
+    switch (major) {
+      case 0:
+        return arg;
+      case 1:
+        return -1 - arg;
+      case 2:
+      case 3: {
+        if (arg < 0) throw new Error("CBOR: строки неопределённой длины не поддерживаются");
+        const chunk = this.bytes.subarray(this.pos, this.pos + arg);
+        this.pos += arg;
+        return major === 3 ? this.textDecoder.decode(chunk) : chunk.slice();
+      }
+      case 4: {
+        const array = [];
+        if (arg < 0) {
+          while (!this.readBreak()) array.push(this.readItem());
+        } else {
+          for (let i = 0; i < arg; i++) array.push(this.readItem());
+        }
+        return array;
+      }
+      case 5: {
+        const object = {};
+        if (arg < 0) {
+          while (!this.readBreak()) {
+            const key = this.readItem();
+            object[key] = this.readItem();
+          }
+        } else {
+          for (let i = 0; i < arg; i++) {
+            const key = this.readItem();
+            object[key] = this.readItem();
+          }
+        }
+        return object;
+      }
+      case 6:
+        return this.readItem(); // Тег игнорируем, возвращаем значение
+      default:
+        throw new Error(`CBOR: неизвестный тип ${major}`);
+    }
+  }
+
+  readBreak() {
+    if (this.bytes[this.pos] === 0xff) {
+      this.pos++;
+      return true;
+    }
+    return false;
+  }
+
+  readSimple(info) {
+    const view = this.view;
+    let value;
+    switch (info) {
+      case 20:
+        return false;
+      case 21:
+        return true;
+      case 22:
+      case 23:
+        return null;
+      case 25: {
+        const half = view.getUint16(this.pos);
+        this.pos += 2;
+        const exp = (half >> 10) & 0x1f;
+        const mant = half & 0x3ff;
+        const sign = half & 0x8000 ? -1 : 1;
+        if (exp === 0) return sign * mant * Math.pow(2, -24);
+        if (exp === 31) return mant ? NaN : sign * Infinity;
+        return sign * (1 + mant / 1024) * Math.pow(2, exp - 15);
+      }
+      case 26:
+        value = view.getFloat32(this.pos);
+        this.pos += 4;
+        return value;
+      case 27:
+        value = view.getFloat64(this.pos);
+        this.pos += 8;
+        return value;
+      default:
+        throw new Error(`CBOR: неизвестное простое значение ${info}`);
+    }
+  }
+}
+
 class SettingsCore {
   constructor() {
     this.modules = [];
     this.isInitialized = false;
     this.moduleRoutes = new Map(); // Карта маршрутов: cmd -> module
+    this.cbor =
+      typeof TextDecoder === "function" ? new CborDecoder() : null; // Без TextDecoder остаёмся на JSON
+  }
+
+  // Параметр подключения WebSocket: просим устройство отвечать в CBOR
+  getEncodingQuery() {
+    return this.cbor ? "?enc=cbor" : "";
+  }
+
+  // Текстовые кадры - JSON, бинарные - CBOR
+  decodeMessage(raw) {
+    if (typeof raw === "string") return JSON.parse(raw);
+    if (!this.cbor) throw new Error("CBOR не поддерживается");
+    return this.cbor.decode(raw);
   }
 
   registerModule(moduleInstance) {
@@ -67,6 +67,7 @@ class WifiModule extends BaseSettingsModule {
     this.ethernet_status = document.getElementById("ethernet-status");
 
     this.lastScanResults = [];
+    this.scanNetworks = [];
     this.lastManualSsid = "";
 
     this.showTimeoutTimer = null;
@@ -310,11 +311,18 @@ class WifiModule extends BaseSettingsModule {
 
   responseHandlers = {
     ap_scan_result: (data) => {
-      clearTimeout(this.showTimeoutTimer);
-      const networks = data.data?.networks || null;
-      if (networks) {
-        this.displayScanResults(networks);
+      const page = data.data || {};
+      const networks = page.networks || [];
+      // Страницы приходят по порядку, первая начинает новый список
+      this.scanNetworks = page.offset ? this.scanNetworks.concat(networks) : networks;
+      this.displayScanResults(this.scanNetworks);
+
+      if (page.next !== undefined) {
+        if (this.requestScanPage(page.next)) return;
+        this.wifiFSM.transition("ap_scan_error");
+        return;
       }
+      clearTimeout(this.showTimeoutTimer);
       this.wifiFSM.transition("idle");
     },
     ap_config: (data) => {
@@ -350,11 +358,7 @@ class WifiModule extends BaseSettingsModule {
     ap_scan_success: (data) => {
       const ap_count = data.data?.count || 0;
       if (ap_count > 0) {
-        if (!this.webSocketSend({
-          type: "request",
-          target: "wifi",
-          action: "ap_scan_result",
-        })) {
+        if (!this.requestScanPage(0)) {
           this.wifiFSM.transition("ap_scan_error");
         }
       } else {
@@ -491,6 +495,15 @@ class WifiModule extends BaseSettingsModule {
     return input;
   }
 
+  requestScanPage(offset) {
+    return this.webSocketSend({
+      type: "request",
+      target: "wifi",
+      action: "ap_scan_result",
+      data: { offset },
+    });
+  }
+
   displayScanResults(networks) {
     const uniqueNetworks = [
       ...new Map(networks.map((net) => [net.ssid, net])).values(),
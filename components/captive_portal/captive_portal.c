@@ -1,10 +1,14 @@
 #include "nvs_settings.h"
+#include "settings.h"
 #include "wifi.h"
 #include "dwnvs.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "server/server.h"
+#include "server/modules/modules.h"
 #include "esp_err.h"
+#include "esp_system.h"
+#include "freertos/task.h"
 
 #define PORTAL_LOGOUT (BIT1)
 
@@ -90,19 +94,18 @@ static void portal_server_start(void)
     esp_netif_t *ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
 
     captive_portal_dns_server_start(ap_netif);
-    captive_portal_http_server_start(ap_netif);
-    captive_portal_ws_server_start(ap_netif);
+    captive_portal_http_server_start(ap_netif); // Вместе с WebSocket
+    dw_set_internet_callback(wifi_module_internet_changed);
+
+    ESP_LOGI(TAG, "Portal servers started: tasks=%u, free heap=%lu, min free heap=%lu",
+             (unsigned)uxTaskGetNumberOfTasks(), esp_get_free_heap_size(), esp_get_minimum_free_heap_size());
 }
 
 //=================================================================
 void portal_start_with_sta_attempt(const char *ssid, const char *password, bool start_ap, portal_sta_connect_attempt_cb_t try_sta_connect)
 {
-    char standalone[8] = {0};
-    size_t str_size = sizeof(standalone);
-    esp_err_t err = nvs_load_data("wifi", "standalone", standalone, &str_size, NVS_TYPE_STR);
-
     bool ap_mode_active = false;
-    bool standalone_mode = (err == ESP_OK && strcmp(standalone, "true") == 0) ? true : false;
+    bool standalone_mode = settings_get_bool(SETTING_WIFI_STANDALONE);
 
     if (!start_ap && standalone_mode)
         return;
@@ -260,8 +263,7 @@ void portal_start_with_sta_attempt(const char *ssid, const char *password, bool
             EventBits_t bits = xEventGroupWaitBits(portal_status, PORTAL_LOGOUT, true, pdTRUE, 0);
             if (bits & PORTAL_LOGOUT)
             {
-                err = nvs_load_data("wifi", "standalone", standalone, &str_size, NVS_TYPE_STR);
-                standalone_mode = (err == ESP_OK && strcmp(standalone, "true") == 0) ? true : false;
+                standalone_mode = settings_get_bool(SETTING_WIFI_STANDALONE);
                 
                 if(!standalone_mode && try_sta_connect != NULL)
                 {
@@ -283,13 +285,11 @@ void portal_stop(bool stop_sta)
     captive_portal_dns_server_stop();
     ESP_LOGI(TAG, "DNS server stopped.");
 
-    ESP_LOGI(TAG, "Stopping HTTP server...");
-    captive_portal_http_server_stop();
-    ESP_LOGI(TAG, "HTTP server stopped.");
+    dw_set_internet_callback(NULL);
 
-    ESP_LOGI(TAG, "Stopping WebSocket server...");
-    captive_portal_ws_server_stop();
-    ESP_LOGI(TAG, "WebSocket server stopped.");
+    ESP_LOGI(TAG, "Stopping HTTP and WebSocket server...");
+    captive_portal_http_server_stop();
+    ESP_LOGI(TAG, "HTTP and WebSocket server stopped.");
 
     if (stop_sta)
     {
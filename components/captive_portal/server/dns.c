@@ -7,12 +7,37 @@
 #include "esp_http_server.h"
 #include "socket.h"
 #include "esp_netif.h"
+#include "server/server.h"
 
 #define DNS_PORT 53
 #define DNS_MAX_LEN 512
 #define DNS_TASK_STACK_SIZE 4096
 #define DNS_TASK_PRIORITY 5
 
+#define DNS_ANSWER_TTL 300  // TTL ответа A
+#define DNS_NEGATIVE_TTL 60 // Сколько клиент может помнить, что AAAA/HTTPS нет
+#define DNS_RECV_TIMEOUT_MS 1000 // Запасной выход из recvfrom, если датаграмма остановки потеряна
+#define DNS_STOP_TIMEOUT_MS 3000
+
+#define DNS_HEADER_LEN 12
+#define DNS_NAME_MAX 255
+
+// Флаги заголовка
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_AA 0x0400
+#define DNS_FLAG_RD 0x0100
+#define DNS_FLAG_RA 0x0080
+#define DNS_OPCODE_MASK 0x7800
+
+#define DNS_RCODE_FORMERR 1
+#define DNS_RCODE_NOTIMP 4
+
+// Типы записей
+#define DNS_TYPE_A 1
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
 static const char *TAG = "dns_server";
 
 typedef struct __attribute__((packed))
@@ -25,51 +50,194 @@ typedef struct __attribute__((packed))
     uint16_t arcount;
 } dns_header_t;
 
+// Счётчики ответов, выводятся при остановке
+typedef struct
+{
+    uint32_t answered;
+    uint32_t nodata;
+    uint32_t errors;
+} dns_stats_t;
+
 static TaskHandle_t dns_task_handler = NULL;
 static esp_netif_t *dns_netif = NULL;
 static EventGroupHandle_t dns_event_group = NULL;
 static const int DNS_STOP_BIT = BIT0;
+static const int DNS_STOPPED_BIT = BIT1;
+static dns_stats_t dns_stats;
+
+//=================================================================
+static uint8_t *dns_put16(uint8_t *p, uint16_t value)
+{
+    *p++ = value >> 8;
+    *p++ = value & 0xFF;
+    return p;
+}
+
+//=================================================================
+static uint8_t *dns_put32(uint8_t *p, uint32_t value)
+{
+    p = dns_put16(p, value >> 16);
+    return dns_put16(p, value & 0xFFFF);
+}
+
+//=================================================================
+// Длина имени в вопросе (вместе с завершающим нулём) или 0, если имя некорректно
+static size_t dns_question_name_len(const uint8_t *name, size_t avail)
+{
+    size_t pos = 0;
+
+    while (pos < avail) {
+        uint8_t label = name[pos];
+
+        if (label == 0)
+            return (pos + 1 <= DNS_NAME_MAX) ? pos + 1 : 0;
+
+        // Сжатие (0xC0) и расширенные метки в вопросе не встречаются
+        if (label > 63)
+            return 0;
+
+        pos += label + 1;
+    }
+
+    return 0;
+}
+
+//=================================================================
+// Заголовок ответа с кодом ошибки, без вопросов
+static int dns_error_response(const dns_header_t *query, uint8_t *resp, uint16_t rcode)
+{
+    uint16_t flags = ntohs(query->flags);
+
+    dns_header_t *header = (dns_header_t *)resp;
+    memset(header, 0, sizeof(*header));
+    header->id = query->id;
+    header->flags = htons(DNS_FLAG_QR | (flags & (DNS_OPCODE_MASK | DNS_FLAG_RD)) | rcode);
+
+    dns_stats.errors++;
+    return DNS_HEADER_LEN;
+}
+
+//=================================================================
+/**
+ * Собирает ответ на запрос. Любое имя разрешается в адрес портала (A),
+ * на остальные типы (AAAA, HTTPS, SVCB...) - NODATA с SOA, чтобы клиент
+ * закэшировал отсутствие записи и не повторял запрос.
+ *
+ * @return Длина ответа или 0, если запрос нужно молча отбросить
+ */
+static int dns_build_response(const uint8_t *query, size_t len, uint8_t *resp, size_t resp_size, uint32_t self_ip)
+{
+    if (len < DNS_HEADER_LEN || resp_size < DNS_MAX_LEN)
+        return 0;
+
+    const dns_header_t *qheader = (const dns_header_t *)query;
+    uint16_t flags = ntohs(qheader->flags);
+
+    // Ответы и мусор не обрабатываем
+    if (flags & DNS_FLAG_QR)
+        return 0;
+
+    if (flags & DNS_OPCODE_MASK)
+        return dns_error_response(qheader, resp, DNS_RCODE_NOTIMP);
+
+    if (ntohs(qheader->qdcount) != 1)
+        return dns_error_response(qheader, resp, DNS_RCODE_FORMERR);
+
+    const uint8_t *question = query + DNS_HEADER_LEN;
+    size_t avail = len - DNS_HEADER_LEN;
+    size_t name_len = dns_question_name_len(question, avail);
+    if (name_len == 0 || name_len + 4 > avail)
+        return dns_error_response(qheader, resp, DNS_RCODE_FORMERR);
+
+    uint16_t qtype = (question[name_len] << 8) | question[name_len + 1];
+    uint16_t qclass = (question[name_len + 2] << 8) | question[name_len + 3];
+    size_t question_len = name_len + 4;
+
+    // Вопрос копируется без дополнительных записей (EDNS OPT и т.п.)
+    dns_header_t *header = (dns_header_t *)resp;
+    memset(header, 0, sizeof(*header));
+    header->id = qheader->id;
+    header->flags = htons(DNS_FLAG_QR | DNS_FLAG_AA | DNS_FLAG_RA | (flags & DNS_FLAG_RD));
+    header->qdcount = htons(1);
+
+    memcpy(resp + DNS_HEADER_LEN, question, question_len);
+    uint8_t *p = resp + DNS_HEADER_LEN + question_len;
+
+    // Все имена в ответе - ссылка на имя из вопроса
+    const uint16_t name_ptr = 0xC000 | DNS_HEADER_LEN;
+
+    if (qclass == DNS_CLASS_IN && (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY)) {
+        p = dns_put16(p, name_ptr);
+        p = dns_put16(p, DNS_TYPE_A);
+        p = dns_put16(p, DNS_CLASS_IN);
+        p = dns_put32(p, DNS_ANSWER_TTL);
+        p = dns_put16(p, 4);
+        memcpy(p, &self_ip, 4); // Уже в сетевом порядке
+        p += 4;
+
+        header->ancount = htons(1);
+        dns_stats.answered++;
+    } else {
+        // NODATA: NOERROR без ответов, SOA в authority задаёт время негативного кэша
+        p = dns_put16(p, name_ptr);
+        p = dns_put16(p, DNS_TYPE_SOA);
+        p = dns_put16(p, DNS_CLASS_IN);
+        p = dns_put32(p, DNS_NEGATIVE_TTL);
+        p = dns_put16(p, 2 + 2 + 5 * 4);
+        p = dns_put16(p, name_ptr); // MNAME
+        p = dns_put16(p, name_ptr); // RNAME
+        p = dns_put32(p, 1);        // SERIAL
+        p = dns_put32(p, 3600);     // REFRESH
+        p = dns_put32(p, 600);      // RETRY
+        p = dns_put32(p, 86400);    // EXPIRE
+        p = dns_put32(p, DNS_NEGATIVE_TTL);
+
+        header->nscount = htons(1);
+        dns_stats.nodata++;
+    }
+
+    return p - resp;
+}
 
 //=================================================================
 static void dns_server_task(void *pvParameters)
 {
-    char rx_buffer[DNS_MAX_LEN];
-    char tx_buffer[DNS_MAX_LEN];
+    uint8_t rx_buffer[DNS_MAX_LEN];
+    uint8_t tx_buffer[DNS_MAX_LEN];
     struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    socklen_t client_len;
     int len;
     esp_netif_t *netif = (esp_netif_t *)pvParameters;
-
-    if (netif == NULL) {
-        ESP_LOGE(TAG, "Invalid netif provided");
-        vTaskDelete(NULL);
-        return;
-    }
+    int sock = -1;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
 
     // Получить IP адрес интерфейса
     esp_netif_ip_info_t ip_info;
     esp_err_t err = esp_netif_get_ip_info(netif, &ip_info);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get IP info: %s", esp_err_to_name(err));
-        vTaskDelete(NULL);
-        return;
+        goto cleanup;
     }
-    
+
     uint32_t self_ip = ip_info.ip.addr;
     char ip_str[16];
     esp_ip4addr_ntoa(&ip_info.ip, ip_str, sizeof(ip_str));
-    ESP_LOGI(TAG, "DNS server started on %s:%d", ip_str, DNS_PORT);
 
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (sock < 0) {
         ESP_LOGE(TAG, "Failed to create socket");
-        vTaskDelete(NULL);
-        return;
+        goto cleanup;
     }
 
     int opt = 1;
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
+    struct timeval timeout = {
+        .tv_sec = DNS_RECV_TIMEOUT_MS / 1000,
+        .tv_usec = (DNS_RECV_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -77,107 +245,55 @@ static void dns_server_task(void *pvParameters)
 
     if (bind(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0) {
         ESP_LOGE(TAG, "Failed to bind socket");
-        close(sock);
-        vTaskDelete(NULL);
-        return;
+        goto cleanup;
     }
 
-    // Установить таймаут для recvfrom для возможности прерывания
-    struct timeval timeout;
-    timeout.tv_sec = 1;
-    timeout.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ESP_LOGI(TAG, "DNS server started on %s:%d", ip_str, DNS_PORT);
+    memset(&dns_stats, 0, sizeof(dns_stats));
 
+    // Задача спит в recvfrom до прихода запроса. Для остановки
+    // captive_portal_dns_server_stop() присылает пустую датаграмму на loopback,
+    // если она потеряется - флаг проверяется по таймауту приема.
+    // Задача, которую stop() перестал ждать, завершается и после нового start():
+    // dns_task_handler указывает уже не на неё
     while (1) {
-        // Проверить, нужно ли остановить сервер
-        EventBits_t bits = xEventGroupGetBits(dns_event_group);
-        if (bits & DNS_STOP_BIT) {
+        client_len = sizeof(client_addr);
+        len = recvfrom(sock, rx_buffer, sizeof(rx_buffer), 0,
+                       (struct sockaddr *)&client_addr, &client_len);
+
+        if ((xEventGroupGetBits(dns_event_group) & DNS_STOP_BIT) || dns_task_handler != self) {
             break;
         }
 
-        len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0,
-                       (struct sockaddr *)&client_addr, &client_len);
-        
-        if (len > 0) {
-            if (len >= 12) {
-                // Разобрать DNS заголовок
-                dns_header_t *header = (dns_header_t *)rx_buffer;
-                uint16_t dns_id = ntohs(header->id);
-                uint16_t flags = ntohs(header->flags);
-                
-                // Проверить, что это запрос (не ответ)
-                if ((flags & 0x8000) == 0) {
-                    ESP_LOGD(TAG, "DNS query received, ID: 0x%04X", dns_id);
-
-                    // Подготовить ответ
-                    memset(tx_buffer, 0, sizeof(tx_buffer));
-                    dns_header_t *resp_header = (dns_header_t *)tx_buffer;
-                    
-                    resp_header->id = htons(dns_id);
-                    resp_header->flags = htons(0x8180); // Ответ, авторитетный
-                    resp_header->qdcount = htons(1);    // Один вопрос
-                    resp_header->ancount = htons(1);    // Один ответ
-                    resp_header->nscount = htons(0);
-                    resp_header->arcount = htons(0);
-
-                    // Скопировать вопрос
-                    int question_len = len - sizeof(dns_header_t);
-                    if (question_len > 0 && question_len < (DNS_MAX_LEN - sizeof(dns_header_t) - 16)) {
-                        memcpy(&tx_buffer[sizeof(dns_header_t)], 
-                               &rx_buffer[sizeof(dns_header_t)], 
-                               question_len);
-
-                        // Добавить ответ (A запись)
-                        int answer_offset = sizeof(dns_header_t) + question_len;
-                        
-                        // Указатель на имя в вопросе
-                        tx_buffer[answer_offset++] = 0xC0;
-                        tx_buffer[answer_offset++] = 0x0C;
-                        
-                        // Тип записи (A)
-                        tx_buffer[answer_offset++] = 0x00;
-                        tx_buffer[answer_offset++] = 0x01;
-                        
-                        // Класс (IN)
-                        tx_buffer[answer_offset++] = 0x00;
-                        tx_buffer[answer_offset++] = 0x01;
-                        
-                        // TTL (300 секунд)
-                        tx_buffer[answer_offset++] = 0x00;
-                        tx_buffer[answer_offset++] = 0x00;
-                        tx_buffer[answer_offset++] = 0x01;
-                        tx_buffer[answer_offset++] = 0x2C;
-                        
-                        // Длина данных (4 байта для IPv4)
-                        tx_buffer[answer_offset++] = 0x00;
-                        tx_buffer[answer_offset++] = 0x04;
-                        
-                        // IP адрес в формате big-endian
-                        tx_buffer[answer_offset++] = (self_ip >> 0) & 0xFF;
-                        tx_buffer[answer_offset++] = (self_ip >> 8) & 0xFF;
-                        tx_buffer[answer_offset++] = (self_ip >> 16) & 0xFF;
-                        tx_buffer[answer_offset++] = (self_ip >> 24) & 0xFF;
-
-                        int response_len = answer_offset;
-
-                        // Отправить ответ
-                        sendto(sock, tx_buffer, response_len, 0,
-                               (struct sockaddr *)&client_addr, client_len);
-                        
-                        ESP_LOGD(TAG, "DNS response sent to %s", inet_ntoa(client_addr.sin_addr));
-                    }
-                }
-            }
-        } else if (len < 0) {
-            // Проверить errno для таймаута
+        if (len < 0) {
             if (errno != EAGAIN && errno != EWOULDBLOCK) {
                 ESP_LOGW(TAG, "recvfrom error: %d", errno);
+                vTaskDelay(pdMS_TO_TICKS(10));
             }
+            continue;
+        }
+
+        int response_len = dns_build_response(rx_buffer, len, tx_buffer, sizeof(tx_buffer), self_ip);
+        if (response_len > 0) {
+            sendto(sock, tx_buffer, response_len, 0,
+                   (struct sockaddr *)&client_addr, client_len);
+            ESP_LOGD(TAG, "DNS response sent to %s", inet_ntoa(client_addr.sin_addr));
         }
     }
 
-    close(sock);
+    ESP_LOGI(TAG, "DNS stats: answered=%lu nodata=%lu errors=%lu",
+             dns_stats.answered, dns_stats.nodata, dns_stats.errors);
+
+cleanup:
+    if (sock >= 0) {
+        close(sock);
+    }
     ESP_LOGI(TAG, "DNS server stopped");
+
+    if (dns_task_handler == self) {
+        dns_task_handler = NULL;
+        xEventGroupSetBits(dns_event_group, DNS_STOPPED_BIT);
+    }
     vTaskDelete(NULL);
 }
 
@@ -202,16 +318,16 @@ esp_err_t captive_portal_dns_server_start(esp_netif_t *netif)
             return ESP_FAIL;
         }
     }
-    
+
     // Сбросить биты
-    xEventGroupClearBits(dns_event_group, DNS_STOP_BIT);
+    xEventGroupClearBits(dns_event_group, DNS_STOP_BIT | DNS_STOPPED_BIT);
 
     dns_netif = netif;
-    
-    BaseType_t result = xTaskCreate(dns_server_task, "dns_server", 
-                                   DNS_TASK_STACK_SIZE, netif, 
+
+    BaseType_t result = xTaskCreate(dns_server_task, "dns_server",
+                                   DNS_TASK_STACK_SIZE, netif,
                                    DNS_TASK_PRIORITY, &dns_task_handler);
-    
+
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create DNS server task");
         dns_task_handler = NULL;
@@ -222,6 +338,28 @@ esp_err_t captive_portal_dns_server_start(esp_netif_t *netif)
     return ESP_OK;
 }
 
+//=================================================================
+// Будит задачу, заблокированную в recvfrom
+static void dns_server_wakeup(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGW(TAG, "Wakeup socket failed: %d, waiting for receive timeout", errno);
+        return;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(DNS_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    if (sendto(sock, "", 0, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGW(TAG, "Wakeup send failed: %d, waiting for receive timeout", errno);
+    }
+    close(sock);
+}
+
 //=================================================================
 esp_err_t captive_portal_dns_server_stop(void)
 {
@@ -232,23 +370,21 @@ esp_err_t captive_portal_dns_server_stop(void)
 
     ESP_LOGI(TAG, "Stopping DNS server...");
 
-    // Установить флаг остановки
-    if (dns_event_group != NULL) {
-        xEventGroupSetBits(dns_event_group, DNS_STOP_BIT);
-    }
-
-    // Подождать немного для корректной остановки
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Установить флаг остановки и разбудить задачу: она сама закроет сокет
+    xEventGroupSetBits(dns_event_group, DNS_STOP_BIT);
+    dns_server_wakeup();
 
-    // Удалить задачу
-    if (dns_task_handler != NULL) {
-        vTaskDelete(dns_task_handler);
+    EventBits_t bits = xEventGroupWaitBits(dns_event_group, DNS_STOPPED_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(DNS_STOP_TIMEOUT_MS));
+    if (!(bits & DNS_STOPPED_BIT)) {
+        // Задача завершится сама при следующем пробуждении; следующий start() не должен её ждать
+        ESP_LOGE(TAG, "DNS task did not stop in %d ms, detaching it", DNS_STOP_TIMEOUT_MS);
         dns_task_handler = NULL;
+        dns_netif = NULL;
+        return ESP_ERR_TIMEOUT;
     }
 
     dns_netif = NULL;
-    
-    ESP_LOGI(TAG, "DNS server stopped");
     return ESP_OK;
 }
 
@@ -262,4 +398,4 @@ esp_err_t captive_portal_dns_server_is_running(void)
 esp_netif_t* captive_portal_dns_get_netif(void)
 {
     return dns_netif;
-}
\ No newline at end of file
+}
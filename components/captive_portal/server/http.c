@@ -1,162 +1,131 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "server/server.h"
+#include "server/http_assets.h"
 
-static httpd_handle_t http_server = NULL;
-
-// Основные файлы
-extern const unsigned char index_html_start[] asm("_binary_index_html_start");
-extern const unsigned char index_html_end[] asm("_binary_index_html_end");
-
-extern const unsigned char styles_css_start[] asm("_binary_styles_css_start");
-extern const unsigned char styles_css_end[] asm("_binary_styles_css_end");
-
-extern const unsigned char script_js_start[] asm("_binary_script_js_start");
-extern const unsigned char script_js_end[] asm("_binary_script_js_end");
-
-// Модульные JS-файлы
-extern const unsigned char settings_core_js_start[] asm("_binary_settings_core_js_start");
-extern const unsigned char settings_core_js_end[] asm("_binary_settings_core_js_end");
+// Сокеты сервера: WebSocket-клиенты и короткие запросы ресурсов (CONFIG_LWIP_MAX_SOCKETS = 32)
+#define HTTP_MAX_SOCKETS 12
 
-extern const unsigned char base_module_js_start[] asm("_binary_base_module_js_start");
-extern const unsigned char base_module_js_end[] asm("_binary_base_module_js_end");
-
-extern const unsigned char wifi_module_js_start[] asm("_binary_wifi_module_js_start");
-extern const unsigned char wifi_module_js_end[] asm("_binary_wifi_module_js_end");
-
-extern const unsigned char control_module_js_start[] asm("_binary_control_module_js_start");
-extern const unsigned char control_module_js_end[] asm("_binary_control_module_js_end");
+static httpd_handle_t http_server = NULL;
+static const http_asset_t *http_index_asset = NULL;
 
-extern const unsigned char update_module_js_start[] asm("_binary_update_module_js_start");
-extern const unsigned char update_module_js_end[] asm("_binary_update_module_js_end");
+//=================================================================
+// Поиск ресурса по совершенному хешу пути
+const http_asset_t *http_asset_find(const char *path, size_t len)
+{
+    uint32_t hash = http_assets_seed;
 
-extern const unsigned char device_module_js_start[] asm("_binary_device_module_js_start");
-extern const unsigned char device_module_js_end[] asm("_binary_device_module_js_end");
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)path[i];
+        hash *= 16777619u;
+    }
 
-extern const unsigned char network_module_js_start[] asm("_binary_network_module_js_start");
-extern const unsigned char network_module_js_end[] asm("_binary_network_module_js_end");
+    uint8_t index = http_assets_slots[hash & http_assets_slot_mask];
+    if (index >= http_assets_count)
+        return NULL;
 
-extern const unsigned char apoint_module_js_start[] asm("_binary_apoint_module_js_start");
-extern const unsigned char apoint_module_js_end[] asm("_binary_apoint_module_js_end");
+    const http_asset_t *asset = &http_assets[index];
+    if (strlen(asset->path) != len || memcmp(asset->path, path, len) != 0)
+        return NULL;
 
-extern const unsigned char mqtt_module_js_start[] asm("_binary_mqtt_module_js_start");
-extern const unsigned char mqtt_module_js_end[] asm("_binary_mqtt_module_js_end");
+    return asset;
+}
 
-extern const unsigned char modules_registry_js_start[] asm("_binary_modules_registry_js_start");
-extern const unsigned char modules_registry_js_end[] asm("_binary_modules_registry_js_end");
+//=================================================================
+// Совпадает ли If-None-Match запроса с ETag ресурса
+static bool http_etag_matches(httpd_req_t *req, const char *etag)
+{
+    char value[96];
 
-extern const unsigned char ledstrip_module_js_start[] asm("_binary_ledstrip_module_js_start");
-extern const unsigned char ledstrip_module_js_end[] asm("_binary_ledstrip_module_js_end");
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK)
+        return false;
 
-extern const unsigned char loader_js_start[] asm("_binary_loader_js_start");
-extern const unsigned char loader_js_end[] asm("_binary_loader_js_end");
+    return strstr(value, etag) != NULL || strcmp(value, "*") == 0;
+}
 
 //=================================================================
-// Обработчики основных файлов
-static esp_err_t captive_portal_handler(httpd_req_t *req)
+// Допускает ли Accept-Encoding запроса кодировку ресурса.
+// Без заголовка подходит любая кодировка; "gzip;q=0" - явный отказ
+static bool http_encoding_accepted(httpd_req_t *req, const char *encoding)
 {
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char *)index_html_start, index_html_end - index_html_start);
-    return ESP_OK;
-}
+    char value[96];
 
-static esp_err_t style_css_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "text/css");
-    httpd_resp_send(req, (const char *)styles_css_start, styles_css_end - styles_css_start);
-    return ESP_OK;
-}
+    // Слишком длинный заголовок разбирается по обрезанной части
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC)
+        return true;
 
-static esp_err_t script_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)script_js_start, script_js_end - script_js_start);
-    return ESP_OK;
-}
+    size_t encoding_len = strlen(encoding);
+    char *save = NULL;
 
-// Обработчики модульных JS-файлов
-static esp_err_t modules_registry_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)modules_registry_js_start, modules_registry_js_end - modules_registry_js_start);
-    return ESP_OK;
-}
-static esp_err_t settings_core_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)settings_core_js_start, settings_core_js_end - settings_core_js_start);
-    return ESP_OK;
-}
+    for (char *item = strtok_r(value, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        item += strspn(item, " \t");
+        size_t name_len = strcspn(item, " \t;");
 
-static esp_err_t loader_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)loader_js_start, loader_js_end - loader_js_start);
-    return ESP_OK;
-}
+        bool matches = (name_len == encoding_len && strncasecmp(item, encoding, name_len) == 0) ||
+                       (name_len == 1 && item[0] == '*');
+        if (!matches)
+            continue;
 
-static esp_err_t base_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)base_module_js_start, base_module_js_end - base_module_js_start);
-    return ESP_OK;
-}
+        const char *q = strstr(item + name_len, "q=");
+        return q == NULL || strtof(q + 2, NULL) > 0.0f;
+    }
 
-static esp_err_t wifi_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)wifi_module_js_start, wifi_module_js_end - wifi_module_js_start);
-    return ESP_OK;
+    return false;
 }
 
-static esp_err_t control_module_js_handler(httpd_req_t *req)
+//=================================================================
+// Единый обработчик всех GET-запросов. Неизвестные пути (включая проверки
+// captive portal вроде /generate_204) получают страницу портала
+static esp_err_t http_asset_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)control_module_js_start, control_module_js_end - control_module_js_start);
-    return ESP_OK;
-}
+    size_t len = strcspn(req->uri, "?");
+    const http_asset_t *asset = http_asset_find(req->uri, len);
 
-static esp_err_t update_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)update_module_js_start, update_module_js_end - update_module_js_start);
-    return ESP_OK;
-}
+    if (asset == NULL)
+        asset = http_index_asset;
 
-static esp_err_t device_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)device_module_js_start, device_module_js_end - device_module_js_start);
-    return ESP_OK;
-}
+    // Сокет ресурса закрывается после ответа: без LRU-вытеснения соединения
+    // браузера и проверок ОС не должны занимать места WebSocket
+    httpd_resp_set_hdr(req, "Connection", "close");
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
 
-static esp_err_t network_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)network_module_js_start, network_module_js_end - network_module_js_start);
-    return ESP_OK;
-}
+    // Ресурсы хранятся только сжатыми (tools/build_assets.py), несжатой копии нет
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (!http_encoding_accepted(req, asset->encoding))
+    {
+        httpd_resp_set_status(req, "406 Not Acceptable");
+        return httpd_resp_send(req, NULL, 0);
+    }
 
-static esp_err_t apoint_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)apoint_module_js_start, apoint_module_js_end - apoint_module_js_start);
-    return ESP_OK;
-}
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache);
 
-static esp_err_t mqtt_module_js_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)mqtt_module_js_start, mqtt_module_js_end - mqtt_module_js_start);
-    return ESP_OK;
+    if (http_etag_matches(req, asset->etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", asset->encoding);
+    return httpd_resp_send(req, (const char *)asset->data, asset->len);
 }
 
-static esp_err_t ledstrip_module_js_handler(httpd_req_t *req)
+//=================================================================
+// Закрытие сессии: WebSocket должен забыть свой сокет.
+// При заданном close_fn сокет закрывает сам обработчик
+static void http_session_closed(httpd_handle_t server, int sockfd)
 {
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)ledstrip_module_js_start, ledstrip_module_js_end - ledstrip_module_js_start);
-    return ESP_OK;
+    captive_portal_ws_session_closed(sockfd);
+    close(sockfd);
 }
 
 //=================================================================
@@ -169,9 +138,11 @@ void captive_portal_http_server_start(esp_netif_t *netif)
     }
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_open_sockets = 7;
-    config.lru_purge_enable = true;
-    config.max_uri_handlers = 19;
+    config.max_open_sockets = HTTP_MAX_SOCKETS;
+    config.lru_purge_enable = false; // Иначе вытесняется простаивающий сокет /ws
+    config.max_uri_handlers = 2; // WebSocket и все статические ресурсы
+    config.close_fn = http_session_closed;
+    config.uri_match_fn = httpd_uri_match_wildcard;
     config.stack_size = 8192;
     config.recv_wait_timeout = 5;
     config.send_wait_timeout = 5;
@@ -182,41 +153,27 @@ void captive_portal_http_server_start(esp_netif_t *netif)
         http_server = NULL;
     }
 
+    http_index_asset = http_asset_find("/index.html", strlen("/index.html"));
+    if (http_index_asset == NULL)
+    {
+        ESP_LOGE("HTTPD", "index.html is missing from the asset manifest");
+        return;
+    }
+
     if (httpd_start(&http_server, &config) == ESP_OK)
     {
         ESP_LOGI("HTTPD", "HTTP server started successfully on port %d", config.server_port);
 
-        httpd_uri_t uris[] = {
-
-            {.uri = "/", .method = HTTP_GET, .handler = captive_portal_handler, .user_ctx = netif},
-            {.uri = "/generate_204", .method = HTTP_GET, .handler = captive_portal_handler, .user_ctx = netif},
-            {.uri = "/hotspot-detect.html", .method = HTTP_GET, .handler = captive_portal_handler, .user_ctx = netif},
-            {.uri = "/connecttest.txt", .method = HTTP_GET, .handler = captive_portal_handler, .user_ctx = netif},
-            {.uri = "/redirect", .method = HTTP_GET, .handler = captive_portal_handler, .user_ctx = netif},
-
-            // Статические ресурсы
-            {.uri = "/styles.css", .method = HTTP_GET, .handler = style_css_handler, .user_ctx = netif},
-            {.uri = "/script.js", .method = HTTP_GET, .handler = script_js_handler, .user_ctx = netif},
-
-            // Модульные JS-файлы
-            {.uri = "/settings_core.js", .method = HTTP_GET, .handler = settings_core_js_handler, .user_ctx = netif},
-            {.uri = "/base_module.js", .method = HTTP_GET, .handler = base_module_js_handler, .user_ctx = netif},
-            {.uri = "/wifi_module.js", .method = HTTP_GET, .handler = wifi_module_js_handler, .user_ctx = netif},
-            {.uri = "/control_module.js", .method = HTTP_GET, .handler = control_module_js_handler, .user_ctx = netif},
-            {.uri = "/update_module.js", .method = HTTP_GET, .handler = update_module_js_handler, .user_ctx = netif},
-            {.uri = "/device_module.js", .method = HTTP_GET, .handler = device_module_js_handler, .user_ctx = netif},
-            {.uri = "/network_module.js", .method = HTTP_GET, .handler = network_module_js_handler, .user_ctx = netif},
-            {.uri = "/apoint_module.js", .method = HTTP_GET, .handler = apoint_module_js_handler, .user_ctx = netif},
-            {.uri = "/mqtt_module.js", .method = HTTP_GET, .handler = mqtt_module_js_handler, .user_ctx = netif},
-            {.uri = "/ledstrip_module.js", .method = HTTP_GET, .handler = ledstrip_module_js_handler, .user_ctx = netif},
-            {.uri = "/modules_registry.js", .method = HTTP_GET, .handler = modules_registry_js_handler, .user_ctx = netif},
-            {.uri = "/loader.js", .method = HTTP_GET, .handler = loader_js_handler, .user_ctx = netif},
-        };
-
-        for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++)
-        {
-            httpd_register_uri_handler(http_server, &uris[i]);
-        }
+        // WebSocket регистрируется первым: обработчики проверяются по порядку
+        captive_portal_ws_server_start(http_server, netif);
+
+        httpd_uri_t uri = {
+            .uri = "/*",
+            .method = HTTP_GET,
+            .handler = http_asset_handler,
+            .user_ctx = netif};
+
+        httpd_register_uri_handler(http_server, &uri);
 
         // Уменьшаем уровень логирования HTTPD
         esp_log_level_set("httpd", ESP_LOG_ERROR);
@@ -233,6 +190,7 @@ esp_err_t captive_portal_http_server_stop(void)
 {
     if (http_server)
     {
+        captive_portal_ws_server_stop();
         httpd_stop(http_server);
         http_server = NULL;
     }
@@ -0,0 +1,43 @@
+#ifndef __HTTPASSETS_H
+#define __HTTPASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Встроенный веб-ресурс портала.
+     *
+     * Таблица ресурсов генерируется при сборке (tools/build_assets.py) по файлам из assets/.
+     */
+    typedef struct
+    {
+        const char *path; // "/styles.css"
+        const char *type;
+        const unsigned char *data;
+        uint32_t len;
+        const char *etag;     // Хеш содержимого в кавычках
+        const char *encoding; // Content-Encoding
+        const char *cache;    // Cache-Control
+    } http_asset_t;
+
+    extern const http_asset_t http_assets[];
+    extern const uint8_t http_assets_count;
+
+    // Совершенная хеш-таблица: слот = fnv1a(seed, path) & mask, 0xFF - пусто
+    extern const uint32_t http_assets_seed;
+    extern const uint8_t http_assets_slot_mask;
+    extern const uint8_t http_assets_slots[];
+
+    // Ресурс по пути (без строки запроса) или NULL
+    const http_asset_t *http_asset_find(const char *path, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HTTPASSETS_H
@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -18,62 +17,56 @@
 
 static const char *TAG = "apoint module";
 //=================================================================
-esp_err_t apoint_module_target(cJSON *json)
+esp_err_t apoint_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
         ESP_LOGW(TAG, "Invalid or missing 'action'");
-        send_response_json("response", "apoint", "error_partial", "\"invalid or missing 'action'\"", false);
+        send_response_json("response", "apoint", "error_partial", "\"invalid or missing 'action'\"");
         return ESP_ERR_INVALID_ARG;
     }
 
     wifi_ap_config_t ap_config = {0};
     esp_err_t result = ESP_OK;
 
-    if (strcmp(action->valuestring, "save_partial") == 0)
+    if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in save request");
-            send_response_json("response", "apoint", "error_partial", "\"missing 'data'\"", false);
+            send_response_json("response", "apoint", "error_partial", "\"missing 'data'\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        cJSON *ssid_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "ssid");
-        cJSON *passw_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "password");
+        int ssid_obj = request_find(req, req->data, "ssid");
+        int passw_obj = request_find(req, req->data, "password");
 
-        if (cJSON_IsString(ssid_obj) && ssid_obj->valuestring != NULL)
+        if (request_is_string(req, ssid_obj))
         {
-            size_t ssid_len = strlen(ssid_obj->valuestring);
-            if (ssid_len > 31) // 32 байта, включая null-терминатор
+            // 32 байта, включая null-терминатор
+            if (request_copy_string(req, ssid_obj, (char *)ap_config.ssid, sizeof(ap_config.ssid)) != ESP_OK)
             {
-                ESP_LOGE(TAG, "SSID too long: %zu characters (max 31)", ssid_len);
-                send_response_json("response", "apoint", "error_partial", "\"SSID too long (max 31 characters)\"", false);
+                ESP_LOGE(TAG, "SSID too long (max 31)");
+                send_response_json("response", "apoint", "error_partial", "\"SSID too long (max 31 characters)\"");
                 return ESP_ERR_INVALID_ARG;
             }
-            strncpy((char *)ap_config.ssid, ssid_obj->valuestring, sizeof(ap_config.ssid) - 1);
-            ap_config.ssid[sizeof(ap_config.ssid) - 1] = '\0';
         }
         else
         {
             ESP_LOGW(TAG, "SSID is missing or not a string");
-            send_response_json("response", "apoint", "error_partial", "\"SSID is missing or invalid\"", false);
+            send_response_json("response", "apoint", "error_partial", "\"SSID is missing or invalid\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        if (cJSON_IsString(passw_obj) && passw_obj->valuestring != NULL)
+        if (request_is_string(req, passw_obj))
         {
-            size_t passw_len = strlen(passw_obj->valuestring);
-            if (passw_len > 63) // 64 байта, включая null-терминатор
+            // 64 байта, включая null-терминатор
+            if (request_copy_string(req, passw_obj, (char *)ap_config.password, sizeof(ap_config.password)) != ESP_OK)
             {
-                ESP_LOGE(TAG, "Password too long: %zu characters (max 63)", passw_len);
-                send_response_json("response", "apoint", "error_partial", "\"Password too long (max 63 characters)\"", false);
+                ESP_LOGE(TAG, "Password too long (max 63)");
+                send_response_json("response", "apoint", "error_partial", "\"Password too long (max 63 characters)\"");
                 return ESP_ERR_INVALID_ARG;
             }
-            strncpy((char *)ap_config.password, passw_obj->valuestring, sizeof(ap_config.password) - 1);
-            ap_config.password[sizeof(ap_config.password) - 1] = '\0';
         }
         else
         {
@@ -85,37 +78,36 @@ esp_err_t apoint_module_target(cJSON *json)
 
         if (result == ESP_OK)
         {
-            send_response_json("response", "apoint", "saved_partial", NULL, false);
+            send_response_json("response", "apoint", "saved_partial", NULL);
         }
         else
         {
             ESP_LOGE(TAG, "Save failed: %s", esp_err_to_name(result));
-            send_response_json("response", "apoint", "error_partial", "save failed", false);
+            send_response_json("response", "apoint", "error_partial", "save failed");
         }
 
         return result;
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *data_obj = cJSON_CreateObject();
-        if (!data_obj)
-        {
-            ESP_LOGE(TAG, "Failed to create JSON response");
-            return ESP_ERR_NO_MEM;
-        }
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "apoint", "load_partial");
+        response_push_object(&writer, "data");
 
         if (dwnvs_load_ap_config(&ap_config) == ESP_OK && ap_config.ssid[0] != '\0')
         {
-            cJSON_AddStringToObject(data_obj, "ssid", (char *)ap_config.ssid);
-            cJSON_AddStringToObject(data_obj, "password", (char *)ap_config.password);
+            response_set_string(&writer, "ssid", (char *)ap_config.ssid);
+            response_set_string(&writer, "password", (char *)ap_config.password);
         }
 
-        send_response_json("response", "apoint", "load_partial", data_obj, true);
+        response_pop_object(&writer);
+        response_end(&writer);
     }
     else
     {
-        ESP_LOGW(TAG, "Unknown action: %s", action->valuestring);
-        send_response_json("response", "apoint", "error_partial", "unknown action", false);
+        ESP_LOGW(TAG, "Unknown action: %.*s", request_token_len(req, req->action), request_token_ptr(req, req->action));
+        send_response_json("response", "apoint", "error_partial", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -14,8 +13,18 @@
 #include "esp_netif.h"
 #include "dwnvs.h"
 #include "modules.h"
+#include "settings_snapshot.h"
+#include "mbedtls/base64.h"
+#include <stdlib.h>
 
 static const char *TAG = "CONFIG";
+
+typedef enum
+{
+    CONTROL_LOGOUT,
+    CONTROL_RESET,
+    CONTROL_REBOOT,
+} control_action_t;
 //=================================================================
 static void task_reboot_system(void *pvParameters)
 {
@@ -34,15 +43,15 @@ static void task_reboot_system(void *pvParameters)
 //=================================================================
 static void action_task(void *argument)
 {
-    char *action = (char *)argument;
+    control_action_t action = (control_action_t)(intptr_t)argument;
 
-    if (strcmp(action, "logout") == 0)
+    if (action == CONTROL_LOGOUT)
     {
         vTaskDelay(100 / portTICK_PERIOD_MS);
         ESP_LOGI(TAG, "Stopping captive portal components...");
         portal_stop(false);
     }
-    else if (strcmp(action, "reset") == 0)
+    else if (action == CONTROL_RESET)
     {
         vTaskDelay(100 / portTICK_PERIOD_MS);
 
@@ -65,7 +74,7 @@ static void action_task(void *argument)
         vTaskDelay(2500 / portTICK_PERIOD_MS);
         esp_restart();
     }
-    else if (strcmp(action, "reboot") == 0)
+    else if (action == CONTROL_REBOOT)
     {
         task_reboot_system(NULL);
     }
@@ -74,41 +83,120 @@ static void action_task(void *argument)
 }
 
 //=================================================================
-esp_err_t control_module_target(cJSON *json)
+static esp_err_t start_action(control_action_t action)
+{
+    BaseType_t ret = xTaskCreate(action_task, "action_task", 4096,
+                                 (void *)(intptr_t)action, 5, NULL);
+    if (ret != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Failed to create action task");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+//=================================================================
+// Снимок всех настроек в base64 для переноса на другие устройства
+static esp_err_t export_settings(void)
+{
+    size_t snapshot_len = 0;
+    size_t encoded_size = 4 * ((SETTINGS_SNAPSHOT_MAX_SIZE + 2) / 3) + 1;
+
+    uint8_t *snapshot = malloc(SETTINGS_SNAPSHOT_MAX_SIZE);
+    char *encoded = malloc(encoded_size);
+    if (snapshot == NULL || encoded == NULL)
+    {
+        free(snapshot);
+        free(encoded);
+        send_response_json("response", "control", "error", "out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = settings_snapshot_export(snapshot, SETTINGS_SNAPSHOT_MAX_SIZE, &snapshot_len);
+    if (err == ESP_OK)
+    {
+        size_t encoded_len = 0;
+        mbedtls_base64_encode((unsigned char *)encoded, encoded_size, &encoded_len, snapshot, snapshot_len);
+
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "control", "settings_exported");
+        response_push_object(&writer, "data");
+        response_set_int(&writer, "version", SETTINGS_SNAPSHOT_VERSION);
+        response_set_int(&writer, "size", snapshot_len);
+        response_set_string(&writer, "snapshot", encoded);
+        response_pop_object(&writer);
+        response_end(&writer);
+    }
+    else
+    {
+        send_response_json("response", "control", "error", "export failed");
+    }
+
+    free(snapshot);
+    free(encoded);
+    return err;
+}
+
+//=================================================================
+esp_err_t control_import_settings(const void *data, size_t len)
+{
+    esp_err_t err = settings_snapshot_import(data, len);
+    switch (err)
+    {
+    case ESP_OK:
+        send_response_json("response", "control", "settings_imported", NULL);
+        return start_action(CONTROL_REBOOT);
+    case ESP_ERR_INVALID_CRC:
+        send_response_json("response", "control", "error", "snapshot checksum mismatch");
+        break;
+    case ESP_ERR_INVALID_VERSION:
+        send_response_json("response", "control", "error", "unsupported snapshot version");
+        break;
+    case ESP_ERR_INVALID_ARG:
+    case ESP_ERR_INVALID_SIZE:
+        send_response_json("response", "control", "error", "invalid snapshot");
+        break;
+    default:
+        send_response_json("response", "control", "error", "save failed");
+        break;
+    }
+    return err;
+}
+
+//=================================================================
+esp_err_t control_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
-        send_response_json("response", "control", "error", "missing or invalid 'action'", false);
+        send_response_json("response", "control", "error", "missing or invalid 'action'");
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (strcmp(action->valuestring, "reset") == 0 ||
-        strcmp(action->valuestring, "reboot") == 0 ||
-        strcmp(action->valuestring, "logout") == 0)
+    control_action_t action;
+
+    if (request_equals(req, req->action, "reset"))
+    {
+        action = CONTROL_RESET;
+    }
+    else if (request_equals(req, req->action, "reboot"))
     {
-        // Создаём копию строки для передачи в задачу
-        char *action_copy = strdup(action->valuestring);
-        if (action_copy == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to allocate memory for action string");
-            return ESP_ERR_NO_MEM;
-        }
-
-        BaseType_t ret = xTaskCreate(action_task, "action_task", 4096,
-                                     (void *)action_copy, 5, NULL);
-        if (ret != pdTRUE)
-        {
-            free(action_copy);
-            ESP_LOGE(TAG, "Failed to create action task");
-            return ESP_FAIL;
-        }
+        action = CONTROL_REBOOT;
+    }
+    else if (request_equals(req, req->action, "logout"))
+    {
+        action = CONTROL_LOGOUT;
+    }
+    else if (request_equals(req, req->action, "export_settings"))
+    {
+        return export_settings();
     }
     else
     {
-        send_response_json("response", "control", "error", "unknown action", false);
+        send_response_json("response", "control", "error", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
-    return ESP_OK;
+    return start_action(action);
 }
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -19,154 +18,115 @@ static const char *TAG = "DATAPARSER";
 
 #define MAX_CONFIG_VALUE_LENGTH 255
 //=================================================================
-esp_err_t parse_and_save_json_settings(const char *namespace, cJSON *json, const config_param_t *config_params, size_t params_count)
+esp_err_t parse_and_save_json_settings(const request_t *req, int object, const setting_id_t *settings, size_t settings_count, setting_id_t *invalid)
 {
-    if (!cJSON_IsObject(json) || config_params == NULL || params_count == 0)
+    if (!request_is_object(req, object) || settings == NULL || settings_count == 0)
         return ESP_ERR_INVALID_ARG;
 
-    esp_err_t overall_err = ESP_OK;
+    const char *namespace = settings_desc(settings[0])->namespace;
     bool found_any = false;
+    char value[MAX_CONFIG_VALUE_LENGTH + 1];
 
-    for (size_t i = 0; i < params_count; i++)
+    // Все ключи страницы записываются одним commit, при ошибке записанные откатываются
+    nvs_txn_t txn;
+    esp_err_t err = nvs_txn_begin(namespace, &txn);
+    if (err != ESP_OK)
     {
-        cJSON *item = cJSON_GetObjectItemCaseSensitive(json, config_params[i].json_key);
-        if (item == NULL)
+        ESP_LOGE(TAG, "Failed to begin transaction for '%s': %s", namespace, esp_err_to_name(err));
+        return err;
+    }
+
+    for (size_t i = 0; i < settings_count; i++)
+    {
+        const char *key = settings_desc(settings[i])->key;
+
+        int item = request_find(req, object, key);
+        if (item < 0)
         {
-            ESP_LOGW(TAG, "Key '%s' not found in JSON", config_params[i].json_key);
+            ESP_LOGW(TAG, "Key '%s' not found in JSON", key);
             continue; // Пропускаем, если ключ не найден
         }
 
-        if (!cJSON_IsString(item) || item->valuestring == NULL)
+        err = request_copy_string(req, item, value, sizeof(value));
+        if (err == ESP_OK)
         {
-            ESP_LOGE(TAG, "Key '%s' is not a valid string", config_params[i].json_key);
-            continue; // Пропускаем, если не строка
+            // Проверка по схеме, пустая строка удаляет запись
+            err = settings_txn_set_text(txn, settings[i], value);
         }
-
-        size_t len = strlen(item->valuestring);
-        if (len == 0)
+        else if (err == ESP_ERR_INVALID_SIZE)
         {
-            // Удаляем запись, если строка пустая
-            esp_err_t err = nvs_delete_data(namespace, config_params[i].nvs_key);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "Failed to erase key '%s': %s", config_params[i].nvs_key, esp_err_to_name(err));
-                if (overall_err == ESP_OK)
-                {
-                    overall_err = err;
-                }
-            }
-            else
-            {
-                ESP_LOGI(TAG, "Erased key '%s' due to empty value", config_params[i].nvs_key);
-            }
-            found_any = true;
-            continue;
+            err = ESP_ERR_INVALID_ARG;
         }
 
-        if (len > MAX_CONFIG_VALUE_LENGTH)
+        if (err != ESP_OK)
         {
-            ESP_LOGE(TAG, "Value for key '%s' invalid length: %zu", config_params[i].json_key, len);
-            continue;
+            ESP_LOGE(TAG, "Invalid value for key '%s': %.*s", key,
+                     request_token_len(req, item), request_token_ptr(req, item));
+            if (invalid != NULL)
+                *invalid = settings[i];
+            nvs_txn_rollback(txn);
+            return err;
         }
 
         found_any = true;
-
-        esp_err_t err = nvs_save_data(namespace,
-                                      config_params[i].nvs_key,
-                                      item->valuestring,
-                                      len + 1,
-                                      NVS_TYPE_STR);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "Failed to save key '%s': %s", config_params[i].nvs_key, esp_err_to_name(err));
-
-            if (overall_err == ESP_OK)
-            {
-                overall_err = err; // Сохраняем первую ошибку
-            }
-        }
     }
 
     if (!found_any)
     {
         ESP_LOGW(TAG, "No valid keys found in JSON for saving");
+        nvs_txn_rollback(txn);
         return ESP_FAIL; // или ESP_ERR_NOT_FOUND, если хотите
     }
 
-    return overall_err;
+    err = nvs_txn_commit(txn);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to save '%s' settings: %s", namespace, esp_err_to_name(err));
+    }
+
+    return err;
 }
 //=================================================================
-cJSON *load_and_parse_json_settings(const char *namespace, const config_param_t *config_params, size_t params_count)
+void load_and_parse_json_settings(response_writer_t *writer, const setting_id_t *settings, size_t settings_count)
 {
-    if (config_params == NULL || params_count == 0 || namespace == NULL)
-        return NULL;
+    if (writer == NULL || settings == NULL || settings_count == 0)
+        return;
 
-    cJSON *json = cJSON_CreateObject();
-    if (json == NULL)
-        return NULL;
+    char value[MAX_CONFIG_VALUE_LENGTH + 1];
 
-    for (size_t i = 0; i < params_count; i++)
+    for (size_t i = 0; i < settings_count; i++)
     {
-        size_t required_size = 0;
-        esp_err_t err = nvs_load_data(namespace,
-                                      config_params[i].nvs_key,
-                                      NULL,
-                                      &required_size,
-                                      NVS_TYPE_STR);
+        const char *key = settings_desc(settings[i])->key;
+        esp_err_t err = settings_get_text(settings[i], value, sizeof(value));
 
-        if (err == ESP_OK && required_size > 0)
-        {
-            char *value = malloc(required_size);
-            if (value != NULL)
-            {
-                err = nvs_load_data(namespace,
-                                    config_params[i].nvs_key,
-                                    value,
-                                    &required_size,
-                                    NVS_TYPE_STR);
-
-                if (err == ESP_OK)
-                {
-                    cJSON_AddStringToObject(json, config_params[i].json_key, value);
-                }
-                else
-                {
-                    cJSON_AddNullToObject(json, config_params[i].json_key);
-                }
-                free(value);
-            }
-            else
-            {
-                cJSON_AddNullToObject(json, config_params[i].json_key);
-                ESP_LOGE(TAG, "Memory alloc failed for key: %s", config_params[i].json_key);
-            }
-        }
-        else if (err == ESP_ERR_NVS_NOT_FOUND)
+        if (err == ESP_OK)
         {
-            cJSON_AddNullToObject(json, config_params[i].json_key);
+            response_set_string(writer, key, value);
         }
-        else if (err != ESP_OK)
+        else
         {
-            cJSON_AddNullToObject(json, config_params[i].json_key);
+            if (err != ESP_ERR_NVS_NOT_FOUND)
+            {
+                ESP_LOGE(TAG, "Failed to load key '%s': %s", key, esp_err_to_name(err));
+            }
+            response_set_null(writer, key);
         }
     }
-
-    return json;
 }
 //=================================================================
-esp_err_t parse_and_save_json_ip_info(const char *namespace, cJSON *json, esp_netif_ip_info_t *ipinfo)
+esp_err_t parse_and_save_json_ip_info(const char *namespace, const request_t *req, int object, esp_netif_ip_info_t *ipinfo)
 {
-    if (!cJSON_IsObject(json) || namespace == NULL)
+    if (!request_is_object(req, object) || namespace == NULL)
         return ESP_ERR_INVALID_ARG;
 
-    cJSON *mode_item = cJSON_GetObjectItemCaseSensitive(json, "mode");
-    if (!cJSON_IsString(mode_item) || mode_item->valuestring == NULL)
+    char mode[8] = {0};
+    if (request_copy_string(req, request_find(req, object, "mode"), mode, sizeof(mode)) != ESP_OK)
     {
         ESP_LOGE(TAG, "Mode field is missing or invalid");
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (strcmp(mode_item->valuestring, "dhcp") == 0)
+    if (strcmp(mode, "dhcp") == 0)
     {
         esp_err_t err = dwnvs_delete_ipinfo(namespace);
         if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
@@ -181,49 +141,47 @@ esp_err_t parse_and_save_json_ip_info(const char *namespace, cJSON *json, esp_ne
         }
         return ESP_OK;
     }
-    else if (strcmp(mode_item->valuestring, "static") == 0)
+    else if (strcmp(mode, "static") == 0)
     {
         esp_netif_ip_info_t local_ip_info = {0};
         bool has_ip = false, has_gw = false, has_nm = false;
+        char addr[16];
 
-        cJSON *ip_item = cJSON_GetObjectItemCaseSensitive(json, "ip");
-        if (cJSON_IsString(ip_item) && ip_item->valuestring != NULL)
+        if (request_copy_string(req, request_find(req, object, "ip"), addr, sizeof(addr)) == ESP_OK)
         {
-            if (esp_netif_str_to_ip4(ip_item->valuestring, &local_ip_info.ip) == ESP_OK)
+            if (esp_netif_str_to_ip4(addr, &local_ip_info.ip) == ESP_OK)
             {
                 has_ip = true;
             }
             else
             {
-                ESP_LOGE(TAG, "Invalid IP: %s", ip_item->valuestring);
+                ESP_LOGE(TAG, "Invalid IP: %s", addr);
                 return ESP_ERR_INVALID_ARG;
             }
         }
 
-        cJSON *gw_item = cJSON_GetObjectItemCaseSensitive(json, "gateway");
-        if (cJSON_IsString(gw_item) && gw_item->valuestring != NULL)
+        if (request_copy_string(req, request_find(req, object, "gateway"), addr, sizeof(addr)) == ESP_OK)
         {
-            if (esp_netif_str_to_ip4(gw_item->valuestring, &local_ip_info.gw) == ESP_OK)
+            if (esp_netif_str_to_ip4(addr, &local_ip_info.gw) == ESP_OK)
             {
                 has_gw = true;
             }
             else
             {
-                ESP_LOGE(TAG, "Invalid GW: %s", gw_item->valuestring);
+                ESP_LOGE(TAG, "Invalid GW: %s", addr);
                 return ESP_ERR_INVALID_ARG;
             }
         }
 
-        cJSON *nm_item = cJSON_GetObjectItemCaseSensitive(json, "netmask");
-        if (cJSON_IsString(nm_item) && nm_item->valuestring != NULL)
+        if (request_copy_string(req, request_find(req, object, "netmask"), addr, sizeof(addr)) == ESP_OK)
         {
-            if (esp_netif_str_to_ip4(nm_item->valuestring, &local_ip_info.netmask) == ESP_OK)
+            if (esp_netif_str_to_ip4(addr, &local_ip_info.netmask) == ESP_OK)
             {
                 has_nm = true;
             }
             else
             {
-                ESP_LOGE(TAG, "Invalid NM: %s", nm_item->valuestring);
+                ESP_LOGE(TAG, "Invalid NM: %s", addr);
                 return ESP_ERR_INVALID_ARG;
             }
         }
@@ -249,56 +207,45 @@ esp_err_t parse_and_save_json_ip_info(const char *namespace, cJSON *json, esp_ne
     }
     else
     {
-        ESP_LOGE(TAG, "Unknown mode: %s", mode_item->valuestring);
+        ESP_LOGE(TAG, "Unknown mode: %s", mode);
         return ESP_ERR_INVALID_ARG;
     }
 }
 //=================================================================
-cJSON *load_and_parse_json_ip_info(const char *namespace)
+esp_err_t load_and_parse_json_ip_info(response_writer_t *writer, const char *namespace)
 {
-    if (namespace == NULL)
-        return NULL;
-
-    cJSON *json = cJSON_CreateObject();
-    if (json == NULL)
-        return NULL;
+    if (writer == NULL || namespace == NULL)
+        return ESP_ERR_INVALID_ARG;
 
     esp_netif_ip_info_t ip_info = {0};
     esp_err_t err = dwnvs_load_ipinfo(namespace, &ip_info);
 
     if (err == ESP_OK)
     {
-        cJSON_AddStringToObject(json, "mode", "static");
-
         char ip_str[16] = {0}, gw_str[16] = {0}, nm_str[16] = {0};
-        esp_ip4_addr_t ip4_addr;
-
-        ip4_addr.addr = ip_info.ip.addr;
-        esp_ip4addr_ntoa(&ip4_addr, ip_str, sizeof(ip_str));
-        cJSON_AddStringToObject(json, "ip", ip_str);
 
-        ip4_addr.addr = ip_info.gw.addr;
-        esp_ip4addr_ntoa(&ip4_addr, gw_str, sizeof(gw_str));
-        cJSON_AddStringToObject(json, "gateway", gw_str);
+        esp_ip4addr_ntoa(&ip_info.ip, ip_str, sizeof(ip_str));
+        esp_ip4addr_ntoa(&ip_info.gw, gw_str, sizeof(gw_str));
+        esp_ip4addr_ntoa(&ip_info.netmask, nm_str, sizeof(nm_str));
 
-        ip4_addr.addr = ip_info.netmask.addr;
-        esp_ip4addr_ntoa(&ip4_addr, nm_str, sizeof(nm_str));
-        cJSON_AddStringToObject(json, "netmask", nm_str);
+        response_set_string(writer, "mode", "static");
+        response_set_string(writer, "ip", ip_str);
+        response_set_string(writer, "gateway", gw_str);
+        response_set_string(writer, "netmask", nm_str);
     }
     else if (err == ESP_ERR_NVS_NOT_FOUND)
     {
-        cJSON_AddStringToObject(json, "mode", "dhcp");
-        cJSON_AddNullToObject(json, "ip");
-        cJSON_AddNullToObject(json, "gw");
-        cJSON_AddNullToObject(json, "nm");
+        response_set_string(writer, "mode", "dhcp");
+        response_set_null(writer, "ip");
+        response_set_null(writer, "gw");
+        response_set_null(writer, "nm");
     }
     else
     {
         ESP_LOGE(TAG, "Failed to load IP info: %s", esp_err_to_name(err));
-        cJSON_Delete(json);
-        return NULL;
+        return err;
     }
 
-    return json;
+    return ESP_OK;
 }
 //=================================================================
\ No newline at end of file
@@ -1,28 +1,27 @@
 #ifndef __DATAPARSE_H
 #define __DATAPARSE_H
 
-#include "cJSON.h"
 #include "esp_err.h"
 #include "esp_netif.h"
+#include "modules.h"
+#include "settings.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-    typedef struct
-    {
-        const char *json_key;
-        const char *nvs_key;
-    } config_param_t;
-
-    // Загрузка и сохранение обычных строковых настроек
-    cJSON *load_and_parse_json_settings(const char *namespace, const config_param_t *config_params, size_t params_count);
-    esp_err_t parse_and_save_json_settings(const char *namespace, cJSON *json, const config_param_t *config_params, size_t params_count);
+    // Загрузка и сохранение настроек из схемы (settings_schema.h); все настройки
+    // списка должны быть из одного пространства имен.
+    // Загруженные значения пишутся в открытый объект ответа writer.
+    // Сохранение - одна транзакция NVS: ошибка в любом поле отменяет запись всей страницы,
+    // непрошедшая проверку настройка возвращается в invalid (может быть NULL).
+    void load_and_parse_json_settings(response_writer_t *writer, const setting_id_t *settings, size_t settings_count);
+    esp_err_t parse_and_save_json_settings(const request_t *req, int object, const setting_id_t *settings, size_t settings_count, setting_id_t *invalid);
 
     // Загрузка и сохранение IP-настроек (static/dhcp)
-    cJSON *load_and_parse_json_ip_info(const char *namespace);
-    esp_err_t parse_and_save_json_ip_info(const char *namespace, cJSON *json, esp_netif_ip_info_t *ipinfo);
+    esp_err_t load_and_parse_json_ip_info(response_writer_t *writer, const char *namespace);
+    esp_err_t parse_and_save_json_ip_info(const char *namespace, const request_t *req, int object, esp_netif_ip_info_t *ipinfo);
 
 #ifdef __cplusplus
 }
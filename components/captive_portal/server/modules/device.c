@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -18,60 +17,48 @@
 
 static const char *TAG = "device module";
 
-static const config_param_t device_params[] = {
-    {"hostname", "hostname"},
+static const setting_id_t device_params[] = {
+    SETTING_DEVICE_HOSTNAME,
 };
 //=================================================================
-esp_err_t device_module_target(cJSON *json)
+esp_err_t device_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
         ESP_LOGW(TAG, "Invalid or missing 'action'");
-        send_response_json("response", "device", "error_partial", "\"invalid or missing 'action'\"", false);
+        send_response_json("response", "device", "error_partial", "\"invalid or missing 'action'\"");
         return ESP_ERR_INVALID_ARG;
     }
 
     esp_err_t result = ESP_OK;
-    if (strcmp(action->valuestring, "save_partial") == 0)
+    if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in save request");
-            send_response_json("response", "device", "error_partial", "\"missing 'data'\"", false);
+            send_response_json("response", "device", "error_partial", "\"missing 'data'\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        // Проверим hostname на валидность длины
-        cJSON *hostname_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "hostname");
-        if (cJSON_IsString(hostname_obj) && hostname_obj->valuestring != NULL)
-        {
-            size_t hostname_len = strlen(hostname_obj->valuestring);
-            if (hostname_len > 63) // ESP-IDF обычно ограничивает hostname до 63 байт
-            {
-                ESP_LOGE(TAG, "Hostname too long: %zu characters (max 63)", hostname_len);
-                send_response_json("response", "device", "error_partial", "\"Hostname too long (max 63 characters)\"", false);
-                return ESP_ERR_INVALID_ARG;
-            }
-        }
-
-        esp_err_t result = parse_and_save_json_settings(
-            "device",
-            data_obj,
-            device_params,
-            sizeof(device_params) / sizeof(device_params[0]));
+        setting_id_t invalid = SETTING_COUNT;
+        esp_err_t result = parse_and_save_json_settings(req, req->data, device_params, sizeof(device_params) / sizeof(device_params[0]), &invalid);
 
         if (result != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed to parse and save general settings");
-            send_response_json("response", "device", "error_partial", "parse and save failed", false);
+            char message[64] = "parse and save failed";
+            if (invalid != SETTING_COUNT)
+                settings_error_text(invalid, message, sizeof(message));
+            send_response_json("response", "device", "error_partial", message);
             return result;
         }
 
-        if (cJSON_IsString(hostname_obj) && hostname_obj->valuestring != NULL)
+        // ESP-IDF ограничивает hostname 63 байтами, длина уже проверена схемой
+        char hostname[64] = {0};
+        esp_err_t hostname_err = settings_get_str(SETTING_DEVICE_HOSTNAME, hostname, sizeof(hostname));
+        if (hostname_err == ESP_OK)
         {
-            dw_set_hostname_to_netif(WIFI_IF_STA, hostname_obj->valuestring);
+            dw_set_hostname_to_netif(WIFI_IF_STA, hostname);
         }
         else
         {
@@ -81,38 +68,32 @@ esp_err_t device_module_target(cJSON *json)
 
         if (result == ESP_OK)
         {
-            send_response_json("response", "device", "saved_partial", NULL, false);
+            send_response_json("response", "device", "saved_partial", NULL);
         }
         else
         {
             ESP_LOGE(TAG, "Save failed: %s", esp_err_to_name(result));
-            send_response_json("response", "device", "error_partial", "save failed", false);
+            send_response_json("response", "device", "error_partial", "save failed");
         }
 
         return result;
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *load_settings = load_and_parse_json_settings(
-            "device",
-            device_params,
-            sizeof(device_params) / sizeof(device_params[0]));
+        response_writer_t writer;
 
-        if (load_settings != NULL)
-        {
-            send_response_json("response", "device", "load_partial", load_settings, true);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Load failed");
-            send_response_json("response", "device", "error_partial", "load failed", false);
-            return ESP_ERR_NOT_FOUND;
-        }
+        response_begin(&writer, "response", "device", "load_partial");
+        response_push_object(&writer, "data");
+        load_and_parse_json_settings(&writer,
+                                     device_params,
+                                     sizeof(device_params) / sizeof(device_params[0]));
+        response_pop_object(&writer);
+        response_end(&writer);
     }
     else
     {
-        ESP_LOGW(TAG, "Unknown action: %s", action->valuestring);
-        send_response_json("response", "device", "error_partial", "unknown action", false);
+        ESP_LOGW(TAG, "Unknown action: %.*s", request_token_len(req, req->action), request_token_ptr(req, req->action));
+        send_response_json("response", "device", "error_partial", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -15,85 +14,61 @@
 #include "dwnvs.h"
 #include "data_parser.h"
 #include "modules.h"
-#include "driver/gpio.h"
 
 static const char *TAG = "ledstrip module";
 
-static const config_param_t ledstrip_params[] = {
-    {"lednum", "lednum"},
-    {"hostname", "hostname"},
-    {"ledpin", "ledpin"}};
+static const setting_id_t ledstrip_params[] = {
+    SETTING_LEDSTRIP_LEDNUM,
+    SETTING_LEDSTRIP_HOSTNAME,
+    SETTING_LEDSTRIP_LEDPIN,
+};
 
 //=================================================================
-esp_err_t ledstrip_module_target(cJSON *json)
+esp_err_t ledstrip_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
-        send_response_json("response", "ledstrip", "error_partial", "missing or invalid 'action'", false);
+        send_response_json("response", "ledstrip", "error_partial", "missing or invalid 'action'");
         return ESP_ERR_INVALID_ARG;
     }
 
     esp_err_t result = ESP_OK;
 
-    if (strcmp(action->valuestring, "save_partial") == 0)
+    if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data = cJSON_GetObjectItemCaseSensitive(json, "data");
+        setting_id_t invalid = SETTING_COUNT;
+        result = parse_and_save_json_settings(req, req->data, ledstrip_params, sizeof(ledstrip_params) / sizeof(ledstrip_params[0]), &invalid);
 
-        // Проверим, есть ли в data поле ledpin
-        cJSON *ledpin_item = cJSON_GetObjectItemCaseSensitive(data, "ledpin");
-        if (ledpin_item != NULL && cJSON_IsString(ledpin_item))
+        if (result == ESP_OK)
         {
-            int temp_ledpin = atoi(ledpin_item->valuestring);
-            if (!GPIO_IS_VALID_OUTPUT_GPIO(temp_ledpin))
-            {
-                ESP_LOGE(TAG, "Invalid LED pin provided: %s", ledpin_item->valuestring);
-                send_response_json("response", "ledstrip", "error_partial", "invalid ledpin provided", false);
-                return ESP_ERR_INVALID_ARG;
-            }
+            send_response_json("response", "ledstrip", "saved_partial", NULL);
         }
-
-        // Проверим, есть ли в data поле lednum
-        cJSON *lednum_item = cJSON_GetObjectItemCaseSensitive(data, "lednum");
-        if (lednum_item != NULL && cJSON_IsString(lednum_item))
+        else if (invalid != SETTING_COUNT)
         {
-            int temp_lednum = atoi(lednum_item->valuestring);
-            if (temp_lednum <= 0 || temp_lednum > 512)
-            {
-                ESP_LOGE(TAG, "Invalid LED count provided: %s (must be 1-%d)", lednum_item->valuestring, 512);
-                send_response_json("response", "ledstrip", "error_partial", "invalid lednum provided (must be 1-512)", false);
-                return ESP_ERR_INVALID_ARG;
-            }
+            char message[64];
+            settings_error_text(invalid, message, sizeof(message));
+            send_response_json("response", "ledstrip", "error_partial", message);
         }
-
-        result = parse_and_save_json_settings("ledstrip", data, ledstrip_params, sizeof(ledstrip_params) / sizeof(ledstrip_params[0]));
-
-        if (result == ESP_OK)
+        else
         {
-            send_response_json("response", "ledstrip", "saved_partial", NULL, false);
+            send_response_json("response", "ledstrip", "error_partial", "save failed");
         }
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *load_settings = load_and_parse_json_settings(
-            "ledstrip",
-            ledstrip_params,
-            sizeof(ledstrip_params) / sizeof(ledstrip_params[0]));
+        response_writer_t writer;
 
-        if (load_settings != NULL)
-        {
-            send_response_json("response", "ledstrip", "load_partial", load_settings, true);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Load failed");
-            send_response_json("response", "ledstrip", "error_partial", "load failed", false);
-            return ESP_ERR_NOT_FOUND;
-        }
+        response_begin(&writer, "response", "ledstrip", "load_partial");
+        response_push_object(&writer, "data");
+        load_and_parse_json_settings(&writer,
+                                     ledstrip_params,
+                                     sizeof(ledstrip_params) / sizeof(ledstrip_params[0]));
+        response_pop_object(&writer);
+        response_end(&writer);
     }
     else
     {
-        send_response_json("response", "ledstrip", "error_partial", "unknown action", false);
+        send_response_json("response", "ledstrip", "error_partial", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -1,27 +1,78 @@
 #ifndef __SYSHAND_H
 #define __SYSAND_H
 
-#include "cJSON.h"
 #include "esp_err.h"
+#include "json_generator.h"
+#include "request_parser.h"
+
+// Размер фиксированного буфера потокового JSON-генератора.
+// Ответы длиннее буфера уходят клиенту фрагментами WebSocket.
+#define RESPONSE_CHUNK_SIZE 256
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-    esp_err_t device_module_target(cJSON *data);
-    esp_err_t control_module_target(cJSON *json);
-    esp_err_t ledstrip_module_target(cJSON *json);
-    esp_err_t wifi_module_target(cJSON *json);
-    esp_err_t network_module_target(cJSON *json);
-    esp_err_t apoint_module_target(cJSON *json);
-    esp_err_t mqtt_module_target(cJSON *json);
-    esp_err_t update_module_target(cJSON *json);
+    /**
+     * @brief Потоковый писатель ответа.
+     *
+     * JSON (или CBOR, если его выбрал клиент) пишется напрямую в фиксированный буфер
+     * без построения дерева cJSON. Когда буфер заполняется, накопленный фрагмент
+     * сразу ставится в очередь WebSocket.
+     */
+    typedef struct
+    {
+        json_gen_str_t jstr;
+        char buf[RESPONSE_CHUNK_SIZE + 1];
+        uint16_t chunks;
+        bool closing;
+        bool failed;
+        bool event;   // Однокадровое сообщение уходит через слоты событий
+        char key[32]; // "target/status" для замены устаревших событий
+        bool cbor;    // Клиент согласовал CBOR: buf заполняется напрямую, json_gen не используется
+        uint16_t used;
+    } response_writer_t;
+
+    esp_err_t device_module_target(const request_t *req);
+    esp_err_t control_module_target(const request_t *req);
+    esp_err_t ledstrip_module_target(const request_t *req);
+    esp_err_t wifi_module_target(const request_t *req);
+    // Уведомление из wifi_driver о новом результате проверки интернета
+    void wifi_module_internet_changed(esp_err_t result);
+    esp_err_t network_module_target(const request_t *req);
+    esp_err_t apoint_module_target(const request_t *req);
+    esp_err_t mqtt_module_target(const request_t *req);
+    esp_err_t update_module_target(const request_t *req);
+
+    /**
+     * @brief Применяет снимок настроек из бинарного кадра WebSocket и перезагружает устройство
+     *
+     * Результат отправляется клиенту ответом target "control".
+     */
+    esp_err_t control_import_settings(const void *data, size_t len);
+
+    void send_response_json(const char *type, const char *target, const char *status, const char *message);
 
-    void send_response_json(const char *type, const char *target, const char *status, const void *message, bool isObject);
+    // Открывает сообщение {"type", "target", "status" ... и оставляет объект верхнего уровня открытым
+    void response_begin(response_writer_t *writer, const char *type, const char *target, const char *status);
+    // Закрывает объект верхнего уровня и отправляет последний фрагмент
+    esp_err_t response_end(response_writer_t *writer);
+
+    void response_push_object(response_writer_t *writer, const char *name);
+    void response_pop_object(response_writer_t *writer);
+    void response_push_array(response_writer_t *writer, const char *name);
+    void response_pop_array(response_writer_t *writer);
+    void response_array_start_object(response_writer_t *writer);
+    void response_array_end_object(response_writer_t *writer);
+
+    void response_set_string(response_writer_t *writer, const char *name, const char *value);
+    void response_set_int(response_writer_t *writer, const char *name, int value);
+    void response_set_bool(response_writer_t *writer, const char *name, bool value);
+    void response_set_null(response_writer_t *writer, const char *name);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
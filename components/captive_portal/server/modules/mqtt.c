@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -20,12 +19,13 @@
 
 static const char *TAG = "mqtt module";
 
-static const config_param_t mqtt_params[] = {
-    {"enable", "enable"},
-    {"server", "server"},
-    {"port", "port"},
-    {"user", "user"},
-    {"password", "password"},
+static const setting_id_t mqtt_params[] = {
+    SETTING_MQTT_ENABLE,
+    SETTING_MQTT_SERVER,
+    SETTING_MQTT_PORT,
+    SETTING_MQTT_USER,
+    SETTING_MQTT_PASSWORD,
+    SETTING_MQTT_JSON,
 };
 //=================================================================
 static void task_mqtt_stop(void *pvParameters)
@@ -45,13 +45,13 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch ((esp_mqtt_event_id_t)event_id)
     {
     case MQTT_EVENT_CONNECTED:
-        send_response_json("event", "mqtt", "mqtt_connection_success", NULL, false);
+        send_response_json("event", "mqtt", "mqtt_connection_success", NULL);
         xTaskCreate(task_mqtt_stop, "mqtt_task_stop", 2048,
                     (void *)handler_args, 5, NULL);
         break;
 
     case MQTT_EVENT_ERROR:
-        send_response_json("event", "mqtt", "mqtt_connection_failed", NULL, false);
+        send_response_json("event", "mqtt", "mqtt_connection_failed", NULL);
         xTaskCreate(task_mqtt_stop, "mqtt_task_stop", 2048,
                     (void *)handler_args, 5, NULL);
         break;
@@ -61,119 +61,84 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     };
 }
 //=================================================================
-esp_err_t mqtt_module_target(cJSON *json)
+esp_err_t mqtt_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
         ESP_LOGW(TAG, "Invalid or missing 'action'");
-        send_response_json("response", "mqtt", "error_mqtt", "\"invalid or missing 'action'\"", false);
+        send_response_json("response", "mqtt", "error_mqtt", "\"invalid or missing 'action'\"");
         return ESP_ERR_INVALID_ARG;
     }
 
     esp_err_t result = ESP_OK;
 
-    if (strcmp(action->valuestring, "save_partial") == 0)
+    if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in save request");
-            send_response_json("response", "mqtt", "error_partial", "\"missing 'data'\"", false);
+            send_response_json("response", "mqtt", "error_partial", "\"missing 'data'\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        cJSON *port_item = cJSON_GetObjectItemCaseSensitive(data_obj, "port");
-        if (port_item != NULL && cJSON_IsString(port_item))
-        {
-            int temp_port = atoi(port_item->valuestring);
-            if (temp_port <= 0 || temp_port > 65535)
-            {
-                ESP_LOGE(TAG, "Invalid MQTT port provided: %s", port_item->valuestring);
-                send_response_json("response", "mqtt", "error_partial", "invalid port provided (must be 1-65535)", false);
-                return ESP_ERR_INVALID_ARG;
-            }
-        }
+        setting_id_t invalid = SETTING_COUNT;
+        result = parse_and_save_json_settings(req, req->data, mqtt_params, sizeof(mqtt_params) / sizeof(mqtt_params[0]), &invalid);
 
-        // Проверка длины всех строковых полей
-        cJSON *current_item = data_obj->child;
-        while (current_item != NULL)
+        if (result == ESP_OK)
         {
-            if (cJSON_IsString(current_item) && current_item->valuestring != NULL)
-            {
-                size_t str_len = strlen(current_item->valuestring);
-                if (str_len > 31) // 32 байта, включая null-терминатор
-                {
-                    ESP_LOGE(TAG, "String field '%s' too long: %zu characters (max 31)", current_item->string, str_len);
-                    send_response_json("response", "mqtt", "error_partial", "string field too long (max 31 characters)", false);
-                    return ESP_ERR_INVALID_ARG;
-                }
-            }
-            current_item = current_item->next;
+            send_response_json("response", "mqtt", "saved_partial", NULL);
         }
-
-        result = parse_and_save_json_settings(
-            "mqtt",
-            data_obj,
-            mqtt_params,
-            sizeof(mqtt_params) / sizeof(mqtt_params[0]));
-
-        if (result == ESP_OK)
+        else if (invalid != SETTING_COUNT)
         {
-            send_response_json("response", "mqtt", "saved_partial", NULL, false);
+            char message[64];
+            settings_error_text(invalid, message, sizeof(message));
+            send_response_json("response", "mqtt", "error_partial", message);
         }
         else
         {
             ESP_LOGE(TAG, "Save failed: %s", esp_err_to_name(result));
-            send_response_json("response", "mqtt", "error_partial", "save failed", false);
+            send_response_json("response", "mqtt", "error_partial", "save failed");
         }
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *load_settings = load_and_parse_json_settings(
-            "mqtt",
-            mqtt_params,
-            sizeof(mqtt_params) / sizeof(mqtt_params[0]));
-
-        if (load_settings != NULL)
-        {
-            send_response_json("response", "mqtt", "load_partial", load_settings, true);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Load failed");
-            send_response_json("response", "mqtt", "error_partial", "load failed", false);
-            return ESP_ERR_NOT_FOUND;
-        }
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "mqtt", "load_partial");
+        response_push_object(&writer, "data");
+        load_and_parse_json_settings(&writer,
+                                     mqtt_params,
+                                     sizeof(mqtt_params) / sizeof(mqtt_params[0]));
+        response_pop_object(&writer);
+        response_end(&writer);
     }
-    else if (strcmp(action->valuestring, "test_connection") == 0)
+    else if (request_equals(req, req->action, "test_connection"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in test request");
-            send_response_json("response", "mqtt", "mqtt_test_error", "\"missing 'data'\"", false);
+            send_response_json("response", "mqtt", "mqtt_test_error", "\"missing 'data'\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        cJSON *server_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "server");
-        cJSON *port_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "port");
-        cJSON *user_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "user");
-        cJSON *password_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "password");
+        char server[64];
+        char port[8];
+        char user[64];
+        char password[64];
 
-        if ((server_obj != NULL && cJSON_IsString(server_obj) && server_obj->valuestring != NULL) &&
-            (port_obj != NULL && cJSON_IsString(port_obj) && port_obj->valuestring != NULL) &&
-            (user_obj != NULL && cJSON_IsString(user_obj) && user_obj->valuestring != NULL) &&
-            (password_obj != NULL && cJSON_IsString(password_obj) && password_obj->valuestring != NULL))
+        if (request_copy_string(req, request_find(req, req->data, "server"), server, sizeof(server)) == ESP_OK &&
+            request_copy_string(req, request_find(req, req->data, "port"), port, sizeof(port)) == ESP_OK &&
+            request_copy_string(req, request_find(req, req->data, "user"), user, sizeof(user)) == ESP_OK &&
+            request_copy_string(req, request_find(req, req->data, "password"), password, sizeof(password)) == ESP_OK)
         {
             char mqtt_uri[64] = {0};
-            sniprintf(mqtt_uri, sizeof(mqtt_uri), "mqtt://%s:%s", server_obj->valuestring, port_obj->valuestring);
+            sniprintf(mqtt_uri, sizeof(mqtt_uri), "mqtt://%s:%s", server, port);
 
             mqtt_config_t mqtt_config = {
                 .server_uri = mqtt_uri,
                 .client_id = "esp32TestConnectionClient",
-                .username = user_obj->valuestring,
-                .password = password_obj->valuestring,
+                .username = user,
+                .password = password,
                 .auto_reconnect = false};
 
             mqtt_client_handle_t test_client = mqtt_client_start(&mqtt_config, mqtt_event_handler);
@@ -181,24 +146,24 @@ esp_err_t mqtt_module_target(cJSON *json)
             if (test_client != NULL)
             {
                 ESP_LOGI(TAG, "MQTT test connection success");
-                send_response_json("response", "mqtt", "mqtt_test_ok", "success test started", false);
+                send_response_json("response", "mqtt", "mqtt_test_ok", "success test started");
             }
             else
             {
                 ESP_LOGE(TAG, "MQTT test connection failed");
-                send_response_json("response", "mqtt", "mqtt_test_error", "failed test started", false);
+                send_response_json("response", "mqtt", "mqtt_test_error", "failed test started");
             }
         }
         else
         {
-            send_response_json("response", "mqtt", "mqtt_test_error", "value error", false);
+            send_response_json("response", "mqtt", "mqtt_test_error", "value error");
             return ESP_ERR_INVALID_ARG;
         }
     }
     else
     {
-        ESP_LOGW(TAG, "Unknown action: %s", action->valuestring);
-        send_response_json("response", "mqtt", "error_mqtt", "unknown action", false);
+        ESP_LOGW(TAG, "Unknown action: %.*s", request_token_len(req, req->action), request_token_ptr(req, req->action));
+        send_response_json("response", "mqtt", "error_mqtt", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
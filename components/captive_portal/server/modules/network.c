@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -21,95 +20,81 @@
 
 static const char *TAG = "network module";
 //=================================================================
-esp_err_t network_module_target(cJSON *json)
+esp_err_t network_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
         ESP_LOGW(TAG, "Invalid or missing 'action'");
-        send_response_json("response", "network", "error_partial", "\"invalid or missing 'action'\"", false);
+        send_response_json("response", "network", "error_partial", "\"invalid or missing 'action'\"");
         return ESP_ERR_INVALID_ARG;
     }
 
     esp_err_t result = ESP_OK;
 
-    if (strcmp(action->valuestring, "save_partial") == 0)
+    if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in save request");
-            send_response_json("response", "network", "error_partial", "missing 'data'", false);
+            send_response_json("response", "network", "error_partial", "missing 'data'");
             return ESP_ERR_INVALID_ARG;
         }
 
-        cJSON *mode_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "mode");
-
-        if (!cJSON_IsString(mode_obj) || mode_obj->valuestring == NULL)
+        char mode[8] = {0};
+        if (request_copy_string(req, request_find(req, req->data, "mode"), mode, sizeof(mode)) != ESP_OK)
         {
             ESP_LOGW(TAG, "Missing 'mode' in save request");
-            send_response_json("response", "network", "error_partial", "missing 'mode'", false);
+            send_response_json("response", "network", "error_partial", "missing 'mode'");
             return ESP_ERR_INVALID_ARG;
         }
 
         esp_err_t mode_result = ESP_FAIL;
         esp_err_t data_result = ESP_FAIL;
 
-        if (strcmp(mode_obj->valuestring, "dhcp") == 0)
+        if (strcmp(mode, "dhcp") == 0)
         {
             data_result = dwnvs_delete_ipinfo("network");
             mode_result = ESP_OK;
             data_result = ESP_OK;
         }
-        else if (strcmp(mode_obj->valuestring, "static") == 0)
+        else if (strcmp(mode, "static") == 0)
         {
             esp_netif_ip_info_t ip_info = {0};
 
-            cJSON *ip_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "ip");
-            cJSON *netmask_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "netmask");
-            cJSON *gateway_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "gateway");
+            char ip_str[16];
+            char netmask_str[16];
+            char gateway_str[16];
 
             // Проверим длину строк IP-адресов
-            if (ip_obj != NULL && cJSON_IsString(ip_obj) && ip_obj->valuestring != NULL)
+            esp_err_t ip_err = request_copy_string(req, request_find(req, req->data, "ip"), ip_str, sizeof(ip_str));
+            if (ip_err == ESP_ERR_INVALID_SIZE)
             {
-                size_t ip_len = strlen(ip_obj->valuestring);
-                if (ip_len > 15)
-                {
-                    ESP_LOGE(TAG, "IP address too long: %s", ip_obj->valuestring);
-                    send_response_json("response", "network", "error_partial", "IP address too long (max 15 chars)", false);
-                    return ESP_ERR_INVALID_ARG;
-                }
+                ESP_LOGE(TAG, "IP address too long");
+                send_response_json("response", "network", "error_partial", "IP address too long (max 15 chars)");
+                return ESP_ERR_INVALID_ARG;
             }
 
-            if (netmask_obj != NULL && cJSON_IsString(netmask_obj) && netmask_obj->valuestring != NULL)
+            esp_err_t netmask_err = request_copy_string(req, request_find(req, req->data, "netmask"), netmask_str, sizeof(netmask_str));
+            if (netmask_err == ESP_ERR_INVALID_SIZE)
             {
-                size_t netmask_len = strlen(netmask_obj->valuestring);
-                if (netmask_len > 15)
-                {
-                    ESP_LOGE(TAG, "Netmask too long: %s", netmask_obj->valuestring);
-                    send_response_json("response", "network", "error_partial", "Netmask too long (max 15 chars)", false);
-                    return ESP_ERR_INVALID_ARG;
-                }
+                ESP_LOGE(TAG, "Netmask too long");
+                send_response_json("response", "network", "error_partial", "Netmask too long (max 15 chars)");
+                return ESP_ERR_INVALID_ARG;
             }
 
-            if (gateway_obj != NULL && cJSON_IsString(gateway_obj) && gateway_obj->valuestring != NULL)
+            esp_err_t gateway_err = request_copy_string(req, request_find(req, req->data, "gateway"), gateway_str, sizeof(gateway_str));
+            if (gateway_err == ESP_ERR_INVALID_SIZE)
             {
-                size_t gateway_len = strlen(gateway_obj->valuestring);
-                if (gateway_len > 15)
-                {
-                    ESP_LOGE(TAG, "Gateway too long: %s", gateway_obj->valuestring);
-                    send_response_json("response", "network", "error_partial", "Gateway too long (max 15 chars)", false);
-                    return ESP_ERR_INVALID_ARG;
-                }
+                ESP_LOGE(TAG, "Gateway too long");
+                send_response_json("response", "network", "error_partial", "Gateway too long (max 15 chars)");
+                return ESP_ERR_INVALID_ARG;
             }
 
-            if ((ip_obj != NULL && cJSON_IsString(ip_obj) && ip_obj->valuestring != NULL) &&
-                (netmask_obj != NULL && cJSON_IsString(netmask_obj) && netmask_obj->valuestring != NULL) &&
-                (gateway_obj != NULL && cJSON_IsString(gateway_obj) && gateway_obj->valuestring != NULL))
+            if (ip_err == ESP_OK && netmask_err == ESP_OK && gateway_err == ESP_OK)
             {
-                if (inet_aton(ip_obj->valuestring, &ip_info.ip) &&
-                    inet_aton(netmask_obj->valuestring, &ip_info.netmask) &&
-                    inet_aton(gateway_obj->valuestring, &ip_info.gw))
+                if (inet_aton(ip_str, &ip_info.ip) &&
+                    inet_aton(netmask_str, &ip_info.netmask) &&
+                    inet_aton(gateway_str, &ip_info.gw))
                 {
                     data_result = dwnvs_save_ipinfo("network", &ip_info);
                 }
@@ -127,60 +112,59 @@ esp_err_t network_module_target(cJSON *json)
         else
         {
             ESP_LOGW(TAG, "Unknown 'mode' in save request");
-            send_response_json("response", "network", "error_partial", "Unknown 'mode'", false);
+            send_response_json("response", "network", "error_partial", "Unknown 'mode'");
             return ESP_ERR_INVALID_ARG;
         }
 
         if (mode_result == ESP_OK && data_result == ESP_OK)
         {
-            send_response_json("response", "network", "saved_partial", NULL, false);
+            send_response_json("response", "network", "saved_partial", NULL);
             result = ESP_OK;
         }
         else
         {
             ESP_LOGE(TAG, "Save failed: mode_result=%s, data_result=%s",
                      esp_err_to_name(mode_result), esp_err_to_name(data_result));
-            send_response_json("response", "network", "error_partial", "save failed", false);
+            send_response_json("response", "network", "error_partial", "save failed");
             result = ESP_FAIL;
         }
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *data_obj = cJSON_CreateObject();
-        if (!data_obj)
-        {
-            ESP_LOGE(TAG, "Failed to create data object");
-            return ESP_ERR_NO_MEM;
-        }
-
         esp_netif_ip_info_t ip_info = {0};
 
         char ip_str[IP4ADDR_STRLEN_MAX];
         char gw_str[IP4ADDR_STRLEN_MAX];
         char nm_str[IP4ADDR_STRLEN_MAX];
 
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "network", "load_partial");
+        response_push_object(&writer, "data");
+
         if (dwnvs_load_ipinfo("network", &ip_info) == ESP_OK)
         {
             ip4addr_ntoa_r((const ip4_addr_t *)&ip_info.ip, ip_str, IP4ADDR_STRLEN_MAX);
             ip4addr_ntoa_r((const ip4_addr_t *)&ip_info.gw, gw_str, IP4ADDR_STRLEN_MAX);
             ip4addr_ntoa_r((const ip4_addr_t *)&ip_info.netmask, nm_str, IP4ADDR_STRLEN_MAX);
 
-            cJSON_AddStringToObject(data_obj, "mode", "static");
-            cJSON_AddStringToObject(data_obj, "ip", ip_str);
-            cJSON_AddStringToObject(data_obj, "gateway", gw_str);
-            cJSON_AddStringToObject(data_obj, "netmask", nm_str);
+            response_set_string(&writer, "mode", "static");
+            response_set_string(&writer, "ip", ip_str);
+            response_set_string(&writer, "gateway", gw_str);
+            response_set_string(&writer, "netmask", nm_str);
         }
         else
         {
-            cJSON_AddStringToObject(data_obj, "mode", "dhcp");
+            response_set_string(&writer, "mode", "dhcp");
         }
 
-        send_response_json("response", "network", "load_partial", data_obj, true);
+        response_pop_object(&writer);
+        response_end(&writer);
     }
     else
     {
-        ESP_LOGW(TAG, "Unknown action: %s", action->valuestring);
-        send_response_json("response", "network", "error_partial", "\"unknown action\"", false);
+        ESP_LOGW(TAG, "Unknown action: %.*s", request_token_len(req, req->action), request_token_ptr(req, req->action));
+        send_response_json("response", "network", "error_partial", "\"unknown action\"");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -0,0 +1,508 @@
+#include <string.h>
+#include <ctype.h>
+#include "esp_log.h"
+#include "request_parser.h"
+
+static const char *TAG = "REQPARSER";
+
+//=================================================================
+static req_token_t *request_alloc_token(request_t *req, req_tok_type_t type, int start, int end)
+{
+    if (req->count >= REQUEST_MAX_TOKENS)
+        return NULL;
+
+    req_token_t *tok = &req->tokens[req->count++];
+    tok->type = type;
+    tok->start = start;
+    tok->end = end;
+    tok->size = 0;
+    return tok;
+}
+
+//=================================================================
+static esp_err_t request_parse_string(request_t *req, const char *json, size_t len, size_t *pos)
+{
+    size_t start = *pos;
+
+    for (size_t i = start + 1; i < len && json[i] != '\0'; i++)
+    {
+        char c = json[i];
+
+        if (c == '"')
+        {
+            if (request_alloc_token(req, REQ_TOK_STRING, start + 1, i) == NULL)
+                return ESP_ERR_NO_MEM;
+            *pos = i;
+            return ESP_OK;
+        }
+
+        if (c != '\\')
+            continue;
+
+        if (++i >= len)
+            break;
+
+        switch (json[i])
+        {
+        case '"':
+        case '/':
+        case '\\':
+        case 'b':
+        case 'f':
+        case 'r':
+        case 'n':
+        case 't':
+            break;
+        case 'u':
+            for (int k = 0; k < 4; k++)
+            {
+                if (++i >= len || !isxdigit((unsigned char)json[i]))
+                    return ESP_ERR_INVALID_ARG;
+            }
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    return ESP_ERR_INVALID_ARG; // Незакрытая строка
+}
+
+//=================================================================
+static esp_err_t request_parse_primitive(request_t *req, const char *json, size_t len, size_t *pos)
+{
+    size_t start = *pos;
+
+    for (size_t i = start; i < len && json[i] != '\0'; i++)
+    {
+        switch (json[i])
+        {
+        case '\t':
+        case '\r':
+        case '\n':
+        case ' ':
+        case ',':
+        case ']':
+        case '}':
+            if (request_alloc_token(req, REQ_TOK_PRIMITIVE, start, i) == NULL)
+                return ESP_ERR_NO_MEM;
+            *pos = i - 1;
+            return ESP_OK;
+        default:
+            if (json[i] < 32 || json[i] >= 127)
+                return ESP_ERR_INVALID_ARG;
+            break;
+        }
+    }
+
+    return ESP_ERR_INVALID_ARG; // Значение вне объекта
+}
+
+//=================================================================
+esp_err_t request_parse(request_t *req, const char *json, size_t len)
+{
+    if (req == NULL || json == NULL || len == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    req->json = json;
+    req->len = 0;
+    req->count = 0;
+    req->action = -1;
+    req->data = -1;
+
+    if (len > INT16_MAX)
+        return ESP_ERR_INVALID_SIZE;
+
+    int super = -1; // Токен, которому принадлежит следующее значение
+    esp_err_t err;
+
+    for (size_t pos = 0; pos < len && json[pos] != '\0'; pos++)
+    {
+        char c = json[pos];
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+            if (super != -1)
+            {
+                // Ключ объекта может быть только строкой
+                if (req->tokens[super].type == REQ_TOK_OBJECT)
+                    return ESP_ERR_INVALID_ARG;
+                req->tokens[super].size++;
+            }
+            if (request_alloc_token(req, c == '{' ? REQ_TOK_OBJECT : REQ_TOK_ARRAY, pos, -1) == NULL)
+                return ESP_ERR_NO_MEM;
+            super = req->count - 1;
+            break;
+
+        case '}':
+        case ']':
+        {
+            req_tok_type_t type = (c == '}') ? REQ_TOK_OBJECT : REQ_TOK_ARRAY;
+            int i;
+
+            // Закрываем последний незакрытый контейнер
+            for (i = req->count - 1; i >= 0; i--)
+            {
+                req_token_t *tok = &req->tokens[i];
+                if (tok->start != -1 && tok->end == -1)
+                {
+                    if (tok->type != type)
+                        return ESP_ERR_INVALID_ARG;
+                    tok->end = pos + 1;
+                    super = -1;
+                    break;
+                }
+            }
+            if (i == -1)
+                return ESP_ERR_INVALID_ARG;
+
+            // Родителем снова становится внешний незакрытый контейнер
+            for (; i >= 0; i--)
+            {
+                req_token_t *tok = &req->tokens[i];
+                if (tok->start != -1 && tok->end == -1)
+                {
+                    super = i;
+                    break;
+                }
+            }
+            break;
+        }
+
+        case '"':
+            err = request_parse_string(req, json, len, &pos);
+            if (err != ESP_OK)
+                return err;
+            if (super != -1)
+                req->tokens[super].size++;
+            break;
+
+        case '\t':
+        case '\r':
+        case '\n':
+        case ' ':
+            break;
+
+        case ':':
+            super = req->count - 1;
+            break;
+
+        case ',':
+            if (super != -1 &&
+                req->tokens[super].type != REQ_TOK_ARRAY &&
+                req->tokens[super].type != REQ_TOK_OBJECT)
+            {
+                for (int i = req->count - 1; i >= 0; i--)
+                {
+                    req_token_t *tok = &req->tokens[i];
+                    if ((tok->type == REQ_TOK_ARRAY || tok->type == REQ_TOK_OBJECT) &&
+                        tok->start != -1 && tok->end == -1)
+                    {
+                        super = i;
+                        break;
+                    }
+                }
+            }
+            break;
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case 't':
+        case 'f':
+        case 'n':
+            if (super != -1)
+            {
+                req_token_t *tok = &req->tokens[super];
+                if (tok->type == REQ_TOK_OBJECT || (tok->type == REQ_TOK_STRING && tok->size != 0))
+                    return ESP_ERR_INVALID_ARG;
+            }
+            err = request_parse_primitive(req, json, len, &pos);
+            if (err != ESP_OK)
+                return err;
+            if (super != -1)
+                req->tokens[super].size++;
+            break;
+
+        default:
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (req->count == 0 || req->tokens[0].type != REQ_TOK_OBJECT)
+        return ESP_ERR_INVALID_ARG;
+
+    for (int i = 0; i < req->count; i++)
+    {
+        if (req->tokens[i].end == -1)
+            return ESP_ERR_INVALID_ARG; // Незакрытый объект или массив
+    }
+
+    req->len = req->tokens[0].end;
+    req->action = request_find(req, 0, "action");
+    req->data = request_find(req, 0, "data");
+
+    ESP_LOGD(TAG, "Parsed %d tokens", req->count);
+    return ESP_OK;
+}
+
+//=================================================================
+int request_skip(const request_t *req, int tok)
+{
+    int end = req->tokens[tok].end;
+    int i = tok + 1;
+
+    while (i < req->count && req->tokens[i].start < end)
+        i++;
+
+    return i;
+}
+
+//=================================================================
+int request_find(const request_t *req, int object, const char *key)
+{
+    if (!request_is_object(req, object) || key == NULL)
+        return -1;
+
+    int tok = object + 1;
+    for (int i = 0; i < req->tokens[object].size && tok + 1 < req->count; i++)
+    {
+        if (request_equals(req, tok, key))
+            return tok + 1;
+        tok = request_skip(req, tok + 1);
+    }
+
+    return -1;
+}
+
+//=================================================================
+bool request_is_string(const request_t *req, int tok)
+{
+    return tok >= 0 && tok < req->count && req->tokens[tok].type == REQ_TOK_STRING;
+}
+
+//=================================================================
+bool request_is_object(const request_t *req, int tok)
+{
+    return tok >= 0 && tok < req->count && req->tokens[tok].type == REQ_TOK_OBJECT;
+}
+
+//=================================================================
+bool request_equals(const request_t *req, int tok, const char *str)
+{
+    if (!request_is_string(req, tok) || str == NULL)
+        return false;
+
+    size_t len = req->tokens[tok].end - req->tokens[tok].start;
+    return strlen(str) == len && memcmp(req->json + req->tokens[tok].start, str, len) == 0;
+}
+
+//=================================================================
+const char *request_token_ptr(const request_t *req, int tok)
+{
+    if (tok < 0 || tok >= req->count)
+        return "";
+    return req->json + req->tokens[tok].start;
+}
+
+//=================================================================
+int request_token_len(const request_t *req, int tok)
+{
+    if (tok < 0 || tok >= req->count)
+        return 0;
+    return req->tokens[tok].end - req->tokens[tok].start;
+}
+
+//=================================================================
+static uint32_t request_hex4(const char *src)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        char c = src[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            value |= c - 'a' + 10;
+        else
+            value |= c - 'A' + 10;
+    }
+
+    return value;
+}
+
+//=================================================================
+// Раскрывает escape-последовательности строки. При out == NULL только считает длину
+static esp_err_t request_unescape(const request_t *req, int tok, char *out, size_t out_size, size_t *out_len)
+{
+    const char *src = req->json + req->tokens[tok].start;
+    const char *end = req->json + req->tokens[tok].end;
+    size_t n = 0;
+
+    while (src < end)
+    {
+        char utf8[4];
+        size_t utf8_len = 1;
+
+        utf8[0] = *src++;
+        if (utf8[0] == '\\')
+        {
+            char c = *src++;
+            switch (c)
+            {
+            case 'b':
+                utf8[0] = '\b';
+                break;
+            case 'f':
+                utf8[0] = '\f';
+                break;
+            case 'n':
+                utf8[0] = '\n';
+                break;
+            case 'r':
+                utf8[0] = '\r';
+                break;
+            case 't':
+                utf8[0] = '\t';
+                break;
+            case 'u':
+            {
+                uint32_t cp = request_hex4(src);
+                src += 4;
+
+                // Суррогатная пара
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - src >= 6 && src[0] == '\\' && src[1] == 'u')
+                {
+                    uint32_t low = request_hex4(src + 2);
+                    if (low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        src += 6;
+                    }
+                }
+
+                if (cp < 0x80)
+                {
+                    utf8[0] = cp;
+                }
+                else if (cp < 0x800)
+                {
+                    utf8[0] = 0xC0 | (cp >> 6);
+                    utf8[1] = 0x80 | (cp & 0x3F);
+                    utf8_len = 2;
+                }
+                else if (cp < 0x10000)
+                {
+                    utf8[0] = 0xE0 | (cp >> 12);
+                    utf8[1] = 0x80 | ((cp >> 6) & 0x3F);
+                    utf8[2] = 0x80 | (cp & 0x3F);
+                    utf8_len = 3;
+                }
+                else
+                {
+                    utf8[0] = 0xF0 | (cp >> 18);
+                    utf8[1] = 0x80 | ((cp >> 12) & 0x3F);
+                    utf8[2] = 0x80 | ((cp >> 6) & 0x3F);
+                    utf8[3] = 0x80 | (cp & 0x3F);
+                    utf8_len = 4;
+                }
+                break;
+            }
+            default:
+                utf8[0] = c; // '"', '\\', '/'
+                break;
+            }
+        }
+
+        if (out != NULL)
+        {
+            if (n + utf8_len >= out_size)
+            {
+                out[0] = '\0';
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(out + n, utf8, utf8_len);
+        }
+        n += utf8_len;
+    }
+
+    if (out != NULL)
+        out[n] = '\0';
+    if (out_len != NULL)
+        *out_len = n;
+    return ESP_OK;
+}
+
+//=================================================================
+esp_err_t request_copy_string(const request_t *req, int tok, char *out, size_t out_size)
+{
+    if (!request_is_string(req, tok) || out == NULL || out_size == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    return request_unescape(req, tok, out, out_size, NULL);
+}
+
+//=================================================================
+esp_err_t request_get_int(const request_t *req, int tok, int *out)
+{
+    if (tok < 0 || tok >= req->count || req->tokens[tok].type != REQ_TOK_PRIMITIVE || out == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    const char *p = req->json + req->tokens[tok].start;
+    const char *end = req->json + req->tokens[tok].end;
+    bool negative = false;
+    int32_t value = 0;
+
+    if (p < end && *p == '-')
+    {
+        negative = true;
+        p++;
+    }
+    if (p == end)
+        return ESP_ERR_INVALID_ARG;
+
+    for (; p < end; p++)
+    {
+        if (!isdigit((unsigned char)*p))
+            return ESP_ERR_INVALID_ARG;
+        int digit = *p - '0';
+        // Проверка до умножения: переполнение int32_t - неопределённое поведение
+        if (value > (INT32_MAX - digit) / 10)
+            return ESP_ERR_INVALID_SIZE;
+        value = value * 10 + digit;
+    }
+
+    *out = negative ? -(int)value : (int)value;
+    return ESP_OK;
+}
+
+//=================================================================
+int request_find_long_string(const request_t *req, int object, size_t max_len)
+{
+    if (!request_is_object(req, object))
+        return -1;
+
+    int tok = object + 1;
+    for (int i = 0; i < req->tokens[object].size && tok + 1 < req->count; i++)
+    {
+        size_t len = 0;
+        if (request_is_string(req, tok + 1) &&
+            request_unescape(req, tok + 1, NULL, 0, &len) == ESP_OK && len > max_len)
+            return tok;
+        tok = request_skip(req, tok + 1);
+    }
+
+    return -1;
+}
@@ -0,0 +1,97 @@
+#ifndef __REQPARSE_H
+#define __REQPARSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Максимальное число токенов в одном запросе (объекты, ключи и значения)
+#define REQUEST_MAX_TOKENS 64
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        REQ_TOK_UNDEFINED = 0,
+        REQ_TOK_OBJECT,
+        REQ_TOK_ARRAY,
+        REQ_TOK_STRING,
+        REQ_TOK_PRIMITIVE,
+    } req_tok_type_t;
+
+    /**
+     * @brief Токен разобранного запроса.
+     *
+     * Токен хранит только границы значения в исходном буфере.
+     * Для строк границы не включают кавычки, escape-последовательности не раскрыты.
+     */
+    typedef struct
+    {
+        uint8_t type;
+        int16_t start;
+        int16_t end;
+        uint16_t size; // Для объекта - число ключей, для массива - элементов, для ключа - 1
+    } req_token_t;
+
+    /**
+     * @brief Разобранный запрос WebSocket.
+     *
+     * Токены лежат в фиксированном массиве, куча при разборе не используется.
+     * Буфер json должен жить, пока используется запрос.
+     */
+    typedef struct
+    {
+        const char *json;
+        size_t len; // Длина корневого объекта в буфере json
+        req_token_t tokens[REQUEST_MAX_TOKENS];
+        int count;
+        int action; // Индекс токена значения "action" или -1
+        int data;   // Индекс токена значения "data" или -1
+    } request_t;
+
+    /**
+     * @brief Разбирает JSON-запрос. Корнем обязан быть объект.
+     *
+     * @return ESP_OK, ESP_ERR_NO_MEM при нехватке токенов, ESP_ERR_INVALID_ARG при ошибке синтаксиса
+     */
+    esp_err_t request_parse(request_t *req, const char *json, size_t len);
+
+    // Индекс значения ключа key в объекте object или -1
+    int request_find(const request_t *req, int object, const char *key);
+    // Индекс токена, следующего за токеном tok вместе со всеми вложенными
+    int request_skip(const request_t *req, int tok);
+
+    bool request_is_string(const request_t *req, int tok);
+    bool request_is_object(const request_t *req, int tok);
+    bool request_equals(const request_t *req, int tok, const char *str);
+
+    // Сырые границы токена для логов (формат "%.*s")
+    const char *request_token_ptr(const request_t *req, int tok);
+    int request_token_len(const request_t *req, int tok);
+
+    /**
+     * @brief Копирует строковое значение с раскрытием escape-последовательностей.
+     *
+     * @return ESP_OK, ESP_ERR_INVALID_ARG если токен не строка, ESP_ERR_INVALID_SIZE если не помещается
+     */
+    esp_err_t request_copy_string(const request_t *req, int tok, char *out, size_t out_size);
+
+    /**
+     * @brief Читает целое число из примитива (без дробной части и экспоненты).
+     *
+     * @return ESP_OK, ESP_ERR_INVALID_ARG если токен не целое число, ESP_ERR_INVALID_SIZE при переполнении
+     */
+    esp_err_t request_get_int(const request_t *req, int tok, int *out);
+
+    // Индекс ключа первого строкового поля объекта длиннее max_len символов или -1
+    int request_find_long_string(const request_t *req, int object, size_t max_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __REQPARSE_H
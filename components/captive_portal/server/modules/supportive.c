@@ -1,38 +1,333 @@
-#include "cJSON.h"
+#include <stdio.h>
+#include <string.h>
 #include "esp_log.h"
 #include "server/server.h"
+#include "modules.h"
+
+static const char *TAG = "Response";
+
+// Старшие биты начального байта CBOR
+#define CBOR_UINT (0 << 5)
+#define CBOR_NEGINT (1 << 5)
+#define CBOR_TEXT (3 << 5)
+#define CBOR_ARRAY (4 << 5)
+#define CBOR_MAP (5 << 5)
+
+#define CBOR_INDEFINITE 31 // Контейнер неизвестной длины, закрывается CBOR_BREAK
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_NULL 0xF6
+#define CBOR_BREAK 0xFF
+
+//=================================================================
+// Ставит накопленный фрагмент в очередь WebSocket
+static void response_emit(response_writer_t *writer, const char *data, size_t len)
+{
+    bool first = (writer->chunks == 0);
+    bool final = writer->closing;
+
+    writer->chunks++;
+
+    if (writer->failed)
+        return;
+
+    // Сообщение целиком поместилось в буфер - обычный кадр
+    if (first && final)
+    {
+        bool sent;
+        if (writer->event)
+            sent = ws_server_send_event(data, len, writer->cbor, writer->key);
+        else
+            sent = writer->cbor ? ws_server_send_binary(data, len) : ws_server_send_string(data);
+        if (!sent)
+            writer->failed = true;
+        return;
+    }
+
+    if (!ws_server_send_fragment(data, len, writer->cbor, first, final))
+    {
+        ESP_LOGW(TAG, "Fragment %u dropped, response aborted", writer->chunks);
+        writer->failed = true;
+    }
+}
+
+//=================================================================
+// Вызывается генератором при заполнении буфера и из json_gen_str_end()
+static void response_flush_cb(char *buf, void *priv)
+{
+    response_writer_t *writer = (response_writer_t *)priv;
+
+    response_emit(writer, buf, strlen(buf));
+}
+
+//=================================================================
+static void cbor_write(response_writer_t *writer, const void *data, size_t len)
+{
+    const uint8_t *src = data;
+
+    while (len > 0)
+    {
+        if (writer->used == RESPONSE_CHUNK_SIZE)
+        {
+            response_emit(writer, writer->buf, writer->used);
+            writer->used = 0;
+        }
+
+        size_t n = RESPONSE_CHUNK_SIZE - writer->used;
+        if (n > len)
+            n = len;
+
+        memcpy(writer->buf + writer->used, src, n);
+        writer->used += n;
+        src += n;
+        len -= n;
+    }
+}
+
+//=================================================================
+static void cbor_byte(response_writer_t *writer, uint8_t value)
+{
+    cbor_write(writer, &value, 1);
+}
 
 //=================================================================
-void send_response_json(const char *type, const char *target, const char *status, const void *message, bool isObject)
+// Начальный байт с аргументом в кратчайшей форме
+static void cbor_head(response_writer_t *writer, uint8_t major, uint32_t value)
 {
-    cJSON *response = cJSON_CreateObject();
-    if (!response)
+    uint8_t head[5];
+    size_t len;
+
+    if (value < 24)
+    {
+        head[0] = major | value;
+        len = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        head[0] = major | 24;
+        head[1] = value;
+        len = 2;
+    }
+    else if (value <= 0xFFFF)
     {
+        head[0] = major | 25;
+        head[1] = value >> 8;
+        head[2] = value;
+        len = 3;
+    }
+    else
+    {
+        head[0] = major | 26;
+        head[1] = value >> 24;
+        head[2] = value >> 16;
+        head[3] = value >> 8;
+        head[4] = value;
+        len = 5;
+    }
+
+    cbor_write(writer, head, len);
+}
+
+//=================================================================
+static void cbor_text(response_writer_t *writer, const char *str)
+{
+    size_t len = strlen(str);
+
+    cbor_head(writer, CBOR_TEXT, len);
+    cbor_write(writer, str, len);
+}
+
+//=================================================================
+static void cbor_int(response_writer_t *writer, int value)
+{
+    if (value < 0)
+        cbor_head(writer, CBOR_NEGINT, (uint32_t)(-1 - (int64_t)value));
+    else
+        cbor_head(writer, CBOR_UINT, value);
+}
+
+//=================================================================
+void response_begin(response_writer_t *writer, const char *type, const char *target, const char *status)
+{
+    writer->chunks = 0;
+    writer->used = 0;
+    writer->closing = false;
+    writer->failed = false;
+    writer->cbor = (ws_server_encoding() == WS_ENCODING_CBOR);
+    writer->buf[RESPONSE_CHUNK_SIZE] = '\0';
+
+    // Событие статуса можно заменить более свежим, ответ на запрос - нет
+    writer->event = (strcmp(type, "event") == 0);
+    snprintf(writer->key, sizeof(writer->key), "%s/%s", target ? target : "", status);
+
+    // Результат фоновой задачи уходит событием с номером задачи
+    uint32_t job_id = ws_jobs_current_id();
+    if (job_id != 0 && strcmp(type, "response") == 0)
+        type = "event";
+
+    if (writer->cbor)
+    {
+        cbor_byte(writer, CBOR_MAP | CBOR_INDEFINITE);
+        response_set_string(writer, "type", type);
+        if (target)
+            response_set_string(writer, "target", target);
+        response_set_string(writer, "status", status);
+        if (job_id != 0)
+            response_set_int(writer, "job", job_id);
         return;
     }
 
-    cJSON_AddStringToObject(response, "type", type);
+    json_gen_str_start(&writer->jstr, writer->buf, RESPONSE_CHUNK_SIZE, response_flush_cb, writer);
+    json_gen_start_object(&writer->jstr);
+    json_gen_obj_set_string(&writer->jstr, "type", type);
     if (target)
-        cJSON_AddStringToObject(response, "target", target);
-    cJSON_AddStringToObject(response, "status", status);
+        json_gen_obj_set_string(&writer->jstr, "target", target);
+    json_gen_obj_set_string(&writer->jstr, "status", status);
+    if (job_id != 0)
+        json_gen_obj_set_int(&writer->jstr, "job", job_id);
+}
+
+//=================================================================
+esp_err_t response_end(response_writer_t *writer)
+{
+    if (writer->cbor)
+    {
+        cbor_byte(writer, CBOR_BREAK);
+        writer->closing = true;
+        response_emit(writer, writer->buf, writer->used);
+        return writer->failed ? ESP_FAIL : ESP_OK;
+    }
+
+    json_gen_end_object(&writer->jstr);
+    writer->closing = true;
+    json_gen_str_end(&writer->jstr);
+
+    return writer->failed ? ESP_FAIL : ESP_OK;
+}
+
+//=================================================================
+void response_push_object(response_writer_t *writer, const char *name)
+{
+    if (writer->cbor)
+    {
+        cbor_text(writer, name);
+        cbor_byte(writer, CBOR_MAP | CBOR_INDEFINITE);
+        return;
+    }
+    json_gen_push_object(&writer->jstr, name);
+}
+
+//=================================================================
+void response_pop_object(response_writer_t *writer)
+{
+    if (writer->cbor)
+    {
+        cbor_byte(writer, CBOR_BREAK);
+        return;
+    }
+    json_gen_pop_object(&writer->jstr);
+}
+
+//=================================================================
+void response_push_array(response_writer_t *writer, const char *name)
+{
+    if (writer->cbor)
+    {
+        cbor_text(writer, name);
+        cbor_byte(writer, CBOR_ARRAY | CBOR_INDEFINITE);
+        return;
+    }
+    json_gen_push_array(&writer->jstr, name);
+}
+
+//=================================================================
+void response_pop_array(response_writer_t *writer)
+{
+    if (writer->cbor)
+    {
+        cbor_byte(writer, CBOR_BREAK);
+        return;
+    }
+    json_gen_pop_array(&writer->jstr);
+}
+
+//=================================================================
+void response_array_start_object(response_writer_t *writer)
+{
+    if (writer->cbor)
+    {
+        cbor_byte(writer, CBOR_MAP | CBOR_INDEFINITE);
+        return;
+    }
+    json_gen_start_object(&writer->jstr);
+}
 
-    if (message && !isObject)
+//=================================================================
+void response_array_end_object(response_writer_t *writer)
+{
+    if (writer->cbor)
     {
-        char *message_str = (char *)message;
-        cJSON_AddStringToObject(response, "data", message_str);
+        cbor_byte(writer, CBOR_BREAK);
+        return;
     }
-    else if (message && isObject)
+    json_gen_end_object(&writer->jstr);
+}
+
+//=================================================================
+void response_set_string(response_writer_t *writer, const char *name, const char *value)
+{
+    if (writer->cbor)
     {
-        cJSON *message_obj = (cJSON *)message;
-        cJSON_AddItemToObject(response, "data", message_obj);
+        cbor_text(writer, name);
+        cbor_text(writer, value);
+        return;
     }
+    json_gen_obj_set_string(&writer->jstr, name, value);
+}
 
-    char *json_str = cJSON_PrintUnformatted(response);
-    cJSON_Delete(response);
+//=================================================================
+void response_set_int(response_writer_t *writer, const char *name, int value)
+{
+    if (writer->cbor)
+    {
+        cbor_text(writer, name);
+        cbor_int(writer, value);
+        return;
+    }
+    json_gen_obj_set_int(&writer->jstr, name, value);
+}
+
+//=================================================================
+void response_set_bool(response_writer_t *writer, const char *name, bool value)
+{
+    if (writer->cbor)
+    {
+        cbor_text(writer, name);
+        cbor_byte(writer, value ? CBOR_TRUE : CBOR_FALSE);
+        return;
+    }
+    json_gen_obj_set_bool(&writer->jstr, name, value);
+}
 
-    if (json_str)
+//=================================================================
+void response_set_null(response_writer_t *writer, const char *name)
+{
+    if (writer->cbor)
     {
-        ws_server_send_string(json_str);
-        cJSON_free(json_str);
+        cbor_text(writer, name);
+        cbor_byte(writer, CBOR_NULL);
+        return;
     }
-}
\ No newline at end of file
+    json_gen_obj_set_null(&writer->jstr, name);
+}
+
+//=================================================================
+void send_response_json(const char *type, const char *target, const char *status, const char *message)
+{
+    response_writer_t writer;
+
+    response_begin(&writer, type, target, status);
+    if (message)
+        response_set_string(&writer, "data", message);
+    response_end(&writer);
+}
@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -22,37 +21,34 @@ static const char *TAG = "update module";
 //=================================================================
 static void ota_update_process(void *pvParameters) {}
 //=================================================================
-esp_err_t update_module_target(cJSON *json)
+esp_err_t update_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
         ESP_LOGW(TAG, "Invalid or missing 'action'");
-        send_response_json("response", "update", "error_update", "\"invalid or missing 'action'\"", false);
+        send_response_json("response", "update", "error_update", "\"invalid or missing 'action'\"");
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (strcmp(action->valuestring, "start_update") == 0)
+    if (request_equals(req, req->action, "start_update"))
     {
     }
-    else if (strcmp(action->valuestring, "load_partial") == 0)
+    else if (request_equals(req, req->action, "load_partial"))
     {
-        cJSON *data_obj = cJSON_CreateObject();
-        if (!data_obj)
-        {
-            ESP_LOGE(TAG, "Failed to create data object");
-            return ESP_ERR_NO_MEM;
-        }
-
         const esp_app_desc_t *app = esp_app_get_description();
         const esp_bootloader_desc_t *boot = esp_bootloader_get_description();
 
-        cJSON_AddStringToObject(data_obj, "application", app->version);
         char boot_version[8] = {0};
         snprintf(boot_version, sizeof(boot_version), "%lu", boot->version);
-        cJSON_AddStringToObject(data_obj, "bootloader", boot_version);
 
-        send_response_json("response", "update", "load_partial", data_obj, true);
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "update", "load_partial");
+        response_push_object(&writer, "data");
+        response_set_string(&writer, "application", app->version);
+        response_set_string(&writer, "bootloader", boot_version);
+        response_pop_object(&writer);
+        response_end(&writer);
     }
 
     return ESP_OK;
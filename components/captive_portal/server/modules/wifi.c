@@ -1,5 +1,4 @@
 #include "esp_err.h"
-#include "cJSON.h"
 #include "nvs_settings.h"
 #include "string.h"
 #include "server/server.h"
@@ -19,12 +18,13 @@
 #include "data_parser.h"
 
 #define DISCONNECT_BY_USER (BIT1)
+#define SCAN_PAGE_SIZE 8 // Сетей в одном сообщении ap_scan_result
 
 static const char *TAG = "Wifi module";
 static EventGroupHandle_t captive_wifi_group = NULL;
 
-static const config_param_t wifi_params[] = {
-    {"standalone", "standalone"},
+static const setting_id_t wifi_params[] = {
+    SETTING_WIFI_STANDALONE,
 };
 //=================================================================
 static esp_err_t ap_status(const char *type)
@@ -49,67 +49,46 @@ static esp_err_t ap_status(const char *type)
         esp_ip4addr_ntoa(&ip_info.netmask, nm_str, sizeof(nm_str));
     }
 
-    cJSON *data_obj = cJSON_CreateObject();
-    if (!data_obj)
-    {
-        ESP_LOGE(TAG, "Failed to create data object");
-        return ESP_ERR_NO_MEM;
-    }
-
-    cJSON *conn_obj = cJSON_CreateObject();
-    if (conn_obj)
-    {
-        cJSON_AddStringToObject(conn_obj, "ssid", ssid_str);
-        cJSON_AddStringToObject(conn_obj, "ip", ip_str);
-        cJSON_AddStringToObject(conn_obj, "gateway", gw_str);
-        cJSON_AddStringToObject(conn_obj, "netmask", nm_str);
+    // Результат фоновой проверки интернета, запрос в сеть здесь не выполняется
+    bool ethernet = (dw_check_internet_connection() == ESP_OK);
 
-        esp_err_t eth_status = dw_check_internet_connection();
+    const esp_app_desc_t *app = esp_app_get_description();
+    const esp_bootloader_desc_t *boot = esp_bootloader_get_description();
 
-        if (eth_status == ESP_OK)
-        {
-            cJSON_AddBoolToObject(conn_obj, "ethernet", true);
-        }
-        else
-        {
-            cJSON_AddBoolToObject(conn_obj, "ethernet", false);
-        }
-
-        cJSON_AddItemToObject(data_obj, "connect", conn_obj);
+    char boot_version[16] = "unknown";
+    if (boot)
+    {
+        snprintf(boot_version, sizeof(boot_version), "%lu", boot->version);
     }
 
-    cJSON *version_obj = cJSON_CreateObject();
-    if (version_obj)
-    {
-        const esp_app_desc_t *app = esp_app_get_description();
-        const esp_bootloader_desc_t *boot = esp_bootloader_get_description();
+    response_writer_t writer;
 
-        if (app)
-        {
-            cJSON_AddStringToObject(version_obj, "application", app->version);
-        }
-        else
-        {
-            cJSON_AddStringToObject(version_obj, "application", "unknown");
-        }
+    response_begin(&writer, type, "wifi", "ap_status");
+    response_push_object(&writer, "data");
 
-        if (boot)
-        {
-            char boot_version[16] = {0};
-            snprintf(boot_version, sizeof(boot_version), "%lu", boot->version);
-            cJSON_AddStringToObject(version_obj, "bootloader", boot_version);
-        }
-        else
-        {
-            cJSON_AddStringToObject(version_obj, "bootloader", "unknown");
-        }
+    response_push_object(&writer, "connect");
+    response_set_string(&writer, "ssid", ssid_str);
+    response_set_string(&writer, "ip", ip_str);
+    response_set_string(&writer, "gateway", gw_str);
+    response_set_string(&writer, "netmask", nm_str);
+    response_set_bool(&writer, "ethernet", ethernet);
+    response_pop_object(&writer);
 
-        cJSON_AddItemToObject(data_obj, "version", version_obj);
-    }
+    response_push_object(&writer, "version");
+    response_set_string(&writer, "application", app ? app->version : "unknown");
+    response_set_string(&writer, "bootloader", boot_version);
+    response_pop_object(&writer);
 
-    send_response_json(type, "wifi", "ap_status", data_obj, true);
+    response_pop_object(&writer);
+    return response_end(&writer);
+}
 
-    return ESP_OK;
+//=================================================================
+// Первая проверка после подключения завершается позже GOT_IP: статус отправляется повторно
+void wifi_module_internet_changed(esp_err_t result)
+{
+    ESP_LOGI(TAG, "Internet check result changed: %s", esp_err_to_name(result));
+    ap_status("event");
 }
 
 //=================================================================
@@ -117,7 +96,7 @@ static void wifi_scan_done_handler(void *arg, esp_event_base_t event_base, int32
 {
     uint16_t ap_count = 0;
 
-    esp_err_t err = dw_station_scan_result(&ap_count, NULL);
+    esp_err_t err = dw_station_scan_page(0, NULL, 0, NULL, &ap_count);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to get scan result count: %s", esp_err_to_name(err));
@@ -126,16 +105,13 @@ static void wifi_scan_done_handler(void *arg, esp_event_base_t event_base, int32
 
     ESP_LOGI(TAG, "Scan completed: %u networks found", ap_count);
 
-    cJSON *data_obj = cJSON_CreateObject();
-    if (!data_obj)
-    {
-        ESP_LOGE(TAG, "Failed to create data object");
-        goto cleanup;
-    }
-
-    cJSON_AddNumberToObject(data_obj, "count", ap_count);
+    response_writer_t writer;
 
-    send_response_json("event", "wifi", "ap_scan_success", data_obj, true);
+    response_begin(&writer, "event", "wifi", "ap_scan_success");
+    response_push_object(&writer, "data");
+    response_set_int(&writer, "count", ap_count);
+    response_pop_object(&writer);
+    response_end(&writer);
 
 cleanup:
     return; // arg всегда NULL, освобождать нечего
@@ -176,28 +152,22 @@ static void captive_sta_event_handler(void *arg, esp_event_base_t event_base, in
             esp_ip4addr_ntoa(&ip_info.netmask, nm_str, sizeof(nm_str));
         }
 
-        cJSON *data_obj = cJSON_CreateObject();
-        if (data_obj)
-        {
-            cJSON_AddStringToObject(data_obj, "ssid", ssid_str);
-            cJSON_AddStringToObject(data_obj, "ip", ip_str);
-            cJSON_AddStringToObject(data_obj, "gateway", gw_str);
-            cJSON_AddStringToObject(data_obj, "netmask", nm_str);
+        response_writer_t writer;
 
-            send_response_json("event", "wifi", "ap_got_ip", data_obj, true);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Failed to create JSON response for got_ip event");
-            return;
-        }
+        response_begin(&writer, "event", "wifi", "ap_got_ip");
+        response_push_object(&writer, "data");
+        response_set_string(&writer, "ssid", ssid_str);
+        response_set_string(&writer, "ip", ip_str);
+        response_set_string(&writer, "gateway", gw_str);
+        response_set_string(&writer, "netmask", nm_str);
+        response_pop_object(&writer);
+        response_end(&writer);
 
         disconnect_notify = false;
         xEventGroupWaitBits(captive_wifi_group, DISCONNECT_BY_USER, true, pdTRUE, 0);
 
         char hostname[32] = {0};
-        size_t hostname_len = sizeof(hostname);
-        if (nvs_load_data("device", "hostname", hostname, &hostname_len, NVS_TYPE_STR) == ESP_OK)
+        if (settings_get_str(SETTING_DEVICE_HOSTNAME, hostname, sizeof(hostname)) == ESP_OK)
         {
             dw_set_hostname_to_netif(WIFI_IF_STA, hostname);
         }
@@ -206,7 +176,7 @@ static void captive_sta_event_handler(void *arg, esp_event_base_t event_base, in
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED)
     {
-        send_response_json("event", "wifi", "ap_wait_ip", NULL, false);
+        send_response_json("event", "wifi", "ap_wait_ip", NULL);
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
     {
@@ -231,28 +201,23 @@ static void captive_sta_event_handler(void *arg, esp_event_base_t event_base, in
             }
         }
 
-        cJSON *data_obj = cJSON_CreateObject();
-        if (data_obj)
-        {
-            cJSON_AddNumberToObject(data_obj, "reason", disconn->reason);
-            cJSON_AddStringToObject(data_obj, "reason_str", wifi_reason_to_string(disconn->reason));
+        response_writer_t writer;
 
-            send_response_json("event", "wifi", "ap_disconnected_from_reason", data_obj, true);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Failed to serialize JSON for disconnected event");
-        }
+        response_begin(&writer, "event", "wifi", "ap_disconnected_from_reason");
+        response_push_object(&writer, "data");
+        response_set_int(&writer, "reason", disconn->reason);
+        response_set_string(&writer, "reason_str", wifi_reason_to_string(disconn->reason));
+        response_pop_object(&writer);
+        response_end(&writer);
     }
 }
 
 //=================================================================
-esp_err_t wifi_module_target(cJSON *json)
+esp_err_t wifi_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || action->valuestring == NULL)
+    if (!request_is_string(req, req->action))
     {
-        send_response_json("response", "wifi", "connect_ap_failed", "missing or invalid 'action'", false);
+        send_response_json("response", "wifi", "connect_ap_failed", "missing or invalid 'action'");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -265,73 +230,68 @@ esp_err_t wifi_module_target(cJSON *json)
         }
     }
 
-    if (strcmp(action->valuestring, "ap_scan_start") == 0)
+    if (request_equals(req, req->action, "ap_scan_start"))
     {
         esp_err_t scan_err = dw_station_scan_start(wifi_scan_done_handler, NULL);
 
         if (scan_err == ESP_OK)
         {
-            send_response_json("response", "wifi", "ap_scan_started", NULL, false);
+            send_response_json("response", "wifi", "ap_scan_started", NULL);
         }
         else if (scan_err == ESP_ERR_INVALID_STATE)
         {
-            send_response_json("response", "wifi", "ap_scan_already", NULL, false);
+            send_response_json("response", "wifi", "ap_scan_already", NULL);
         }
         else
         {
-            send_response_json("response", "wifi", "ap_scan_error", esp_err_to_name(scan_err), false);
+            send_response_json("response", "wifi", "ap_scan_error", esp_err_to_name(scan_err));
         }
 
         return ESP_OK;
     }
-    else if (strcmp(action->valuestring, "ap_scan_result") == 0)
+    else if (request_equals(req, req->action, "ap_scan_result"))
     {
+        // Результаты отдаются страницами: клиент запрашивает следующую по полю "next"
+        int offset = 0;
+        if (request_is_object(req, req->data))
+        {
+            request_get_int(req, request_find(req, req->data, "offset"), &offset);
+        }
+        if (offset < 0 || offset > UINT16_MAX)
+        {
+            offset = 0;
+        }
+
+        dw_scan_entry_t page[SCAN_PAGE_SIZE];
         uint16_t count = 0;
-        wifi_ap_record_t *list = NULL;
+        uint16_t total = 0;
 
-        esp_err_t err = dw_station_scan_result(&count, &list);
+        esp_err_t err = dw_station_scan_page(offset, page, SCAN_PAGE_SIZE, &count, &total);
         if (err != ESP_OK)
         {
-            send_response_json("response", "wifi", "ap_scan_error", "scan data unavailable", false);
+            send_response_json("response", "wifi", "ap_scan_error", "scan data unavailable");
             return err;
         }
 
-        cJSON *data_obj = cJSON_CreateObject();
-        if (!data_obj)
-        {
-            ESP_LOGE(TAG, "Failed to create data object");
-            dw_free_scan_result(list);
-            return ESP_ERR_NO_MEM;
-        }
-
-        cJSON *networks_array = cJSON_CreateArray();
-        if (!networks_array)
-        {
+        response_writer_t writer;
 
-            dw_free_scan_result(list);
-            return ESP_ERR_NO_MEM;
-        }
+        response_begin(&writer, "response", "wifi", "ap_scan_result");
+        response_push_object(&writer, "data");
+        response_set_int(&writer, "offset", offset);
+        response_set_int(&writer, "total", total);
+        if (offset + count < total)
+            response_set_int(&writer, "next", offset + count);
+        response_push_array(&writer, "networks");
 
         for (int i = 0; i < count; i++)
         {
-            cJSON *ap = cJSON_CreateObject();
-            if (!ap)
-            {
-                cJSON_Delete(networks_array);
-
-                dw_free_scan_result(list);
-                return ESP_ERR_NO_MEM;
-            }
-
-            char ssid[33] = {0};
-            strlcpy(ssid, (char *)list[i].ssid, sizeof(ssid));
-
-            cJSON_AddStringToObject(ap, "ssid", ssid);
-            cJSON_AddNumberToObject(ap, "rssi", list[i].rssi);
-            cJSON_AddNumberToObject(ap, "channel", list[i].primary);
+            response_array_start_object(&writer);
+            response_set_string(&writer, "ssid", page[i].ssid);
+            response_set_int(&writer, "rssi", page[i].rssi);
+            response_set_int(&writer, "channel", page[i].channel);
 
             const char *auth_str = "UNKNOWN";
-            switch (list[i].authmode)
+            switch (page[i].authmode)
             {
             case WIFI_AUTH_OPEN:
                 auth_str = "OPEN";
@@ -361,68 +321,35 @@ esp_err_t wifi_module_target(cJSON *json)
                 auth_str = "UNKNOWN";
                 break;
             }
-            cJSON_AddStringToObject(ap, "authmode", auth_str);
-
-            cJSON_AddItemToArray(networks_array, ap);
+            response_set_string(&writer, "authmode", auth_str);
+            response_array_end_object(&writer);
         }
 
-        cJSON_AddItemToObject(data_obj, "networks", networks_array);
-
-        send_response_json("response", "wifi", "ap_scan_result", data_obj, true);
-
-        dw_free_scan_result(list);
-        return ESP_OK;
+        response_pop_array(&writer);
+        response_pop_object(&writer);
+        return response_end(&writer);
     }
-    else if (strcmp(action->valuestring, "ap_connect") == 0)
+    else if (request_equals(req, req->action, "ap_connect"))
     {
-        char standalone[8] = {0};
-        size_t str_size = sizeof(standalone);
-        esp_err_t err = nvs_load_data("wifi", "standalone", standalone, &str_size, NVS_TYPE_STR);
-
-        if (err == ESP_OK && strcmp(standalone, "true") == 0)
+        if (settings_get_bool(SETTING_WIFI_STANDALONE))
         {
-            send_response_json("response", "wifi", "ap_connect_error", "standalone mode active", false);
+            send_response_json("response", "wifi", "ap_connect_error", "standalone mode active");
             return ESP_OK;
         }
 
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (!cJSON_IsObject(data_obj))
+        if (!request_is_object(req, req->data))
         {
-            send_response_json("response", "wifi", "ap_connect_error", "missing or invalid 'data'", false);
+            send_response_json("response", "wifi", "ap_connect_error", "missing or invalid 'data'");
             return ESP_OK;
         }
 
-        // Проверка длины всех строковых полей в data_obj
-        cJSON *current_item = data_obj->child;
-        while (current_item != NULL)
+        // Проверка длины всех строковых полей в data
+        int long_item = request_find_long_string(req, req->data, 31); // 32 символа, включая null-терминатор
+        if (long_item >= 0)
         {
-            if (cJSON_IsString(current_item) && current_item->valuestring != NULL)
-            {
-                size_t str_len = strlen(current_item->valuestring);
-                if (str_len >= 32) // 32 символа, включая null-терминатор
-                {
-                    ESP_LOGE(TAG, "String field '%s' too long: %zu characters (max 31)", current_item->string, str_len);
-                    send_response_json("response", "wifi", "ap_connect_error", "string field too long (max 31 characters)", false);
-                    return ESP_OK;
-                }
-            }
-            current_item = current_item->next;
-        }
-
-        cJSON *ssid = cJSON_GetObjectItemCaseSensitive(data_obj, "ssid");
-        cJSON *password = cJSON_GetObjectItemCaseSensitive(data_obj, "password");
-        cJSON *authmode = cJSON_GetObjectItemCaseSensitive(data_obj, "authmode");
-
-        if (!cJSON_IsString(ssid) || ssid->valuestring == NULL)
-        {
-            send_response_json("response", "wifi", "ap_connect_error", "ssid is required", false);
-            return ESP_OK;
-        }
-
-        size_t ssid_len = strlen(ssid->valuestring);
-        if (ssid_len >= 32)
-        {
-            send_response_json("response", "wifi", "ap_connect_error", "ssid too long", false);
+            ESP_LOGE(TAG, "String field '%.*s' too long (max 31)",
+                     request_token_len(req, long_item), request_token_ptr(req, long_item));
+            send_response_json("response", "wifi", "ap_connect_error", "string field too long (max 31 characters)");
             return ESP_OK;
         }
 
@@ -435,41 +362,45 @@ esp_err_t wifi_module_target(cJSON *json)
             .failure_retry_cnt = 1,
         };
 
-        memcpy(sta_config.ssid, ssid->valuestring, ssid_len);
-        sta_config.ssid[ssid_len] = '\0';
+        esp_err_t err = request_copy_string(req, request_find(req, req->data, "ssid"), (char *)sta_config.ssid, sizeof(sta_config.ssid));
+        if (err == ESP_ERR_INVALID_SIZE)
+        {
+            send_response_json("response", "wifi", "ap_connect_error", "ssid too long");
+            return ESP_OK;
+        }
+        else if (err != ESP_OK)
+        {
+            send_response_json("response", "wifi", "ap_connect_error", "ssid is required");
+            return ESP_OK;
+        }
 
         wifi_auth_mode_t auth_mode = WIFI_AUTH_OPEN;
 
-        if (cJSON_IsString(authmode) && authmode->valuestring != NULL)
+        int authmode = request_find(req, req->data, "authmode");
+        if (request_is_string(req, authmode))
         {
             // Валидация authmode: проверим, что значение входит в допустимый список
-            if (strcmp(authmode->valuestring, "OPEN") != 0 &&
-                strcmp(authmode->valuestring, "WEP") != 0 &&
-                strcmp(authmode->valuestring, "WPA") != 0 &&
-                strcmp(authmode->valuestring, "WPA2") != 0 &&
-                strcmp(authmode->valuestring, "WPA/WPA2") != 0 &&
-                strcmp(authmode->valuestring, "WPA3") != 0 &&
-                strcmp(authmode->valuestring, "WPA2/WPA3") != 0)
-            {
-                ESP_LOGE(TAG, "Invalid authmode provided: %s", authmode->valuestring);
-                send_response_json("response", "wifi", "ap_connect_error", "invalid authmode", false);
-                return ESP_OK;
-            }
-
-            if (strcmp(authmode->valuestring, "OPEN") == 0)
+            if (request_equals(req, authmode, "OPEN"))
                 auth_mode = WIFI_AUTH_OPEN;
-            else if (strcmp(authmode->valuestring, "WEP") == 0)
+            else if (request_equals(req, authmode, "WEP"))
                 auth_mode = WIFI_AUTH_WEP;
-            else if (strcmp(authmode->valuestring, "WPA") == 0)
+            else if (request_equals(req, authmode, "WPA"))
                 auth_mode = WIFI_AUTH_WPA_PSK;
-            else if (strcmp(authmode->valuestring, "WPA2") == 0)
+            else if (request_equals(req, authmode, "WPA2"))
                 auth_mode = WIFI_AUTH_WPA2_PSK;
-            else if (strcmp(authmode->valuestring, "WPA/WPA2") == 0)
+            else if (request_equals(req, authmode, "WPA/WPA2"))
                 auth_mode = WIFI_AUTH_WPA_WPA2_PSK;
-            else if (strcmp(authmode->valuestring, "WPA3") == 0)
+            else if (request_equals(req, authmode, "WPA3"))
                 auth_mode = WIFI_AUTH_WPA3_PSK;
-            else if (strcmp(authmode->valuestring, "WPA2/WPA3") == 0)
+            else if (request_equals(req, authmode, "WPA2/WPA3"))
                 auth_mode = WIFI_AUTH_WPA2_WPA3_PSK;
+            else
+            {
+                ESP_LOGE(TAG, "Invalid authmode provided: %.*s",
+                         request_token_len(req, authmode), request_token_ptr(req, authmode));
+                send_response_json("response", "wifi", "ap_connect_error", "invalid authmode");
+                return ESP_OK;
+            }
         }
         else
         {
@@ -477,19 +408,16 @@ esp_err_t wifi_module_target(cJSON *json)
             auth_mode = WIFI_AUTH_OPEN;
         }
 
-        if (cJSON_IsString(password) && password->valuestring != NULL)
+        // Длина пароля ограничена 64 байтами
+        err = request_copy_string(req, request_find(req, req->data, "password"), (char *)sta_config.password, sizeof(sta_config.password));
+        if (err == ESP_ERR_INVALID_SIZE)
         {
-            size_t pass_len = strlen(password->valuestring);
-            if (pass_len >= 64) // длина пароля ограничена 64 байтами
-            {
-                send_response_json("response", "wifi", "ap_connect_error", "password too long", false);
-                return ESP_OK;
-            }
-
-            memcpy(sta_config.password, password->valuestring, pass_len);
-            sta_config.password[pass_len] = '\0';
-
-            sta_config.threshold.authmode = (pass_len > 0) ? auth_mode : WIFI_AUTH_OPEN;
+            send_response_json("response", "wifi", "ap_connect_error", "password too long");
+            return ESP_OK;
+        }
+        else if (err == ESP_OK)
+        {
+            sta_config.threshold.authmode = (sta_config.password[0] != '\0') ? auth_mode : WIFI_AUTH_OPEN;
         }
         else
         {
@@ -497,24 +425,24 @@ esp_err_t wifi_module_target(cJSON *json)
             sta_config.threshold.authmode = WIFI_AUTH_OPEN;
         }
 
-        ESP_LOGI(TAG, "Connecting to SSID: %s, Auth mode: %d", ssid->valuestring, sta_config.threshold.authmode);
+        ESP_LOGI(TAG, "Connecting to SSID: %s, Auth mode: %d", (char *)sta_config.ssid, sta_config.threshold.authmode);
 
         dwnvs_delete_sta_config();
         err = dw_station_connect_with_auto_reconnect(&sta_config, captive_sta_event_handler, NULL, false);
 
         if (err == ESP_OK)
         {
-            send_response_json("response", "wifi", "ap_connect_ok", NULL, false);
+            send_response_json("response", "wifi", "ap_connect_ok", NULL);
         }
         else
         {
-            send_response_json("response", "wifi", "ap_connect_error", esp_err_to_name(err), false);
+            send_response_json("response", "wifi", "ap_connect_error", esp_err_to_name(err));
             ESP_LOGE(TAG, "Station connect error: %s", esp_err_to_name(err));
         }
 
         return ESP_OK;
     }
-    else if (strcmp(action->valuestring, "ap_disconnect") == 0)
+    else if (request_equals(req, req->action, "ap_disconnect"))
     {
         esp_err_t err = dw_station_stop();
 
@@ -522,44 +450,35 @@ esp_err_t wifi_module_target(cJSON *json)
         {
             dw_station_set_auto_reconnect(false);
             xEventGroupSetBits(captive_wifi_group, DISCONNECT_BY_USER);
-            send_response_json("response", "wifi", "ap_disconnect_success", NULL, false);
+            send_response_json("response", "wifi", "ap_disconnect_success", NULL);
         }
         else
         {
-            send_response_json("response", "wifi", "ap_disconnect_error", NULL, false);
+            send_response_json("response", "wifi", "ap_disconnect_error", NULL);
             ESP_LOGE(TAG, "Station connect error: %s", esp_err_to_name(err));
         }
     }
-    else if (strcmp(action->valuestring, "ap_status") == 0)
+    else if (request_equals(req, req->action, "ap_status"))
     {
         return ap_status("response");
     }
-    else if (strcmp(action->valuestring, "ap_config") == 0)
+    else if (request_equals(req, req->action, "ap_config"))
     {
-        char standalone[8] = {0};
-        size_t str_size = sizeof(standalone);
-        esp_err_t err = nvs_load_data("wifi", "standalone", standalone, &str_size, NVS_TYPE_STR);
-
-        if (err != ESP_OK)
-        {
-            snprintf(standalone, sizeof(standalone), "false");
-        }
+        const char *standalone = settings_get_bool(SETTING_WIFI_STANDALONE) ? "true" : "false";
 
         wifi_sta_config_t wifi_sta = {0};
-        err = dwnvs_load_sta_config(&wifi_sta);
+        esp_err_t err = dwnvs_load_sta_config(&wifi_sta);
 
-        cJSON *data_obj = cJSON_CreateObject();
-        if (!data_obj)
-        {
-            ESP_LOGE(TAG, "Failed to create data object");
-            return ESP_ERR_NO_MEM;
-        }
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "wifi", "ap_config");
+        response_push_object(&writer, "data");
 
         if (err == ESP_OK)
         {
-            cJSON_AddStringToObject(data_obj, "ssid", (char *)wifi_sta.ssid);
-            cJSON_AddStringToObject(data_obj, "password", (char *)wifi_sta.password);
-            cJSON_AddStringToObject(data_obj, "standalone", standalone);
+            response_set_string(&writer, "ssid", (char *)wifi_sta.ssid);
+            response_set_string(&writer, "password", (char *)wifi_sta.password);
+            response_set_string(&writer, "standalone", standalone);
 
             const char *auth_str = "UNKNOWN";
             switch (wifi_sta.threshold.authmode)
@@ -592,48 +511,44 @@ esp_err_t wifi_module_target(cJSON *json)
                 auth_str = "UNKNOWN";
                 break;
             }
-            cJSON_AddStringToObject(data_obj, "authmode", auth_str);
+            response_set_string(&writer, "authmode", auth_str);
         }
         else
         {
-            cJSON_AddNullToObject(data_obj, "ssid");
-            cJSON_AddNullToObject(data_obj, "password");
-            cJSON_AddStringToObject(data_obj, "standalone", standalone);
+            response_set_null(&writer, "ssid");
+            response_set_null(&writer, "password");
+            response_set_string(&writer, "standalone", standalone);
         }
 
-        send_response_json("response", "wifi", "ap_config", data_obj, true);
+        response_pop_object(&writer);
+        response_end(&writer);
     }
-    else if (strcmp(action->valuestring, "save_partial") == 0)
+    else if (request_equals(req, req->action, "save_partial"))
     {
-        cJSON *data_obj = cJSON_GetObjectItemCaseSensitive(json, "data");
-        if (data_obj == NULL)
+        if (req->data < 0)
         {
             ESP_LOGW(TAG, "Missing 'data' in save request");
-            send_response_json("response", "wifi", "error_partial", "\"missing 'data'\"", false);
+            send_response_json("response", "wifi", "error_partial", "\"missing 'data'\"");
             return ESP_ERR_INVALID_ARG;
         }
 
-        esp_err_t result = parse_and_save_json_settings(
-            "wifi",
-            data_obj,
-            wifi_params,
-            sizeof(wifi_params) / sizeof(wifi_params[0]));
+        esp_err_t result = parse_and_save_json_settings(req, req->data, wifi_params, sizeof(wifi_params) / sizeof(wifi_params[0]), NULL);
 
         if (result == ESP_OK)
         {
-            send_response_json("response", "wifi", "saved_partial", NULL, false);
+            send_response_json("response", "wifi", "saved_partial", NULL);
             return ESP_OK;
         }
         else
         {
             ESP_LOGE(TAG, "Save failed: %s", esp_err_to_name(result));
-            send_response_json("response", "wifi", "error_partial", "save failed", false);
+            send_response_json("response", "wifi", "error_partial", "save failed");
             return ESP_FAIL;
         }
     }
     else
     {
-        send_response_json("response", "wifi", "common_error", "unknown action", false);
+        send_response_json("response", "wifi", "common_error", "unknown action");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -4,22 +4,100 @@
 #include "freertos/FreeRTOS.h"
 #include "esp_http_server.h"
 #include "esp_wifi.h"
+#include "modules/request_parser.h"
+
+#define WS_URI "/ws"
+#define WS_RX_BUFFER_SIZE 1024 // Максимальный размер входящего кадра
+
+// Пул фоновых задач для медленных действий WebSocket
+#ifndef WS_JOB_WORKERS
+#define WS_JOB_WORKERS 2
+#endif
+
+#ifndef WS_JOB_QUEUE_DEPTH
+#define WS_JOB_QUEUE_DEPTH 4
+#endif
+
+#define WS_JOB_STACK_SIZE 4096
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+    // Счётчики очереди отправки WebSocket
+    typedef struct
+    {
+        uint32_t sent;              // Отправлено кадров
+        uint32_t coalesced;         // Событий заменено более новыми с тем же ключом
+        uint32_t dropped_responses; // Ответов и фрагментов не поместилось в очередь
+        uint32_t dropped_events;    // Событий отброшено при заполненных слотах
+    } ws_send_stats_t;
+
+    // Кодирование исходящих сообщений, выбирается клиентом при подключении (?enc=cbor)
+    typedef enum
+    {
+        WS_ENCODING_JSON = 0, // Текстовые кадры, по умолчанию
+        WS_ENCODING_CBOR,     // Бинарные кадры, та же схема сообщений в CBOR
+    } ws_encoding_t;
+
+    ws_encoding_t ws_server_encoding(void);
+
+    // Ответ: ставится в FIFO и уходит раньше ожидающих событий
     bool ws_server_send_string(const char *str);
+    bool ws_server_send_binary(const void *data, size_t len);
+    bool ws_server_send_fragment(const void *data, size_t len, bool binary, bool first, bool final);
+
+    /**
+     * @brief Ставит событие в очередь отправки.
+     *
+     * Неотправленное событие с тем же ключом заменяется новым: клиенту важно только последнее состояние.
+     * @param key Ключ вида "target/status"
+     */
+    bool ws_server_send_event(const void *data, size_t len, bool binary, const char *key);
 
-    void captive_portal_dns_server_start(esp_netif_t *netif);
+    void ws_server_get_stats(ws_send_stats_t *stats);
+
+    esp_err_t captive_portal_dns_server_start(esp_netif_t *netif);
     esp_err_t captive_portal_dns_server_stop(void);
 
     void captive_portal_http_server_start(esp_netif_t *netif);
     esp_err_t captive_portal_http_server_stop(void);
 
-    void captive_portal_ws_server_start(esp_netif_t *netif);
+    /**
+     * @brief Регистрирует WebSocket (WS_URI) на уже запущенном HTTP-сервере.
+     *
+     * Вызывается из captive_portal_http_server_start(), остановка - до httpd_stop().
+     */
+    esp_err_t captive_portal_ws_server_start(httpd_handle_t server, esp_netif_t *netif);
     esp_err_t captive_portal_ws_server_stop(void);
+    // Вызывается из close_fn HTTP-сервера для каждого закрываемого сокета
+    void captive_portal_ws_session_closed(int sockfd);
+
+    typedef esp_err_t (*ws_job_handler_t)(const request_t *req);
+    typedef esp_err_t (*ws_binary_job_handler_t)(const void *data, size_t len);
+
+    esp_err_t ws_jobs_start(void);
+    void ws_jobs_stop(void);
+
+    /**
+     * @brief Ставит запрос в очередь фоновых задач.
+     *
+     * Кадр копируется в свободный слот пула и повторно разбирается в рабочей задаче.
+     * @return ESP_OK, ESP_ERR_NO_MEM если свободных слотов нет
+     */
+    esp_err_t ws_jobs_submit(ws_job_handler_t handler, const request_t *req, uint32_t *job_id);
+
+    /**
+     * @brief Ставит бинарный кадр в очередь фоновых задач.
+     *
+     * Кадр копируется в свободный слот пула и передаётся обработчику как есть.
+     * @return ESP_OK, ESP_ERR_NO_MEM если свободных слотов нет
+     */
+    esp_err_t ws_jobs_submit_binary(ws_binary_job_handler_t handler, const void *data, size_t len, uint32_t *job_id);
+
+    // Номер задачи, которую выполняет текущая рабочая задача, или 0
+    uint32_t ws_jobs_current_id(void);
 
 #ifdef __cplusplus
 }
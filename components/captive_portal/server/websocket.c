@@ -2,7 +2,6 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
-#include "cJSON.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include <string.h>
@@ -11,23 +10,29 @@
 #include "server/server.h"
 #include "modules/modules.h"
 
-#define WS_SEND_QUEUE_SIZE 10
+#define WS_SEND_QUEUE_SIZE 16        // Ответы и фрагменты, FIFO с приоритетом над событиями
+#define WS_EVENT_SLOTS 8             // События, новое вытесняет старое с тем же target/status
+#define WS_FRAGMENT_TIMEOUT_MS 1000  // Ожидание следующего фрагмента сообщения
 #define WS_TASK_STACK_SIZE 4096
 #define WS_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define WS_ROUTE_SLOTS 16      // Размер хеш-таблицы целей, степень двойки
 
 static QueueHandle_t ws_send_queue = NULL;
 static httpd_handle_t ws_server = NULL;
 static int client_socket = -1;
 static TaskHandle_t sender_task_handle = NULL;
 static SemaphoreHandle_t socket_mutex = NULL;
+static SemaphoreHandle_t stream_mutex = NULL; // Не даёт вклиниться другим кадрам между фрагментами одного ответа
+static SemaphoreHandle_t event_mutex = NULL;
 static volatile bool server_stopped = false;
+static volatile ws_encoding_t client_encoding = WS_ENCODING_JSON;
 
 static const char *TAG = "WS";
 
 // Forward declarations
-static bool ws_server_send_text(const char *data, size_t len);
-static void websocket_router(cJSON *json);
-static void on_http_client_disconnect(httpd_handle_t server, int sockfd);
+static bool ws_server_send_frame(const char *data, size_t len, httpd_ws_type_t type);
+static void ws_event_slots_clear(void);
+static void websocket_router(const request_t *req);
 static esp_err_t websocket_handler(httpd_req_t *req);
 static void ws_sender_task(void *pvParameters);
 
@@ -36,63 +41,238 @@ typedef struct
 {
     char *payload;
     size_t len;
+    httpd_ws_type_t type;
+    bool fragmented;
+    bool final;
 } ws_msg_t;
 
+// Pending event, keyed by "target/status"
+typedef struct
+{
+    char key[32];
+    uint32_t seq;
+    ws_msg_t msg;
+} ws_event_slot_t;
+
+static ws_event_slot_t event_slots[WS_EVENT_SLOTS];
+static uint32_t event_seq = 0;
+
+static ws_send_stats_t send_stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Target handler type
-typedef esp_err_t (*ws_target_handler_t)(cJSON *json);
+typedef esp_err_t (*ws_target_handler_t)(const request_t *req);
 
 // Target routing table
 typedef struct
 {
     const char *target;
     ws_target_handler_t handler;
+    const char *const *async_actions; // Действия, выполняемые в пуле фоновых задач
 } ws_target_route_t;
 
 // Forward declaration for websocket target
-static esp_err_t websocket_module_target(cJSON *json);
+static esp_err_t websocket_module_target(const request_t *req);
+
+// Медленные действия: сетевые проверки, подключение и запись в NVS
+static const char *const save_async[] = {"save_partial", NULL};
+static const char *const wifi_async[] = {"ap_status", "ap_connect", "save_partial", NULL};
+static const char *const mqtt_async[] = {"test_connection", "save_partial", NULL};
+static const char *const update_async[] = {"start_update", NULL};
+static const char *const control_async[] = {"export_settings", NULL};
 
 static const ws_target_route_t target_routes[] = {
-    {"control", control_module_target},
-    {"device", device_module_target},
-    {"ledstrip", ledstrip_module_target},
-    {"wifi", wifi_module_target},
-    {"network", network_module_target},
-    {"apoint", apoint_module_target},
-    {"mqtt", mqtt_module_target},
-    {"update", update_module_target},
-    {"websocket", websocket_module_target}  // Добавлено
+    {"control", control_module_target, control_async},
+    {"device", device_module_target, save_async},
+    {"ledstrip", ledstrip_module_target, save_async},
+    {"wifi", wifi_module_target, wifi_async},
+    {"network", network_module_target, save_async},
+    {"apoint", apoint_module_target, save_async},
+    {"mqtt", mqtt_module_target, mqtt_async},
+    {"update", update_module_target, update_async},
+    {"websocket", websocket_module_target, NULL}  // Добавлено
 };
 
 static const size_t target_routes_count = sizeof(target_routes) / sizeof(target_routes[0]);
 
+// Hashed target lookup
+typedef struct
+{
+    uint32_t hash;
+    const ws_target_route_t *route;
+} ws_route_slot_t;
+
+static ws_route_slot_t route_slots[WS_ROUTE_SLOTS];
+
+// Входящий кадр и его токены. Обработчик httpd однопоточный, поэтому хватает одного экземпляра
+static char rx_buffer[WS_RX_BUFFER_SIZE];
+static request_t rx_request;
+
+//=================================================================
+// FNV-1a hash
+//=================================================================
+static uint32_t route_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//=================================================================
+// Build hashed dispatch table
+//=================================================================
+static void websocket_routes_init(void)
+{
+    memset(route_slots, 0, sizeof(route_slots));
+
+    for (size_t i = 0; i < target_routes_count; i++)
+    {
+        uint32_t hash = route_hash(target_routes[i].target, strlen(target_routes[i].target));
+        size_t slot = hash & (WS_ROUTE_SLOTS - 1);
+
+        while (route_slots[slot].route != NULL)
+            slot = (slot + 1) & (WS_ROUTE_SLOTS - 1);
+
+        route_slots[slot].hash = hash;
+        route_slots[slot].route = &target_routes[i];
+    }
+}
+
+//=================================================================
+// Find route by target token
+//=================================================================
+static const ws_target_route_t *websocket_route_lookup(const char *target, size_t len)
+{
+    uint32_t hash = route_hash(target, len);
+    size_t slot = hash & (WS_ROUTE_SLOTS - 1);
+
+    while (route_slots[slot].route != NULL)
+    {
+        const ws_target_route_t *route = route_slots[slot].route;
+        if (route_slots[slot].hash == hash &&
+            strlen(route->target) == len &&
+            memcmp(route->target, target, len) == 0)
+        {
+            return route;
+        }
+        slot = (slot + 1) & (WS_ROUTE_SLOTS - 1);
+    }
+
+    return NULL;
+}
+
+//=================================================================
+// Check whether the action runs in the job pool
+//=================================================================
+static bool websocket_action_is_async(const request_t *req, const ws_target_route_t *route)
+{
+    if (route->async_actions == NULL)
+        return false;
+
+    for (const char *const *action = route->async_actions; *action != NULL; action++)
+    {
+        if (request_equals(req, req->action, *action))
+            return true;
+    }
+
+    return false;
+}
+
+//=================================================================
+// Hand the request to the job pool and reply with the job id
+//=================================================================
+static void websocket_submit_job(const request_t *req, const ws_target_route_t *route)
+{
+    uint32_t job_id = 0;
+    esp_err_t err = ws_jobs_submit(route->handler, req, &job_id);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Job for '%s' rejected: %s", route->target, esp_err_to_name(err));
+        send_response_json("response", route->target, "job_busy", "too many pending jobs");
+        return;
+    }
+
+    char action[32];
+    if (request_copy_string(req, req->action, action, sizeof(action)) != ESP_OK)
+        action[0] = '\0';
+
+    response_writer_t writer;
+
+    response_begin(&writer, "response", route->target, "job_accepted");
+    response_push_object(&writer, "data");
+    response_set_int(&writer, "job", job_id);
+    response_set_string(&writer, "action", action);
+    response_pop_object(&writer);
+    response_end(&writer);
+}
+
 //=================================================================
 // Websocket target handler
 //=================================================================
-static esp_err_t websocket_module_target(cJSON *json)
+static esp_err_t websocket_module_target(const request_t *req)
 {
-    cJSON *action = cJSON_GetObjectItemCaseSensitive(json, "action");
-    if (!cJSON_IsString(action) || !action->valuestring)
+    if (!request_is_string(req, req->action))
     {
-        send_response_json("response", "websocket", "error_action", "missing or invalid 'action'", false);
+        send_response_json("response", "websocket", "error_action", "missing or invalid 'action'");
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (strcmp(action->valuestring, "ping") == 0)
+    if (request_equals(req, req->action, "ping"))
     {
         // Отправляем pong
-        send_response_json("response", "websocket", "pong", NULL, false);
+        send_response_json("response", "websocket", "pong", NULL);
+        return ESP_OK;
+    }
+
+    if (request_equals(req, req->action, "page_timing"))
+    {
+        // Время загрузки портала, измеренное браузером (мс)
+        int ttfb = request_find(req, req->data, "ttfb");
+        int dom = request_find(req, req->data, "dom_ready");
+        int load = request_find(req, req->data, "load");
+        int requests = request_find(req, req->data, "requests");
+
+        ESP_LOGI(TAG, "Portal load: ttfb=%.*s ms, dom_ready=%.*s ms, load=%.*s ms, requests=%.*s",
+                 request_token_len(req, ttfb), request_token_ptr(req, ttfb),
+                 request_token_len(req, dom), request_token_ptr(req, dom),
+                 request_token_len(req, load), request_token_ptr(req, load),
+                 request_token_len(req, requests), request_token_ptr(req, requests));
         return ESP_OK;
     }
 
-    ESP_LOGW(TAG, "Unknown action for websocket target: %s", action->valuestring);
-    send_response_json("response", "websocket", "error_action", "unknown action", false);
+    if (request_equals(req, req->action, "stats"))
+    {
+        ws_send_stats_t stats;
+        ws_server_get_stats(&stats);
+
+        response_writer_t writer;
+
+        response_begin(&writer, "response", "websocket", "stats");
+        response_push_object(&writer, "data");
+        response_set_int(&writer, "sent", stats.sent);
+        response_set_int(&writer, "coalesced", stats.coalesced);
+        response_set_int(&writer, "dropped_responses", stats.dropped_responses);
+        response_set_int(&writer, "dropped_events", stats.dropped_events);
+        response_pop_object(&writer);
+        response_end(&writer);
+        return ESP_OK;
+    }
+
+    ESP_LOGW(TAG, "Unknown action for websocket target: %.*s",
+             request_token_len(req, req->action), request_token_ptr(req, req->action));
+    send_response_json("response", "websocket", "error_action", "unknown action");
     return ESP_ERR_INVALID_ARG;
 }
 
 //=================================================================
 // Client disconnect handler
 //=================================================================
-static void on_http_client_disconnect(httpd_handle_t server, int sockfd)
+void captive_portal_ws_session_closed(int sockfd)
 {
     ESP_LOGI(TAG, "Client disconnected (sockfd=%d)", sockfd);
 
@@ -103,6 +283,7 @@ static void on_http_client_disconnect(httpd_handle_t server, int sockfd)
             if (client_socket == sockfd)
             {
                 client_socket = -1;
+                client_encoding = WS_ENCODING_JSON;
                 ESP_LOGI(TAG, "Cleared client_socket for sockfd=%d", sockfd);
             }
             xSemaphoreGive(socket_mutex);
@@ -113,39 +294,72 @@ static void on_http_client_disconnect(httpd_handle_t server, int sockfd)
 //=================================================================
 // Command router
 //=================================================================
-static void websocket_router(cJSON *json)
+static void websocket_router(const request_t *req)
 {
-    cJSON *type = cJSON_GetObjectItemCaseSensitive(json, "type");
-    if (!cJSON_IsString(type) || !type->valuestring)
+    int type = request_find(req, 0, "type");
+    if (!request_is_string(req, type))
     {
-        send_response_json("response", "invalid", "error_type", "missing or invalid 'type'", false);
+        send_response_json("response", "invalid", "error_type", "missing or invalid 'type'");
         return;
     }
 
-    if (strcmp(type->valuestring, "request") != 0)
+    if (!request_equals(req, type, "request"))
     {
-        send_response_json("response", "invalid", "error_type", "unknown type", false);
+        send_response_json("response", "invalid", "error_type", "unknown type");
         return;
     }
 
-    cJSON *target = cJSON_GetObjectItemCaseSensitive(json, "target");
-    if (!cJSON_IsString(target) || !target->valuestring)
+    int target = request_find(req, 0, "target");
+    if (!request_is_string(req, target))
     {
-        send_response_json("response", "invalid", "error_target", "missing or invalid 'target'", false);
+        send_response_json("response", "invalid", "error_target", "missing or invalid 'target'");
         return;
     }
 
-    for (size_t i = 0; i < target_routes_count; i++)
+    const ws_target_route_t *route = websocket_route_lookup(request_token_ptr(req, target),
+                                                            request_token_len(req, target));
+    if (route)
     {
-        if (strcmp(target->valuestring, target_routes[i].target) == 0)
-        {
-            target_routes[i].handler(json);
-            return;
-        }
+        if (websocket_action_is_async(req, route))
+            websocket_submit_job(req, route);
+        else
+            route->handler(req);
+        return;
     }
 
-    ESP_LOGW(TAG, "Unknown target: %s", target->valuestring);
-    send_response_json("response", target->valuestring, "error_target", "unknown target", false);
+    char target_name[16];
+    if (request_copy_string(req, target, target_name, sizeof(target_name)) != ESP_OK)
+    {
+        strlcpy(target_name, "invalid", sizeof(target_name));
+    }
+
+    ESP_LOGW(TAG, "Unknown target: %s", target_name);
+    send_response_json("response", target_name, "error_target", "unknown target");
+}
+
+//=================================================================
+// Encoding requested by the client in the handshake query (?enc=cbor)
+//=================================================================
+static ws_encoding_t websocket_negotiate_encoding(httpd_req_t *req)
+{
+    char query[32];
+    char enc[8];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "enc", enc, sizeof(enc)) == ESP_OK &&
+        strcmp(enc, "cbor") == 0)
+    {
+        ESP_LOGI(TAG, "Client negotiated CBOR encoding");
+        return WS_ENCODING_CBOR;
+    }
+
+    return WS_ENCODING_JSON;
+}
+
+//=================================================================
+ws_encoding_t ws_server_encoding(void)
+{
+    return client_encoding;
 }
 
 //=================================================================
@@ -166,16 +380,23 @@ static esp_err_t websocket_handler(httpd_req_t *req)
                 httpd_sess_trigger_close(ws_server, client_socket);
             }
             client_socket = new_sockfd;
+            client_encoding = websocket_negotiate_encoding(req);
             xSemaphoreGive(socket_mutex);
 
-            send_response_json("event", "system", "ws_ready", NULL, false);
+            // События для прежнего клиента могли быть закодированы иначе
+            if (xSemaphoreTake(event_mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+            {
+                ws_event_slots_clear();
+                xSemaphoreGive(event_mutex);
+            }
+
+            send_response_json("event", "system", "ws_ready", NULL);
             ESP_LOGI(TAG, "Sent 'ready' event to client");
         }
         return ESP_OK;
     }
 
     httpd_ws_frame_t ws_pkt = {0};
-    uint8_t *buf = NULL;
 
     esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
     if (ret != ESP_OK)
@@ -187,35 +408,55 @@ static esp_err_t websocket_handler(httpd_req_t *req)
     if (ws_pkt.len == 0)
         return ESP_OK;
 
-    buf = calloc(1, ws_pkt.len + 1);
-    if (!buf)
+    if (ws_pkt.len >= WS_RX_BUFFER_SIZE)
     {
-        ESP_LOGE(TAG, "Memory allocation failed");
-        return ESP_ERR_NO_MEM;
+        ESP_LOGE(TAG, "Frame too large: %u bytes", (unsigned)ws_pkt.len);
+        send_response_json("response", "system", "error_json", "frame too large");
+        return ESP_ERR_INVALID_SIZE;
     }
-    ws_pkt.payload = buf;
+
+    ws_pkt.payload = (uint8_t *)rx_buffer;
 
     ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to read frame: %s", esp_err_to_name(ret));
-        free(buf);
         return ret;
     }
+    rx_buffer[ws_pkt.len] = '\0';
 
     if (ws_pkt.type == HTTPD_WS_TYPE_TEXT)
     {
-        ESP_LOGI(TAG, "Received text: %.*s", ws_pkt.len, buf);
-        cJSON *json = cJSON_Parse((char *)buf);
-        if (json)
+        ESP_LOGI(TAG, "Received text: %.*s", ws_pkt.len, rx_buffer);
+        ret = request_parse(&rx_request, rx_buffer, ws_pkt.len);
+        if (ret == ESP_OK)
         {
-            websocket_router(json); // Обработка JSON-команд
-            cJSON_Delete(json);
+            websocket_router(&rx_request); // Обработка JSON-команд
         }
         else
         {
-            ESP_LOGW(TAG, "JSON parse error: %s", cJSON_GetErrorPtr());
-            send_response_json("response", "system", "error_json", "invalid json", false);
+            ESP_LOGW(TAG, "JSON parse error: %s", esp_err_to_name(ret));
+            send_response_json("response", "system", "error_json", "invalid json");
+        }
+    }
+    else if (ws_pkt.type == HTTPD_WS_TYPE_BINARY)
+    {
+        // Входящий бинарный кадр - снимок настроек (settings_snapshot.h)
+        ESP_LOGI(TAG, "Received binary: %u bytes", (unsigned)ws_pkt.len);
+
+        // Запись NVS и перезагрузка выполняются в пуле задач, не блокируя задачу httpd
+        uint32_t job_id;
+        esp_err_t err = ws_jobs_submit_binary(control_import_settings, rx_buffer, ws_pkt.len, &job_id);
+        if (err != ESP_OK)
+            ESP_LOGW(TAG, "Snapshot import rejected: %s", esp_err_to_name(err));
+
+        if (err == ESP_ERR_NO_MEM)
+        {
+            send_response_json("response", "control", "job_busy", "too many pending jobs");
+        }
+        else if (err != ESP_OK)
+        {
+            send_response_json("response", "control", "error", "invalid snapshot");
         }
     }
     else
@@ -223,62 +464,167 @@ static esp_err_t websocket_handler(httpd_req_t *req)
         ESP_LOGW(TAG, "Unknown frame type: %d", ws_pkt.type);
     }
 
-    free(buf);
     return ESP_OK;
 }
 
+//=================================================================
+// Send statistics
+//=================================================================
+static void ws_stats_inc(uint32_t *counter)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    (*counter)++;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+//=================================================================
+void ws_server_get_stats(ws_send_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    taskENTER_CRITICAL(&stats_lock);
+    *stats = send_stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+//=================================================================
+// Take the oldest pending event
+//=================================================================
+static bool ws_event_take_oldest(ws_msg_t *msg)
+{
+    if (!event_mutex || xSemaphoreTake(event_mutex, pdMS_TO_TICKS(20)) != pdTRUE)
+        return false;
+
+    int oldest = -1;
+    for (int i = 0; i < WS_EVENT_SLOTS; i++)
+    {
+        if (event_slots[i].msg.payload == NULL)
+            continue;
+        if (oldest == -1 || (int32_t)(event_slots[i].seq - event_slots[oldest].seq) < 0)
+            oldest = i;
+    }
+
+    if (oldest != -1)
+    {
+        *msg = event_slots[oldest].msg;
+        event_slots[oldest].msg.payload = NULL;
+    }
+
+    xSemaphoreGive(event_mutex);
+    return oldest != -1;
+}
+
+//=================================================================
+// Free all pending events
+//=================================================================
+static void ws_event_slots_clear(void)
+{
+    for (int i = 0; i < WS_EVENT_SLOTS; i++)
+    {
+        free(event_slots[i].msg.payload);
+        event_slots[i].msg.payload = NULL;
+    }
+}
+
+//=================================================================
+// Close current client session
+//=================================================================
+static void ws_close_client(void)
+{
+    if (xSemaphoreTake(socket_mutex, pdMS_TO_TICKS(20)) == pdTRUE)
+    {
+        if (client_socket != -1 && ws_server)
+        {
+            httpd_sess_trigger_close(ws_server, client_socket);
+        }
+        xSemaphoreGive(socket_mutex);
+    }
+}
+
+//=================================================================
+// Transmit one frame and free its payload
+//=================================================================
+static void ws_sender_transmit(ws_msg_t *msg)
+{
+    int sock = -1;
+    if (xSemaphoreTake(socket_mutex, pdMS_TO_TICKS(20)) == pdTRUE)
+    {
+        sock = client_socket;
+        xSemaphoreGive(socket_mutex);
+    }
+
+    if (sock == -1 || !ws_server || server_stopped)
+    {
+        ESP_LOGW(TAG, "No client connected. Dropping message.");
+        free(msg->payload); // ✅ Освобождаем память
+        return;
+    }
+
+    httpd_ws_frame_t ws_pkt = {
+        .final = msg->final,
+        .fragmented = msg->fragmented,
+        .type = msg->type,
+        .payload = (uint8_t *)msg->payload,
+        .len = msg->len};
+
+    esp_err_t ret = httpd_ws_send_frame_async(ws_server, sock, &ws_pkt);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to send message: %s", esp_err_to_name(ret));
+
+        // Попробуем закрыть сессию, если ошибка критическая
+        if (ret == ESP_ERR_INVALID_ARG || ret == ESP_ERR_INVALID_STATE)
+        {
+            ESP_LOGW(TAG, "Triggering close due to send error.");
+            httpd_sess_trigger_close(ws_server, sock);
+        }
+    }
+    else
+    {
+        ws_stats_inc(&send_stats.sent);
+        if (msg->type == HTTPD_WS_TYPE_TEXT)
+            ESP_LOGI(TAG, "Transmited text: %.*s", msg->len, msg->payload);
+        else
+            ESP_LOGI(TAG, "Transmited %u bytes", (unsigned)msg->len);
+    }
+
+    free(msg->payload);
+}
+
 //=================================================================
 // WebSocket sender task
 //=================================================================
 static void ws_sender_task(void *pvParameters)
 {
     ws_msg_t msg;
+    bool in_fragment = false;
 
     while (!server_stopped)
     {
-        if (xQueueReceive(ws_send_queue, &msg, pdMS_TO_TICKS(100)) == pdTRUE)
+        if (in_fragment)
         {
-            if (msg.payload == NULL)
-                break;
-
-            int sock = -1;
-            if (xSemaphoreTake(socket_mutex, pdMS_TO_TICKS(20)) == pdTRUE)
-            {
-                sock = client_socket;
-                xSemaphoreGive(socket_mutex);
-            }
-
-            if (sock == -1 || !ws_server || server_stopped)
+            // Фрагменты одного сообщения уходят подряд, события ждут
+            if (xQueueReceive(ws_send_queue, &msg, pdMS_TO_TICKS(WS_FRAGMENT_TIMEOUT_MS)) != pdTRUE)
             {
-                ESP_LOGW(TAG, "No client connected. Dropping message.");
-                free(msg.payload); // ✅ Освобождаем память
+                ESP_LOGE(TAG, "Fragmented message stalled, closing session");
+                ws_close_client();
+                in_fragment = false;
                 continue;
             }
+        }
+        else if (xQueueReceive(ws_send_queue, &msg, 0) != pdTRUE && !ws_event_take_oldest(&msg))
+        {
+            // Ждём уведомления от отправителя
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
 
-            httpd_ws_frame_t ws_pkt = {
-                .type = HTTPD_WS_TYPE_TEXT,
-                .payload = (uint8_t *)msg.payload,
-                .len = msg.len};
-
-            esp_err_t ret = httpd_ws_send_frame_async(ws_server, sock, &ws_pkt);
-            if (ret != ESP_OK)
-            {
-                ESP_LOGE(TAG, "Failed to send message: %s", esp_err_to_name(ret));
-
-                // Попробуем закрыть сессию, если ошибка критическая
-                if (ret == ESP_ERR_INVALID_ARG || ret == ESP_ERR_INVALID_STATE)
-                {
-                    ESP_LOGW(TAG, "Triggering close due to send error.");
-                    httpd_sess_trigger_close(ws_server, sock);
-                }
-            }
-            else
-            {
-                ESP_LOGI(TAG, "Transmited text: %.*s", msg.len, msg.payload);
-            }
+        if (msg.payload == NULL)
+            break;
 
-            free(msg.payload);
-        }
+        in_fragment = msg.fragmented && !msg.final;
+        ws_sender_transmit(&msg);
     }
 
     // Очистка оставшихся сообщений в очереди при завершении
@@ -298,21 +644,23 @@ static void ws_sender_task(void *pvParameters)
 //=================================================================
 // Start WebSocket server
 //=================================================================
-void captive_portal_ws_server_start(esp_netif_t *netif)
+esp_err_t captive_portal_ws_server_start(httpd_handle_t server, esp_netif_t *netif)
 {
-    if (netif == NULL)
+    if (server == NULL || netif == NULL)
     {
-        ESP_LOGE(TAG, "Invalid netif provided");
-        return;
+        ESP_LOGE(TAG, "Invalid server or netif provided");
+        return ESP_ERR_INVALID_ARG;
     }
 
     if (ws_server)
     {
         ESP_LOGW(TAG, "WebSocket server already running");
-        return;
+        return ESP_OK;
     }
 
     server_stopped = false;
+    websocket_routes_init();
+    memset(&send_stats, 0, sizeof(send_stats));
 
     // Create resources
     if (socket_mutex == NULL)
@@ -320,16 +668,32 @@ void captive_portal_ws_server_start(esp_netif_t *netif)
         socket_mutex = xSemaphoreCreateMutex();
     }
 
+    if (stream_mutex == NULL)
+    {
+        stream_mutex = xSemaphoreCreateMutex();
+    }
+
+    if (event_mutex == NULL)
+    {
+        event_mutex = xSemaphoreCreateMutex();
+    }
+
     if (ws_send_queue == NULL)
     {
         ws_send_queue = xQueueCreate(WS_SEND_QUEUE_SIZE, sizeof(ws_msg_t));
     }
 
-    if (!socket_mutex || !ws_send_queue)
+    if (!socket_mutex || !stream_mutex || !event_mutex || !ws_send_queue)
     {
         ESP_LOGE(TAG, "Failed to create resources");
         captive_portal_ws_server_stop(); // Cleanup
-        return;
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (ws_jobs_start() != ESP_OK)
+    {
+        captive_portal_ws_server_stop(); // Cleanup
+        return ESP_FAIL;
     }
 
     // Start sender task only if not already running
@@ -340,55 +704,29 @@ void captive_portal_ws_server_start(esp_netif_t *netif)
         {
             ESP_LOGE(TAG, "Failed to create sender task");
             captive_portal_ws_server_stop(); // Cleanup
-            return;
+            return ESP_FAIL;
         }
     }
 
-    // Configure and start HTTP server
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port = 8810;
-    config.ctrl_port = ESP_HTTPD_DEF_CTRL_PORT - 1;
-    config.close_fn = on_http_client_disconnect;
-    config.max_open_sockets = 1; // Ограничить до 1 соединения
-    config.stack_size = WS_TASK_STACK_SIZE;
-    config.lru_purge_enable = true;
-    config.recv_wait_timeout = 60;   // Таймаут ожидания данных
-    config.send_wait_timeout = 60;   // Таймаут отправки данных
-    config.global_user_ctx = NULL;
-    config.global_user_ctx_free_fn = NULL;
-    config.global_transport_ctx = NULL;
-    config.global_transport_ctx_free_fn = NULL;
-    config.open_fn = NULL;
-
-    ESP_LOGI(TAG, "Starting WebSocket server on port %d", config.server_port);
-
-    esp_err_t ret = httpd_start(&ws_server, &config);
-    if (ret == ESP_OK)
-    {
-        httpd_uri_t ws_uri = {
-            .uri = "/",
-            .method = HTTP_GET,
-            .handler = websocket_handler,
-            .user_ctx = netif,
-            .is_websocket = true};
-
-        if (httpd_register_uri_handler(ws_server, &ws_uri) == ESP_OK)
-        {
-            ESP_LOGI(TAG, "WebSocket handler registered successfully");
-            return;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Failed to register WebSocket handler");
-        }
-    }
-    else
+    // WebSocket - отдельный URI на общем HTTP-сервере, сессии закрывает он же
+    httpd_uri_t ws_uri = {
+        .uri = WS_URI,
+        .method = HTTP_GET,
+        .handler = websocket_handler,
+        .user_ctx = netif,
+        .is_websocket = true};
+
+    esp_err_t ret = httpd_register_uri_handler(server, &ws_uri);
+    if (ret != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to start WebSocket server: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to register WebSocket handler: %s", esp_err_to_name(ret));
+        captive_portal_ws_server_stop(); // Cleanup
+        return ret;
     }
 
-    // Cleanup on failure
-    captive_portal_ws_server_stop();
+    ws_server = server;
+    ESP_LOGI(TAG, "WebSocket handler registered on %s", WS_URI);
+    return ESP_OK;
 }
 
 //=================================================================
@@ -418,12 +756,11 @@ esp_err_t captive_portal_ws_server_stop(void)
 
     vTaskDelay(pdMS_TO_TICKS(100));
 
-    // Stop HTTP server
-    if (ws_server)
-    {
-        httpd_stop(ws_server);
-        ws_server = NULL;
-    }
+    // Сам HTTP-сервер останавливает http.c
+    ws_server = NULL;
+
+    // Stop job workers before the send queue goes away
+    ws_jobs_stop();
 
     // Clean up sender task
     if (sender_task_handle)
@@ -432,6 +769,7 @@ esp_err_t captive_portal_ws_server_stop(void)
         if (ws_send_queue)
         {
             xQueueSend(ws_send_queue, &stop_msg, pdMS_TO_TICKS(100));
+            xTaskNotifyGive(sender_task_handle);
         }
 
         for (int i = 0; i < 10 && sender_task_handle != NULL; i++)
@@ -468,18 +806,30 @@ esp_err_t captive_portal_ws_server_stop(void)
         socket_mutex = NULL;
     }
 
+    if (stream_mutex)
+    {
+        vSemaphoreDelete(stream_mutex);
+        stream_mutex = NULL;
+    }
+
+    if (event_mutex)
+    {
+        vSemaphoreDelete(event_mutex);
+        event_mutex = NULL;
+    }
+    ws_event_slots_clear();
+
+    ESP_LOGI(TAG, "Send stats: sent=%lu coalesced=%lu dropped_responses=%lu dropped_events=%lu",
+             send_stats.sent, send_stats.coalesced, send_stats.dropped_responses, send_stats.dropped_events);
     ESP_LOGI(TAG, "WebSocket server stopped completely");
     return ESP_OK;
 }
 
 //=================================================================
-// Send text message
+// Put message copy into send queue
 //=================================================================
-static bool ws_server_send_text(const char *data, size_t len)
+static bool ws_server_enqueue(const char *data, size_t len, httpd_ws_type_t type, bool fragmented, bool final)
 {
-    if (!ws_send_queue || !data || len == 0 || server_stopped)
-        return false;
-
     char *payload = malloc(len + 1);
     if (!payload)
         return false;
@@ -487,18 +837,48 @@ static bool ws_server_send_text(const char *data, size_t len)
     memcpy(payload, data, len);
     payload[len] = '\0';
 
-    ws_msg_t msg = {.payload = payload, .len = len};
+    ws_msg_t msg = {
+        .payload = payload,
+        .len = len,
+        .type = type,
+        .fragmented = fragmented,
+        .final = final};
 
     if (xQueueSend(ws_send_queue, &msg, pdMS_TO_TICKS(100)) != pdTRUE)
     {
         ESP_LOGE(TAG, "Failed to enqueue message");
+        ws_stats_inc(&send_stats.dropped_responses);
         free(payload);
         return false;
     }
 
+    if (sender_task_handle)
+        xTaskNotifyGive(sender_task_handle);
+
     return true;
 }
 
+//=================================================================
+// Send single-frame message
+//=================================================================
+static bool ws_server_send_frame(const char *data, size_t len, httpd_ws_type_t type)
+{
+    if (!ws_send_queue || !stream_mutex || !data || len == 0 || server_stopped)
+        return false;
+
+    // Ждём, пока отправитель фрагментированного ответа не поставит последний фрагмент
+    if (xSemaphoreTake(stream_mutex, pdMS_TO_TICKS(500)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Fragmented response in progress, message dropped");
+        return false;
+    }
+
+    bool ret = ws_server_enqueue(data, len, type, false, true);
+    xSemaphoreGive(stream_mutex);
+
+    return ret;
+}
+
 //=================================================================
 // Send string message
 //=================================================================
@@ -506,5 +886,125 @@ bool ws_server_send_string(const char *str)
 {
     if (!str)
         return false;
-    return ws_server_send_text(str, strlen(str));
-}
\ No newline at end of file
+    return ws_server_send_frame(str, strlen(str), HTTPD_WS_TYPE_TEXT);
+}
+
+//=================================================================
+// Send binary message
+//=================================================================
+bool ws_server_send_binary(const void *data, size_t len)
+{
+    return ws_server_send_frame(data, len, HTTPD_WS_TYPE_BINARY);
+}
+
+//=================================================================
+// Send event, replacing a pending one with the same key
+//=================================================================
+bool ws_server_send_event(const void *data, size_t len, bool binary, const char *key)
+{
+    if (!event_mutex || !data || len == 0 || !key || server_stopped)
+        return false;
+
+    char *payload = malloc(len + 1);
+    if (!payload)
+        return false;
+
+    memcpy(payload, data, len);
+    payload[len] = '\0';
+
+    if (xSemaphoreTake(event_mutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        ws_stats_inc(&send_stats.dropped_events);
+        free(payload);
+        return false;
+    }
+
+    int slot = -1;
+    int free_slot = -1;
+    for (int i = 0; i < WS_EVENT_SLOTS; i++)
+    {
+        if (event_slots[i].msg.payload == NULL)
+        {
+            if (free_slot == -1)
+                free_slot = i;
+        }
+        else if (strcmp(event_slots[i].key, key) == 0)
+        {
+            slot = i;
+        }
+    }
+
+    char *replaced = NULL;
+    if (slot != -1)
+    {
+        replaced = event_slots[slot].msg.payload;
+    }
+    else
+    {
+        slot = free_slot;
+    }
+
+    if (slot != -1)
+    {
+        strlcpy(event_slots[slot].key, key, sizeof(event_slots[slot].key));
+        event_slots[slot].seq = ++event_seq; // Обновлённое событие встаёт в конец очереди
+        event_slots[slot].msg = (ws_msg_t){
+            .payload = payload,
+            .len = len,
+            .type = binary ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT,
+            .fragmented = false,
+            .final = true};
+    }
+    xSemaphoreGive(event_mutex);
+
+    if (replaced)
+    {
+        ws_stats_inc(&send_stats.coalesced);
+        free(replaced);
+    }
+
+    if (slot == -1)
+    {
+        ESP_LOGW(TAG, "Event slots full, dropping '%s'", key);
+        ws_stats_inc(&send_stats.dropped_events);
+        free(payload);
+        return false;
+    }
+
+    if (sender_task_handle)
+        xTaskNotifyGive(sender_task_handle);
+
+    return true;
+}
+
+//=================================================================
+// Send one fragment of a message
+//=================================================================
+bool ws_server_send_fragment(const void *data, size_t len, bool binary, bool first, bool final)
+{
+    if (!ws_send_queue || !stream_mutex || !data || server_stopped)
+        return false;
+
+    if (first && xSemaphoreTake(stream_mutex, pdMS_TO_TICKS(500)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Stream is busy, fragmented message dropped");
+        return false;
+    }
+
+    httpd_ws_type_t type = HTTPD_WS_TYPE_CONTINUE;
+    if (first)
+        type = binary ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT;
+    if (ws_server_enqueue(data, len, type, true, final))
+    {
+        if (final)
+            xSemaphoreGive(stream_mutex);
+        return true;
+    }
+
+    // Недописанное сообщение клиент собрать не сможет - закрываем сессию
+    if (!first)
+        ws_close_client();
+
+    xSemaphoreGive(stream_mutex);
+    return false;
+}
@@ -0,0 +1,253 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+#include "server/server.h"
+
+#define WS_JOB_PRIORITY (tskIDLE_PRIORITY + 2)
+#define WS_JOB_STOP 0xFF
+#define WS_JOB_STOP_WARN_MS 5000 // Период напоминаний о задаче, которая задерживает остановку
+
+static const char *TAG = "WS jobs";
+
+// Job slot
+typedef struct
+{
+    ws_job_handler_t handler;
+    ws_binary_job_handler_t binary_handler; // Бинарный кадр передаётся обработчику без разбора
+    uint32_t id;
+    size_t len;
+    char frame[WS_RX_BUFFER_SIZE];
+} ws_job_t;
+
+static ws_job_t job_slots[WS_JOB_QUEUE_DEPTH];
+static QueueHandle_t free_slots = NULL; // Индексы свободных слотов
+static QueueHandle_t job_queue = NULL;  // Индексы слотов, ожидающих выполнения
+
+static request_t worker_requests[WS_JOB_WORKERS];
+static TaskHandle_t workers[WS_JOB_WORKERS];
+static volatile uint32_t worker_job[WS_JOB_WORKERS];
+static uint32_t next_job_id = 0;
+static portMUX_TYPE job_id_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//=================================================================
+// Worker task
+//=================================================================
+static void ws_job_worker_task(void *pvParameters)
+{
+    size_t worker = (size_t)pvParameters;
+    request_t *req = &worker_requests[worker];
+    uint8_t slot;
+
+    while (xQueueReceive(job_queue, &slot, portMAX_DELAY) == pdTRUE)
+    {
+        if (slot == WS_JOB_STOP)
+            break;
+
+        ws_job_t *job = &job_slots[slot];
+
+        if (job->binary_handler != NULL)
+        {
+            int64_t started = esp_timer_get_time();
+
+            worker_job[worker] = job->id;
+            job->binary_handler(job->frame, job->len);
+            worker_job[worker] = 0;
+
+            ESP_LOGI(TAG, "Job %lu done in %lld ms", job->id, (esp_timer_get_time() - started) / 1000);
+        }
+        else if (request_parse(req, job->frame, job->len) == ESP_OK)
+        {
+            int64_t started = esp_timer_get_time();
+
+            worker_job[worker] = job->id;
+            job->handler(req);
+            worker_job[worker] = 0;
+
+            ESP_LOGI(TAG, "Job %lu done in %lld ms", job->id, (esp_timer_get_time() - started) / 1000);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Job %lu: request parse failed", job->id);
+        }
+
+        xQueueSend(free_slots, &slot, 0);
+    }
+
+    workers[worker] = NULL;
+    vTaskDelete(NULL);
+}
+
+//=================================================================
+// Start worker pool
+//=================================================================
+esp_err_t ws_jobs_start(void)
+{
+    if (job_queue != NULL)
+        return ESP_OK;
+
+    free_slots = xQueueCreate(WS_JOB_QUEUE_DEPTH, sizeof(uint8_t));
+    job_queue = xQueueCreate(WS_JOB_QUEUE_DEPTH + WS_JOB_WORKERS, sizeof(uint8_t));
+    if (!free_slots || !job_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create job queues");
+        ws_jobs_stop();
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint8_t i = 0; i < WS_JOB_QUEUE_DEPTH; i++)
+    {
+        xQueueSend(free_slots, &i, 0);
+    }
+
+    for (size_t i = 0; i < WS_JOB_WORKERS; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "ws_job_%u", (unsigned)i);
+
+        worker_job[i] = 0;
+        if (xTaskCreate(ws_job_worker_task, name, WS_JOB_STACK_SIZE, (void *)i,
+                        WS_JOB_PRIORITY, &workers[i]) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create worker %u", (unsigned)i);
+            workers[i] = NULL;
+            ws_jobs_stop();
+            return ESP_FAIL;
+        }
+    }
+
+    ESP_LOGI(TAG, "Started %d workers, queue depth %d", WS_JOB_WORKERS, WS_JOB_QUEUE_DEPTH);
+    return ESP_OK;
+}
+
+//=================================================================
+// Stop worker pool
+//=================================================================
+void ws_jobs_stop(void)
+{
+    if (job_queue)
+    {
+        uint8_t stop = WS_JOB_STOP;
+        for (size_t i = 0; i < WS_JOB_WORKERS; i++)
+        {
+            if (workers[i])
+                xQueueSendToFront(job_queue, &stop, pdMS_TO_TICKS(100));
+        }
+
+        // Рабочие задачи не удаляются посреди задачи: она может держать stream_mutex
+        // или ресурсы клиента MQTT. Ожидание ограничено таймаутами самих задач,
+        // а отправка ответов после остановки сервера сразу завершается ошибкой.
+        // Из рабочей задачи ws_jobs_stop() не вызывается: она ждала бы сама себя
+        for (int wait = 1;; wait++)
+        {
+            bool running = false;
+            for (size_t i = 0; i < WS_JOB_WORKERS; i++)
+                running |= (workers[i] != NULL);
+            if (!running)
+                break;
+
+            if (wait % (WS_JOB_STOP_WARN_MS / 100) == 0)
+            {
+                for (size_t i = 0; i < WS_JOB_WORKERS; i++)
+                {
+                    if (workers[i] != NULL)
+                        ESP_LOGW(TAG, "Waiting for worker %u, job %lu", (unsigned)i, worker_job[i]);
+                }
+            }
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+
+        vQueueDelete(job_queue);
+        job_queue = NULL;
+    }
+
+    if (free_slots)
+    {
+        vQueueDelete(free_slots);
+        free_slots = NULL;
+    }
+}
+
+//=================================================================
+// Copy frame into a free slot and queue it
+//=================================================================
+static esp_err_t ws_jobs_enqueue(ws_job_handler_t handler, ws_binary_job_handler_t binary_handler,
+                                 const void *data, size_t len, uint32_t *job_id)
+{
+    if (job_queue == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    uint8_t slot;
+    if (xQueueReceive(free_slots, &slot, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Job queue is full");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ws_job_t *job = &job_slots[slot];
+    uint32_t id;
+
+    taskENTER_CRITICAL(&job_id_lock);
+    if (++next_job_id == 0)
+        next_job_id = 1;
+    id = next_job_id;
+    taskEXIT_CRITICAL(&job_id_lock);
+
+    job->id = id;
+    job->handler = handler;
+    job->binary_handler = binary_handler;
+    job->len = len;
+    memcpy(job->frame, data, len);
+    job->frame[len] = '\0';
+
+    if (xQueueSend(job_queue, &slot, 0) != pdTRUE)
+    {
+        xQueueSend(free_slots, &slot, 0);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (job_id)
+        *job_id = id;
+
+    return ESP_OK;
+}
+
+//=================================================================
+// Submit job
+//=================================================================
+esp_err_t ws_jobs_submit(ws_job_handler_t handler, const request_t *req, uint32_t *job_id)
+{
+    if (handler == NULL || req == NULL || req->len == 0 || req->len >= WS_RX_BUFFER_SIZE)
+        return ESP_ERR_INVALID_ARG;
+
+    return ws_jobs_enqueue(handler, NULL, req->json, req->len, job_id);
+}
+
+//=================================================================
+// Submit binary job
+//=================================================================
+esp_err_t ws_jobs_submit_binary(ws_binary_job_handler_t handler, const void *data, size_t len, uint32_t *job_id)
+{
+    if (handler == NULL || data == NULL || len == 0 || len >= WS_RX_BUFFER_SIZE)
+        return ESP_ERR_INVALID_ARG;
+
+    return ws_jobs_enqueue(NULL, handler, data, len, job_id);
+}
+
+//=================================================================
+// Current job id
+//=================================================================
+uint32_t ws_jobs_current_id(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    for (size_t i = 0; i < WS_JOB_WORKERS; i++)
+    {
+        if (workers[i] == self)
+            return worker_job[i];
+    }
+
+    return 0;
+}
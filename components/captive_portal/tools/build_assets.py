@@ -0,0 +1,448 @@
+#!/usr/bin/env python3
+"""
+Сборка веб-ресурсов портала в манифест для прошивки.
+
+Для каждой HTML-страницы внешние скрипты склеиваются в один бандл в порядке
+подключения, таблицы стилей встраиваются в <style>. JS и CSS минимизируются
+(комментарии и лишние пробелы), всё сжимается gzip -9 без метки времени -
+сборка воспроизводима.
+
+Результат - один файл на C: данные ресурсов и таблица http_asset_t (путь,
+MIME-тип, данные, длина, ETag по содержимому, кодирование, политика кэша).
+Поиск по пути идёт через совершенную хеш-функцию (FNV-1a с подобранным seed).
+
+Ссылки на ресурсы в HTML дополняются ?v=<хеш>, поэтому сами ресурсы можно
+кэшировать надолго: новая прошивка меняет их URL.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".txt": "text/plain",
+}
+
+# Страницы перепроверяются по ETag, ресурсы с ?v=<хеш> кэшируются надолго
+CACHE_PAGE = "no-cache"
+CACHE_ASSET = "public, max-age=31536000, immutable"
+
+SCRIPT_TAG = re.compile(r'[ \t]*<script src="([^"?#/]+)"></script>[ \t]*\n?')
+STYLE_TAG = re.compile(r'[ \t]*<link rel="stylesheet" href="([^"?#/]+)"\s*/?>[ \t]*\n?')
+
+# После этих символов и слов "/" начинает регулярное выражение, а не деление
+REGEX_PREFIX = set("(,=:[!&|?{};+-*%<>~^")
+REGEX_KEYWORDS = ("return", "typeof", "case", "do", "else", "in", "of", "void", "yield", "delete")
+
+PUNCT = set("{}()[];,:=<>+-*/%&|!?.~^")
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+# ---------------------------------------------------------------------------
+# Минимизация
+
+
+def minify_js(src):
+    """Удаляет комментарии и лишние пробелы. Строки, шаблоны и регулярные
+    выражения копируются как есть, переводы строк сохраняются там, где от них
+    может зависеть автоматическая вставка точки с запятой."""
+    out = []
+    i, n = 0, len(src)
+    pending = ""  # Отложенный пробел: " " или "\n"
+    templates = []  # Глубина фигурных скобок внутри ${...} вложенных шаблонов
+
+    def last_significant():
+        text = "".join(out[-16:]).rstrip()
+        return text
+
+    def emit(token):
+        nonlocal pending
+        if pending and out:
+            prev = out[-1][-1]
+            first = token[0]
+            joinable = prev in PUNCT or first in PUNCT
+            # "a + +b" и "a - -b" нельзя склеивать
+            if prev in "+-" and first == prev:
+                joinable = False
+            if pending == "\n":
+                if prev in "{;,(" or first in "}),;":
+                    out.append(token)
+                else:
+                    out.append("\n" + token)
+            elif joinable:
+                out.append(token)
+            else:
+                out.append(" " + token)
+        else:
+            out.append(token)
+        pending = ""
+
+    def read_template(start):
+        # Возвращает индекс после закрывающего ` или начала ${
+        j = start
+        while j < n:
+            c = src[j]
+            if c == "\\":
+                j += 2
+                continue
+            if c == "`":
+                return j + 1, False
+            if c == "$" and j + 1 < n and src[j + 1] == "{":
+                return j + 2, True
+            j += 1
+        raise ValueError("unterminated template literal")
+
+    while i < n:
+        c = src[i]
+
+        if c in " \t\r\n":
+            j = i
+            while j < n and src[j] in " \t\r\n":
+                j += 1
+            ws = src[i:j]
+            if "\n" in ws:
+                pending = "\n"
+            elif not pending:
+                pending = " "
+            i = j
+            continue
+
+        if c == "/" and i + 1 < n and src[i + 1] == "/":
+            while i < n and src[i] != "\n":
+                i += 1
+            continue
+
+        if c == "/" and i + 1 < n and src[i + 1] == "*":
+            end = src.index("*/", i + 2)
+            if "\n" in src[i:end]:
+                pending = "\n"
+            elif not pending:
+                pending = " "
+            i = end + 2
+            continue
+
+        if c in "'\"":
+            j = i + 1
+            while src[j] != c:
+                j += 2 if src[j] == "\\" else 1
+            emit(src[i:j + 1])
+            i = j + 1
+            continue
+
+        if c == "`" or (c == "}" and templates and templates[-1] == 0):
+            if c == "}":
+                templates.pop()
+            j, opened = read_template(i + 1)
+            if opened:
+                templates.append(0)
+            emit(src[i:j])
+            i = j
+            continue
+
+        if c == "/":
+            prev = last_significant()
+            is_regex = not prev or prev[-1] in REGEX_PREFIX or \
+                any(re.search(r"\b%s$" % k, prev) for k in REGEX_KEYWORDS)
+            if is_regex:
+                j = i + 1
+                in_class = False
+                while True:
+                    d = src[j]
+                    if d == "\\":
+                        j += 2
+                        continue
+                    if d == "[":
+                        in_class = True
+                    elif d == "]":
+                        in_class = False
+                    elif d == "/" and not in_class:
+                        break
+                    elif d == "\n":
+                        raise ValueError("unterminated regex at %d" % i)
+                    j += 1
+                j += 1
+                while j < n and (src[j].isalnum()):
+                    j += 1
+                emit(src[i:j])
+                i = j
+                continue
+
+        if c.isalnum() or c in "_$":
+            j = i
+            while j < n and (src[j].isalnum() or src[j] in "_$"):
+                j += 1
+            emit(src[i:j])
+            i = j
+            continue
+
+        if templates:
+            if c == "{":
+                templates[-1] += 1
+            elif c == "}":
+                templates[-1] -= 1
+        emit(c)
+        i += 1
+
+    return "".join(out) + "\n"
+
+
+def minify_css(src):
+    out = []
+    i, n = 0, len(src)
+    pending = False
+
+    while i < n:
+        c = src[i]
+        if c == "/" and src.startswith("/*", i):
+            i = src.index("*/", i + 2) + 2
+            pending = True
+            continue
+        if c in " \t\r\n":
+            pending = True
+            i += 1
+            continue
+        if c in "'\"":
+            j = i + 1
+            while src[j] != c:
+                j += 2 if src[j] == "\\" else 1
+            token = src[i:j + 1]
+            i = j + 1
+        else:
+            token = c
+            i += 1
+
+        if pending and out and out[-1] not in "{};,>" and token not in "{};,>":
+            out.append(" ")
+        if token == "}" and out and out[-1] == ";":
+            out.pop()
+        out.append(token)
+        pending = False
+
+    return "".join(out) + "\n"
+
+
+def minify(name, data):
+    ext = os.path.splitext(name)[1]
+    if ext == ".js":
+        return minify_js(data.decode("utf-8")).encode("utf-8")
+    if ext == ".css":
+        return minify_css(data.decode("utf-8")).encode("utf-8")
+    return data
+
+
+# ---------------------------------------------------------------------------
+# Страницы
+
+
+def bundle_page(name, html, sources):
+    """Склеивает скрипты страницы в <страница>.bundle.js и встраивает стили.
+    Возвращает новый HTML, имя бандла (или None) и использованные файлы."""
+    used = []
+    scripts = []
+
+    def inline_style(match):
+        css = match.group(1)
+        if css not in sources:
+            return match.group(0)
+        used.append(css)
+        return "<style>%s</style>\n" % minify_css(sources[css].decode("utf-8")).strip()
+
+    html = STYLE_TAG.sub(inline_style, html)
+
+    bundle = os.path.splitext(name)[0] + ".bundle.js"
+
+    def collect_script(match):
+        js = match.group(1)
+        if js not in sources:
+            return match.group(0)
+        used.append(js)
+        scripts.append(js)
+        # Бандл подключается на месте первого скрипта
+        return '<script src="%s"></script>\n' % bundle if len(scripts) == 1 else ""
+
+    html = SCRIPT_TAG.sub(collect_script, html)
+    html = re.sub(r"[ \t]*<!--.*?-->[ \t]*\n?", "", html, flags=re.S)
+    html = re.sub(r"\n\s*\n", "\n", html)
+
+    if not scripts:
+        return html, None, used, None
+
+    # Каждый файл отдельной инструкцией, как если бы он был отдельным <script>
+    code = ";\n".join(minify_js(sources[js].decode("utf-8")) for js in scripts)
+    return html, bundle, used, code.encode("utf-8")
+
+
+def version_links(html, hashes):
+    # src="script.js" -> src="script.js?v=<хеш>"
+    def replace(match):
+        attr, name = match.group(1), match.group(2)
+        if name not in hashes:
+            return match.group(0)
+        return '%s="%s?v=%s"' % (attr, name, hashes[name])
+
+    return re.sub(r'(src|href)="([^"?#/]+)"', replace, html)
+
+
+# ---------------------------------------------------------------------------
+# Манифест
+
+
+def symbol_name(name):
+    return "asset_" + re.sub(r"[^A-Za-z0-9]", "_", name)
+
+
+def fnv1a(seed, text):
+    h = seed
+    for b in text.encode():
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def perfect_hash(paths):
+    # Слотов - степень двойки не меньше удвоенного числа ключей
+    slots = 1
+    while slots < 2 * len(paths):
+        slots <<= 1
+
+    for seed in range(2166136261, 2166136261 + 100000):
+        table = [0xFF] * slots
+        for index, path in enumerate(paths):
+            slot = fnv1a(seed, path) & (slots - 1)
+            if table[slot] != 0xFF:
+                break
+            table[slot] = index
+        else:
+            return seed, table
+
+    raise RuntimeError("perfect hash seed not found")
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + " ".join("0x%02x," % b for b in data[i:i + 16]))
+    return "\n".join(lines)
+
+
+def write_if_changed(path, data):
+    if os.path.exists(path):
+        with open(path, "rb") as f:
+            if f.read() == data:
+                return
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--manifest", required=True, help="генерируемый манифест (.c)")
+    parser.add_argument("assets", nargs="+", help="исходные файлы")
+    args = parser.parse_args()
+
+    sources = {}
+    for path in sorted(args.assets, key=os.path.basename):
+        name = os.path.basename(path)
+        if os.path.splitext(name)[1] not in MIME_TYPES:
+            sys.exit("%s: unknown MIME type" % path)
+        with open(path, "rb") as f:
+            sources[name] = f.read()
+
+    raw_size = sum(len(data) for data in sources.values())
+    raw_requests = {}
+
+    # Страницы: бандл скриптов и встроенные стили
+    assets = {}
+    pages = {}
+    used = set()
+    for name, data in sources.items():
+        if not name.endswith(".html"):
+            continue
+        html = data.decode("utf-8")
+        raw_requests[name] = 1 + len(SCRIPT_TAG.findall(html)) + len(STYLE_TAG.findall(html))
+        html, bundle, files, code = bundle_page(name, html, sources)
+        pages[name] = html
+        used.update(files)
+        if bundle:
+            assets[bundle] = code
+
+    for name, data in sources.items():
+        if name not in used and not name.endswith(".html"):
+            assets[name] = minify(name, data)
+
+    # Хеши ресурсов подставляются в ссылки страниц, затем считаются хеши страниц
+    hashes = {name: content_hash(data) for name, data in assets.items()}
+    for name, html in pages.items():
+        assets[name] = version_links(html, hashes).encode("utf-8")
+        hashes[name] = content_hash(assets[name])
+
+    names = sorted(assets)
+    if len(names) >= 0xFF:
+        sys.exit("too many assets")
+
+    paths = ["/" + name for name in names]
+    seed, table = perfect_hash(paths)
+
+    lines = [
+        "// Сгенерировано tools/build_assets.py, не редактировать",
+        '#include "server/http_assets.h"',
+        "",
+    ]
+    entries = []
+    total_gz = 0
+
+    for name in names:
+        packed = gzip.compress(assets[name], compresslevel=9, mtime=0)
+        symbol = symbol_name(name)
+        ext = os.path.splitext(name)[1]
+
+        lines.append("static const unsigned char %s[%d] = {" % (symbol, len(packed)))
+        lines.append(c_bytes(packed))
+        lines.append("};")
+        lines.append("")
+
+        entries.append("    {%s, %s, %s, sizeof(%s), %s, \"gzip\", %s}," % (
+            c_string("/" + name), c_string(MIME_TYPES[ext]), symbol, symbol,
+            c_string('"%s"' % hashes[name]),
+            c_string(CACHE_PAGE if ext == ".html" else CACHE_ASSET)))
+        total_gz += len(packed)
+
+    lines.append("const http_asset_t http_assets[] = {")
+    lines += entries
+    lines += [
+        "};",
+        "",
+        "const uint8_t http_assets_count = %d;" % len(names),
+        "const uint32_t http_assets_seed = %uu;" % seed,
+        "const uint8_t http_assets_slot_mask = %d;" % (len(table) - 1),
+        "const uint8_t http_assets_slots[] = {%s};" % ", ".join(str(i) for i in table),
+        "",
+    ]
+    write_if_changed(args.manifest, "\n".join(lines).encode())
+
+    for page, before in raw_requests.items():
+        after = 1 + pages[page].count("<script src=") + pages[page].count('rel="stylesheet"')
+        print("Portal page %s: %d -> %d requests" % (page, before, after))
+    print("Portal assets: %d files, %d bytes -> %d files, %d bytes gzip" %
+          (len(sources), raw_size, len(names), total_gz))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""
+Снимок настроек устройства: экспорт, просмотр, правка и загрузка через WebSocket портала.
+
+Формат снимка описан в components/nvs_settings/settings_snapshot.h: заголовок
+(magic, версия, число записей, длина, CRC-32) и записи
+"пространство имен / ключ / тип NVS / значение".
+
+Типичная настройка партии устройств:
+
+    settings_snapshot.py export --host 192.168.4.1 -o golden.bin
+    settings_snapshot.py import --host 192.168.4.1 golden.bin --set device/hostname=lamp-042
+
+Устройство применяет снимок одной транзакцией и перезагружается.
+Нужен только стандартный Python 3.
+"""
+
+import argparse
+import base64
+import json
+import os
+import socket
+import struct
+import sys
+import zlib
+
+MAGIC = 0x50414E53
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+MAX_SIZE = 1000  # SETTINGS_SNAPSHOT_MAX_SIZE
+
+# nvs_type_t
+TYPES = {
+    0x01: ("u8", "<B"),
+    0x11: ("i8", "<b"),
+    0x02: ("u16", "<H"),
+    0x12: ("i16", "<h"),
+    0x04: ("u32", "<I"),
+    0x14: ("i32", "<i"),
+    0x08: ("u64", "<Q"),
+    0x18: ("i64", "<q"),
+    0x21: ("str", None),
+    0x42: ("blob", None),
+}
+TYPE_BY_NAME = {name: code for code, (name, _) in TYPES.items()}
+
+WS_TIMEOUT = 10
+
+
+# ---------------------------------------------------------------------------
+# Формат снимка
+
+
+def parse(blob):
+    if len(blob) < HEADER.size:
+        raise ValueError("snapshot too short")
+
+    magic, version, count, length, crc = HEADER.unpack_from(blob)
+    if magic != MAGIC:
+        raise ValueError("not a settings snapshot")
+    if version != VERSION:
+        raise ValueError("unsupported snapshot version %d" % version)
+    if length != len(blob) - HEADER.size:
+        raise ValueError("snapshot length mismatch")
+    if zlib.crc32(blob[HEADER.size:], zlib.crc32(blob[:12])) != crc:
+        raise ValueError("snapshot checksum mismatch")
+
+    records = []
+    pos = HEADER.size
+    for _ in range(count):
+        names = []
+        for _ in range(2):
+            size = blob[pos]
+            names.append(blob[pos + 1:pos + 1 + size].decode())
+            pos += 1 + size
+        nvs_type, size = struct.unpack_from("<BH", blob, pos)
+        pos += 3
+        records.append([names[0], names[1], nvs_type, bytes(blob[pos:pos + size])])
+        pos += size
+
+    if pos != len(blob):
+        raise ValueError("snapshot record count mismatch")
+    return records
+
+
+def build(records):
+    body = bytearray()
+    for namespace, key, nvs_type, data in records:
+        for name in (namespace, key):
+            raw = name.encode()
+            body += bytes([len(raw)]) + raw
+        body += struct.pack("<BH", nvs_type, len(data)) + data
+
+    head = struct.pack("<IHHI", MAGIC, VERSION, len(records), len(body))
+    blob = head + struct.pack("<I", zlib.crc32(bytes(body), zlib.crc32(head))) + body
+    if len(blob) > MAX_SIZE:
+        raise ValueError("snapshot is %d bytes, device accepts up to %d" % (len(blob), MAX_SIZE))
+    return blob
+
+
+def format_value(nvs_type, data):
+    name, fmt = TYPES.get(nvs_type, ("0x%02x" % nvs_type, None))
+    if fmt:
+        return name, str(struct.unpack(fmt, data)[0])
+    if name == "str":
+        return name, json.dumps(data[:-1].decode(errors="replace"), ensure_ascii=False)
+    return name, "%d bytes %s" % (len(data), data.hex())
+
+
+def encode_value(nvs_type, text):
+    name, fmt = TYPES[nvs_type]
+    if fmt:
+        return struct.pack(fmt, int(text, 0))
+    if name == "str":
+        return text.encode() + b"\0"
+    return bytes.fromhex(text)
+
+
+def apply_overrides(records, overrides):
+    """--set namespace/key=value; для нового ключа тип задается как namespace/key:u16=value"""
+    for item in overrides:
+        target, sep, text = item.partition("=")
+        path, _, type_name = target.partition(":")
+        namespace, _, key = path.partition("/")
+        if not sep or not namespace or not key:
+            raise ValueError("expected namespace/key[:type]=value, got %r" % item)
+
+        record = next((r for r in records if r[0] == namespace and r[1] == key), None)
+        if record is None:
+            nvs_type = TYPE_BY_NAME.get(type_name or "str")
+            if nvs_type is None:
+                raise ValueError("unknown type %r" % type_name)
+            record = [namespace, key, nvs_type, b""]
+            records.append(record)
+
+        if text == "" and record[2] == TYPE_BY_NAME["str"]:
+            records.remove(record)  # Пустое значение удаляет настройку, как в портале
+        else:
+            record[3] = encode_value(record[2], text)
+
+
+# ---------------------------------------------------------------------------
+# WebSocket (RFC 6455, только то, что нужно порталу)
+
+
+class WebSocket:
+    def __init__(self, host, port, path="/ws"):
+        self.sock = socket.create_connection((host, port), timeout=WS_TIMEOUT)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (path, host, key)).encode())
+
+        response = b""
+        while b"\r\n\r\n" not in response:
+            chunk = self.sock.recv(1024)
+            if not chunk:
+                raise ConnectionError("connection closed during handshake")
+            response += chunk
+        if b" 101 " not in response.split(b"\r\n", 1)[0]:
+            raise ConnectionError("WebSocket handshake failed: %s" % response.split(b"\r\n", 1)[0].decode())
+        self.pending = response.split(b"\r\n\r\n", 1)[1]
+
+    def _read(self, size):
+        while len(self.pending) < size:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("connection closed")
+            self.pending += chunk
+        data, self.pending = self.pending[:size], self.pending[size:]
+        return data
+
+    def send(self, payload, opcode):
+        header = bytearray([0x80 | opcode])
+        if len(payload) < 126:
+            header.append(0x80 | len(payload))
+        else:
+            header.append(0x80 | 126)
+            header += struct.pack(">H", len(payload))
+        mask = os.urandom(4)
+        header += mask
+        self.sock.sendall(bytes(header) + bytes(b ^ mask[i % 4] for i, b in enumerate(payload)))
+
+    def recv(self):
+        """Сообщение целиком: фрагменты склеиваются, ping получает pong"""
+        message = b""
+        while True:
+            first, second = self._read(2)
+            size = second & 0x7F
+            if size == 126:
+                size = struct.unpack(">H", self._read(2))[0]
+            elif size == 127:
+                size = struct.unpack(">Q", self._read(8))[0]
+            payload = self._read(size)
+            opcode = first & 0x0F
+
+            if opcode == 0x8:
+                raise ConnectionError("connection closed by device")
+            if opcode == 0x9:
+                self.send(payload, 0xA)
+                continue
+            if opcode == 0xA:
+                continue
+
+            message += payload
+            if first & 0x80:
+                return message
+
+    def request(self, target, action, data=None):
+        message = {"type": "request", "target": target, "action": action}
+        if data is not None:
+            message["data"] = data
+        self.send(json.dumps(message).encode(), 0x1)
+
+    def wait(self, target, statuses):
+        while True:
+            message = json.loads(self.recv())
+            if message.get("target") != target:
+                continue
+            if message.get("status") == "error":
+                raise RuntimeError("device error: %s" % message.get("message"))
+            if message.get("status") in statuses:
+                return message
+
+    def close(self):
+        try:
+            self.send(b"", 0x8)
+        finally:
+            self.sock.close()
+
+
+def connect(args):
+    ws = WebSocket(args.host, args.port)
+    ws.wait("system", ("ws_ready",))
+    return ws
+
+
+# ---------------------------------------------------------------------------
+# Команды
+
+
+def cmd_export(args):
+    ws = connect(args)
+    try:
+        ws.request("control", "export_settings")
+        message = ws.wait("control", ("settings_exported",))
+    finally:
+        ws.close()
+
+    blob = base64.b64decode(message["data"]["snapshot"])
+    records = parse(blob)
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print("%s: %d values, %d bytes" % (args.output, len(records), len(blob)))
+
+
+def cmd_show(args):
+    with open(args.snapshot, "rb") as f:
+        records = parse(f.read())
+    for namespace, key, nvs_type, data in records:
+        type_name, text = format_value(nvs_type, data)
+        print("%-20s %-5s %s" % ("%s/%s" % (namespace, key), type_name, text))
+
+
+def cmd_set(args):
+    with open(args.snapshot, "rb") as f:
+        records = parse(f.read())
+    apply_overrides(records, args.set)
+    blob = build(records)
+    with open(args.output or args.snapshot, "wb") as f:
+        f.write(blob)
+
+
+def cmd_import(args):
+    with open(args.snapshot, "rb") as f:
+        records = parse(f.read())
+    apply_overrides(records, args.set)
+    blob = build(records)
+
+    ws = connect(args)
+    try:
+        ws.send(blob, 0x2)
+        ws.wait("control", ("settings_imported",))
+    finally:
+        ws.close()
+    print("%s: %d values applied, device is rebooting" % (args.host, len(records)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    def device_args(p):
+        p.add_argument("--host", default="192.168.4.1", help="адрес портала устройства")
+        p.add_argument("--port", type=int, default=80)
+
+    p = sub.add_parser("export", help="снимок настроек устройства в файл")
+    device_args(p)
+    p.add_argument("-o", "--output", default="settings.bin")
+    p.set_defaults(func=cmd_export)
+
+    p = sub.add_parser("show", help="содержимое снимка")
+    p.add_argument("snapshot")
+    p.set_defaults(func=cmd_show)
+
+    p = sub.add_parser("set", help="правка значений в файле снимка")
+    p.add_argument("snapshot")
+    p.add_argument("set", nargs="+", metavar="namespace/key[:type]=value")
+    p.add_argument("-o", "--output", help="по умолчанию файл перезаписывается")
+    p.set_defaults(func=cmd_set)
+
+    p = sub.add_parser("import", help="применение снимка на устройстве")
+    device_args(p)
+    p.add_argument("snapshot")
+    p.add_argument("--set", action="append", default=[], metavar="namespace/key[:type]=value",
+                   help="значение только для этого устройства, например device/hostname=lamp-042")
+    p.set_defaults(func=cmd_import)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except (OSError, ValueError, RuntimeError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
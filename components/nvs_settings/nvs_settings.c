@@ -3,14 +3,71 @@
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "nvs_settings.h"
 
 #define CFG_NAMESPACE "data_config"
 
+// Запись откладывается, пока значения меняются чаще, чем раз в NVS_FLUSH_QUIET_MS
+#ifndef NVS_FLUSH_QUIET_MS
+#define NVS_FLUSH_QUIET_MS 1000
+#endif
+
+// Непрерывный поток изменений всё равно сохраняется не реже этого интервала
+#ifndef NVS_FLUSH_MAX_DELAY_MS
+#define NVS_FLUSH_MAX_DELAY_MS 10000
+#endif
+
+// Повтор записи после ошибки: первая пауза, далее удваивается до потолка
+#ifndef NVS_FLUSH_RETRY_MS
+#define NVS_FLUSH_RETRY_MS 1000
+#endif
+
+#ifndef NVS_FLUSH_RETRY_MAX_MS
+#define NVS_FLUSH_RETRY_MAX_MS 60000
+#endif
+
+// Пространства имен, полностью прочитанные в память; снимок настроек затрагивает 8
+#ifndef NVS_CACHE_NAMESPACES
+#define NVS_CACHE_NAMESPACES 16
+#endif
+
+// Значение ключа в памяти; dirty - еще не записано во flash
+typedef struct nvs_cache_entry
+{
+    struct nvs_cache_entry *next;
+    char namespace[NVS_NS_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    bool dirty;
+    bool retype; // Во flash ключ записан другим типом, перед записью его нужно удалить
+    bool failed; // Копия при сбросе: запись во flash не удалась
+    size_t length;
+    uint8_t data[];
+} nvs_cache_entry_t;
+
 static const char *TAG = "NVS";
 static SemaphoreHandle_t nvs_mutex = NULL;
 
+static SemaphoreHandle_t cache_mutex = NULL; // Только список, без обращений к flash
+static nvs_cache_entry_t *cache_list = NULL;
+static char cache_namespaces[NVS_CACHE_NAMESPACES][NVS_NS_NAME_MAX_SIZE] = {0};
+static TaskHandle_t flush_task = NULL;
+static nvs_settings_stats_t stats = {0};
+
+// Изменения, применяемые одним commit на пространство имен
+struct nvs_txn
+{
+    char namespace[NVS_NS_NAME_MAX_SIZE]; // Для следующих изменений
+    nvs_cache_entry_t *staged;            // NVS_TYPE_ANY - удаление ключа
+};
+
 static bool nvs_mutex_lock(TickType_t timeout)
 {
     if (nvs_mutex == NULL)
@@ -35,6 +92,188 @@ static void nvs_mutex_unlock(void)
     }
 }
 
+static size_t nvs_type_size(nvs_type_t type)
+{
+    switch (type)
+    {
+    case NVS_TYPE_U8:
+    case NVS_TYPE_I8:
+        return sizeof(uint8_t);
+    case NVS_TYPE_U16:
+    case NVS_TYPE_I16:
+        return sizeof(uint16_t);
+    case NVS_TYPE_U32:
+    case NVS_TYPE_I32:
+        return sizeof(uint32_t);
+    case NVS_TYPE_U64:
+    case NVS_TYPE_I64:
+        return sizeof(uint64_t);
+    default:
+        return 0; // Строки и blob переменной длины
+    }
+}
+
+static esp_err_t nvs_commit_counted(nvs_handle_t handle)
+{
+    esp_err_t err = nvs_commit(handle);
+    if (err == ESP_OK)
+    {
+        stats.commits++;
+    }
+    return err;
+}
+
+static nvs_cache_entry_t **cache_find(const char *namespace, const char *key)
+{
+    nvs_cache_entry_t **link = &cache_list;
+    while (*link != NULL)
+    {
+        if (strcmp((*link)->key, key) == 0 && strcmp((*link)->namespace, namespace) == 0)
+        {
+            return link;
+        }
+        link = &(*link)->next;
+    }
+    return NULL;
+}
+
+static nvs_cache_entry_t *cache_entry_create(const char *namespace, const char *key, nvs_type_t type, const void *data, size_t length)
+{
+    nvs_cache_entry_t *entry = malloc(sizeof(nvs_cache_entry_t) + length);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    entry->next = NULL;
+    strlcpy(entry->namespace, namespace, sizeof(entry->namespace));
+    strlcpy(entry->key, key, sizeof(entry->key));
+    entry->type = type;
+    entry->dirty = true;
+    entry->retype = false;
+    entry->failed = false;
+    entry->length = length;
+    if (data != NULL)
+    {
+        memcpy(entry->data, data, length);
+    }
+    return entry;
+}
+
+static bool cache_namespace_loaded(const char *namespace)
+{
+    bool loaded = false;
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < NVS_CACHE_NAMESPACES && cache_namespaces[i][0] != '\0'; i++)
+    {
+        if (strcmp(cache_namespaces[i], namespace) == 0)
+        {
+            loaded = true;
+            break;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+
+    return loaded;
+}
+
+static void cache_namespace_mark(const char *namespace)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < NVS_CACHE_NAMESPACES; i++)
+    {
+        if (cache_namespaces[i][0] == '\0')
+        {
+            strlcpy(cache_namespaces[i], namespace, sizeof(cache_namespaces[i]));
+            break;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+// Снятие отметки о загрузке: следующее чтение снова загрузит пространство имен с flash
+static void cache_namespace_unmark(const char *namespace)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < NVS_CACHE_NAMESPACES && cache_namespaces[i][0] != '\0'; i++)
+    {
+        if (strcmp(cache_namespaces[i], namespace) == 0)
+        {
+            // Отмеченные пространства имен идут подряд без пропусков
+            memmove(cache_namespaces[i], cache_namespaces[i + 1], (NVS_CACHE_NAMESPACES - i - 1) * sizeof(cache_namespaces[i]));
+            cache_namespaces[NVS_CACHE_NAMESPACES - 1][0] = '\0';
+            break;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+// Удаление значений из кэша; key == NULL - всё пространство имен
+static void cache_drop(const char *namespace, const char *key)
+{
+    if (cache_mutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    nvs_cache_entry_t **link = &cache_list;
+    while (*link != NULL)
+    {
+        nvs_cache_entry_t *entry = *link;
+        if (strcmp(entry->namespace, namespace) == 0 && (key == NULL || strcmp(entry->key, key) == 0))
+        {
+            *link = entry->next;
+            free(entry);
+            continue;
+        }
+        link = &entry->next;
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+static void nvs_flush_task(void *pvParameters)
+{
+    uint32_t retry_ms = 0;
+
+    while (1)
+    {
+        // Ждем первое изменение, затем паузу в потоке изменений
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t first_change = esp_timer_get_time();
+
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NVS_FLUSH_QUIET_MS)) > 0)
+        {
+            if (esp_timer_get_time() - first_change >= NVS_FLUSH_MAX_DELAY_MS * 1000LL)
+            {
+                break;
+            }
+        }
+
+        // Незаписанные значения снова помечены измененными, повтор - после паузы
+        if (nvs_settings_flush() != ESP_OK)
+        {
+            retry_ms = (retry_ms == 0) ? NVS_FLUSH_RETRY_MS : retry_ms * 2;
+            if (retry_ms > NVS_FLUSH_RETRY_MAX_MS)
+            {
+                retry_ms = NVS_FLUSH_RETRY_MAX_MS;
+            }
+            ESP_LOGW(TAG, "Flush failed, retry in %lu ms", retry_ms);
+            vTaskDelay(pdMS_TO_TICKS(retry_ms));
+        }
+        else
+        {
+            retry_ms = 0;
+        }
+    }
+}
+
+static void nvs_shutdown_handler(void)
+{
+    nvs_settings_flush();
+}
+
 esp_err_t nvs_storage_initialization(void)
 {
     esp_err_t err = nvs_flash_init();
@@ -61,41 +300,66 @@ esp_err_t nvs_storage_initialization(void)
                 return ESP_FAIL;
             }
         }
+
+        if (cache_mutex == NULL)
+        {
+            cache_mutex = xSemaphoreCreateMutex();
+            if (cache_mutex == NULL)
+            {
+                ESP_LOGE(TAG, "Failed to create NVS cache mutex");
+                return ESP_FAIL;
+            }
+        }
+
+        // Без задачи записи nvs_save_data сохраняет сразу
+        if (flush_task == NULL &&
+            xTaskCreate(nvs_flush_task, "nvs_flush", 3072, NULL, tskIDLE_PRIORITY + 2, &flush_task) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create NVS flush task, writes are synchronous");
+            flush_task = NULL;
+        }
+
+        esp_register_shutdown_handler(nvs_shutdown_handler);
     }
     return err;
 }
 
 void nvs_storage_deinit(void)
 {
-    if (nvs_mutex)
+    nvs_settings_flush();
+    esp_unregister_shutdown_handler(nvs_shutdown_handler);
+
+    if (flush_task)
     {
-        vSemaphoreDelete(nvs_mutex);
-        nvs_mutex = NULL;
+        vTaskDelete(flush_task);
+        flush_task = NULL;
     }
-}
 
-esp_err_t nvs_save_data(const char *namespace, const char *key, const void *data, size_t length, nvs_type_t type)
-{
-    if (namespace == NULL || key == NULL || data == NULL)
+    if (cache_mutex)
     {
-        return ESP_ERR_INVALID_ARG;
+        while (cache_list != NULL)
+        {
+            nvs_cache_entry_t *next = cache_list->next;
+            free(cache_list);
+            cache_list = next;
+        }
+        memset(cache_namespaces, 0, sizeof(cache_namespaces));
+
+        vSemaphoreDelete(cache_mutex);
+        cache_mutex = NULL;
     }
 
-    if (!nvs_mutex_lock(portMAX_DELAY))
+    if (nvs_mutex)
     {
-        return ESP_ERR_TIMEOUT;
+        vSemaphoreDelete(nvs_mutex);
+        nvs_mutex = NULL;
     }
+}
 
-    nvs_handle_t handle;
+static esp_err_t nvs_write_value(nvs_handle_t handle, const char *key, const void *data, size_t length, nvs_type_t type)
+{
     esp_err_t err;
 
-    err = nvs_open(namespace, NVS_READWRITE, &handle);
-    if (err != ESP_OK)
-    {
-        nvs_mutex_unlock();
-        return err;
-    }
-
     switch (type)
     {
     case NVS_TYPE_U8:
@@ -188,41 +452,13 @@ esp_err_t nvs_save_data(const char *namespace, const char *key, const void *data
         break;
     }
 
-    if (err != ESP_OK)
-    {
-        nvs_close(handle);
-        nvs_mutex_unlock();
-        return err;
-    }
-
-    err = nvs_commit(handle);
-    nvs_close(handle);
-    nvs_mutex_unlock();
     return err;
 }
 
-esp_err_t nvs_load_data(const char *namespace, const char *key, void *out_data, size_t *length, nvs_type_t type)
+static esp_err_t nvs_read_value(nvs_handle_t handle, const char *key, void *out_data, size_t *length, nvs_type_t type)
 {
-    if (namespace == NULL || key == NULL || length == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    if (!nvs_mutex_lock(portMAX_DELAY))
-    {
-        return ESP_ERR_TIMEOUT;
-    }
-
-    nvs_handle_t handle;
     esp_err_t err;
 
-    err = nvs_open(namespace, NVS_READONLY, &handle);
-    if (err != ESP_OK)
-    {
-        nvs_mutex_unlock();
-        return err;
-    }
-
     switch (type)
     {
     case NVS_TYPE_U8:
@@ -432,52 +668,129 @@ esp_err_t nvs_load_data(const char *namespace, const char *key, void *out_data,
         break;
     }
 
-    nvs_close(handle);
-    nvs_mutex_unlock();
     return err;
 }
 
-esp_err_t nvs_delete_data(const char *namespace, const char *key)
+// Все ключи пространства имен в кэш; вызывается под nvs_mutex
+static void cache_load_namespace(const char *namespace)
 {
-    if (namespace == NULL || key == NULL)
+    int64_t start = esp_timer_get_time();
+    uint32_t keys = 0;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(namespace, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
     {
-        return ESP_ERR_INVALID_ARG;
+        cache_namespace_mark(namespace); // Пространства имен еще нет во flash - пустое
+        return;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open namespace %s: %s", namespace, esp_err_to_name(err));
+        return;
     }
 
-    if (!nvs_mutex_lock(portMAX_DELAY))
+    nvs_iterator_t it = NULL;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, namespace, NVS_TYPE_ANY, &it);
+    while (res == ESP_OK)
     {
-        return ESP_ERR_TIMEOUT;
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        size_t length = 0;
+        err = nvs_read_value(handle, info.key, NULL, &length, info.type);
+
+        nvs_cache_entry_t *entry = (err == ESP_OK) ? cache_entry_create(namespace, info.key, info.type, NULL, length) : NULL;
+        if (entry == NULL)
+        {
+            break;
+        }
+
+        err = nvs_read_value(handle, info.key, entry->data, &length, info.type);
+        if (err != ESP_OK)
+        {
+            free(entry);
+            break;
+        }
+        entry->dirty = false;
+
+        // Ожидающее записи значение новее прочитанного
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+        if (cache_find(namespace, info.key) == NULL)
+        {
+            entry->next = cache_list;
+            cache_list = entry;
+            entry = NULL;
+        }
+        xSemaphoreGive(cache_mutex);
+        free(entry);
+
+        keys++;
+        res = nvs_entry_next(&it);
     }
+    nvs_release_iterator(it);
+    nvs_close(handle);
 
-    nvs_handle_t handle;
-    esp_err_t err;
+    int64_t elapsed = esp_timer_get_time() - start;
+    stats.namespace_loads++;
+    stats.read_us += elapsed;
 
-    err = nvs_open(namespace, NVS_READWRITE, &handle);
-    if (err != ESP_OK)
+    // Прочитанное остается в кэше, но отсутствующие в нем ключи по-прежнему ищутся во flash
+    if (res == ESP_OK)
     {
-        nvs_mutex_unlock();
-        return err;
+        ESP_LOGE(TAG, "Failed to cache namespace %s", namespace);
+        return;
     }
 
-    err = nvs_erase_key(handle, key);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    cache_namespace_mark(namespace);
+    ESP_LOGI(TAG, "Namespace %s cached: %lu keys in %lld us", namespace, keys, elapsed);
+}
+
+// Значения, которые не удалось записать, снова ждут записи, если их не заменили более новыми
+static void cache_restore_failed(const nvs_cache_entry_t *pending)
+{
+    uint32_t restored = 0;
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (const nvs_cache_entry_t *copy = pending; copy != NULL; copy = copy->next)
     {
-        nvs_close(handle);
-        nvs_mutex_unlock();
-        return err;
+        if (!copy->failed)
+        {
+            continue;
+        }
+
+        nvs_cache_entry_t **link = cache_find(copy->namespace, copy->key);
+        if (link == NULL)
+        {
+            continue; // Ключ удален
+        }
+
+        nvs_cache_entry_t *entry = *link;
+        if (!entry->dirty && entry->type == copy->type && entry->length == copy->length &&
+            memcmp(entry->data, copy->data, copy->length) == 0)
+        {
+            entry->dirty = true;
+            entry->retype = copy->retype;
+            restored++;
+        }
     }
+    xSemaphoreGive(cache_mutex);
 
-    err = nvs_commit(handle);
-    nvs_close(handle);
-    nvs_mutex_unlock();
-    return err;
+    if (restored > 0)
+    {
+        ESP_LOGW(TAG, "%lu values kept for the next flush", restored);
+        if (flush_task != NULL)
+        {
+            xTaskNotifyGive(flush_task);
+        }
+    }
 }
 
-esp_err_t nvs_clear_namespace(const char *namespace)
+esp_err_t nvs_settings_flush(void)
 {
-    if (namespace == NULL)
+    if (cache_mutex == NULL)
     {
-        return ESP_ERR_INVALID_ARG;
+        return ESP_ERR_INVALID_STATE;
     }
 
     if (!nvs_mutex_lock(portMAX_DELAY))
@@ -485,6 +798,772 @@ esp_err_t nvs_clear_namespace(const char *namespace)
         return ESP_ERR_TIMEOUT;
     }
 
+    // Копии измененных значений пишутся без cache_mutex, чтение и запись из памяти не ждут flash
+    nvs_cache_entry_t *pending = NULL;
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (nvs_cache_entry_t *entry = cache_list; entry != NULL; entry = entry->next)
+    {
+        if (!entry->dirty)
+        {
+            continue;
+        }
+
+        nvs_cache_entry_t *copy = cache_entry_create(entry->namespace, entry->key, entry->type, entry->data, entry->length);
+        if (copy == NULL)
+        {
+            break; // Остальное запишется при следующем сбросе
+        }
+        copy->retype = entry->retype;
+        copy->next = pending;
+        pending = copy;
+        entry->dirty = false;
+        entry->retype = false;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    if (pending == NULL)
+    {
+        nvs_mutex_unlock();
+        return ESP_OK;
+    }
+
+    int64_t start = esp_timer_get_time();
+    uint32_t keys = 0;
+    uint32_t commits = 0;
+    esp_err_t result = ESP_OK;
+
+    // Одно открытие и один commit на пространство имен
+    for (nvs_cache_entry_t *group = pending; group != NULL; group = group->next)
+    {
+        if (!group->dirty)
+        {
+            continue;
+        }
+
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(group->namespace, NVS_READWRITE, &handle);
+
+        for (nvs_cache_entry_t *entry = group; entry != NULL; entry = entry->next)
+        {
+            if (!entry->dirty || strcmp(entry->namespace, group->namespace) != 0)
+            {
+                continue;
+            }
+            entry->dirty = false;
+
+            if (err == ESP_OK && entry->retype)
+            {
+                nvs_erase_key(handle, entry->key);
+            }
+
+            esp_err_t set_err = (err == ESP_OK) ? nvs_write_value(handle, entry->key, entry->data, entry->length, entry->type) : err;
+            if (set_err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to write %s/%s: %s", entry->namespace, entry->key, esp_err_to_name(set_err));
+                stats.failures++;
+                entry->failed = true;
+                result = set_err;
+                continue;
+            }
+            keys++;
+        }
+
+        if (err == ESP_OK)
+        {
+            err = nvs_commit_counted(handle);
+            nvs_close(handle);
+            if (err == ESP_OK)
+            {
+                commits++;
+            }
+        }
+
+        if (err != ESP_OK)
+        {
+            // Без commit не записано ни одно значение пространства имен
+            for (nvs_cache_entry_t *entry = group; entry != NULL; entry = entry->next)
+            {
+                if (strcmp(entry->namespace, group->namespace) == 0)
+                {
+                    entry->failed = true;
+                }
+            }
+            result = err;
+        }
+    }
+
+    if (result != ESP_OK)
+    {
+        cache_restore_failed(pending);
+    }
+
+    while (pending != NULL)
+    {
+        nvs_cache_entry_t *next = pending->next;
+        free(pending);
+        pending = next;
+    }
+
+    stats.flushes++;
+    nvs_mutex_unlock();
+
+    ESP_LOGI(TAG, "Flushed %lu keys with %lu commits in %lld us (writes %lu, coalesced %lu, unchanged %lu, commits %lu)",
+             keys, commits, esp_timer_get_time() - start,
+             stats.writes, stats.coalesced, stats.unchanged, stats.commits);
+    return result;
+}
+
+// Проверка размера значения; для строк длина считается по терминатору
+static esp_err_t nvs_value_length(const void *data, size_t *length, nvs_type_t type)
+{
+    size_t type_size = nvs_type_size(type);
+    if (type == NVS_TYPE_STR)
+    {
+        *length = strlen((const char *)data) + 1;
+    }
+    else if (type == NVS_TYPE_BLOB)
+    {
+        if (*length == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    else if (type_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    else if (*length != type_size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_save_data(const char *namespace, const char *key, const void *data, size_t length, nvs_type_t type)
+{
+    if (namespace == NULL || key == NULL || data == NULL ||
+        strlen(namespace) >= NVS_NS_NAME_MAX_SIZE || strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_value_length(data, &length, type);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (cache_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    nvs_cache_entry_t *entry = cache_entry_create(namespace, key, type, data, length);
+    if (entry == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.writes++;
+
+    nvs_cache_entry_t **link = cache_find(namespace, key);
+    if (link != NULL)
+    {
+        nvs_cache_entry_t *old = *link;
+        if (old->type == type && old->length == length && memcmp(old->data, data, length) == 0)
+        {
+            stats.unchanged++;
+            xSemaphoreGive(cache_mutex);
+            free(entry);
+            return ESP_OK;
+        }
+
+        // Предыдущее значение еще не записано - замена вместо второго commit
+        if (old->dirty)
+        {
+            stats.coalesced++;
+        }
+        entry->retype = (old->type != type) || (old->dirty && old->retype);
+        entry->next = old->next;
+        *link = entry;
+        free(old);
+    }
+    else
+    {
+        entry->next = cache_list;
+        cache_list = entry;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    if (flush_task == NULL)
+    {
+        return nvs_settings_flush();
+    }
+
+    xTaskNotifyGive(flush_task);
+    return ESP_OK;
+}
+
+esp_err_t nvs_txn_begin(const char *namespace, nvs_txn_t *out_txn)
+{
+    if (namespace == NULL || out_txn == NULL || strlen(namespace) >= NVS_NS_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (cache_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    nvs_txn_t txn = calloc(1, sizeof(*txn));
+    if (txn == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    strlcpy(txn->namespace, namespace, sizeof(txn->namespace));
+    *out_txn = txn;
+    return ESP_OK;
+}
+
+esp_err_t nvs_txn_use_namespace(nvs_txn_t txn, const char *namespace)
+{
+    if (txn == NULL || namespace == NULL || strlen(namespace) >= NVS_NS_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    strlcpy(txn->namespace, namespace, sizeof(txn->namespace));
+    return ESP_OK;
+}
+
+// Подготовленное значение заменяет предыдущее для того же ключа
+static esp_err_t nvs_txn_stage(nvs_txn_t txn, const char *key, const void *data, size_t length, nvs_type_t type)
+{
+    if (txn == NULL || key == NULL || strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_cache_entry_t *entry = cache_entry_create(txn->namespace, key, type, data, length);
+    if (entry == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    nvs_cache_entry_t **link = &txn->staged;
+    while (*link != NULL && (strcmp((*link)->key, key) != 0 || strcmp((*link)->namespace, txn->namespace) != 0))
+    {
+        link = &(*link)->next;
+    }
+
+    if (*link != NULL)
+    {
+        entry->next = (*link)->next;
+        free(*link);
+    }
+    *link = entry;
+    return ESP_OK;
+}
+
+esp_err_t nvs_txn_set_data(nvs_txn_t txn, const char *key, const void *data, size_t length, nvs_type_t type)
+{
+    if (data == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_value_length(data, &length, type);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    return nvs_txn_stage(txn, key, data, length, type);
+}
+
+esp_err_t nvs_txn_set_str(nvs_txn_t txn, const char *key, const char *value)
+{
+    return nvs_txn_set_data(txn, key, value, 0, NVS_TYPE_STR);
+}
+
+esp_err_t nvs_txn_set_u8(nvs_txn_t txn, const char *key, uint8_t value)
+{
+    return nvs_txn_set_data(txn, key, &value, sizeof(value), NVS_TYPE_U8);
+}
+
+esp_err_t nvs_txn_set_u32(nvs_txn_t txn, const char *key, uint32_t value)
+{
+    return nvs_txn_set_data(txn, key, &value, sizeof(value), NVS_TYPE_U32);
+}
+
+esp_err_t nvs_txn_set_i32(nvs_txn_t txn, const char *key, int32_t value)
+{
+    return nvs_txn_set_data(txn, key, &value, sizeof(value), NVS_TYPE_I32);
+}
+
+esp_err_t nvs_txn_set_blob(nvs_txn_t txn, const char *key, const void *data, size_t length)
+{
+    return nvs_txn_set_data(txn, key, data, length, NVS_TYPE_BLOB);
+}
+
+esp_err_t nvs_txn_erase(nvs_txn_t txn, const char *key)
+{
+    return nvs_txn_stage(txn, key, NULL, 0, NVS_TYPE_ANY);
+}
+
+void nvs_txn_rollback(nvs_txn_t txn)
+{
+    if (txn == NULL)
+    {
+        return;
+    }
+
+    while (txn->staged != NULL)
+    {
+        nvs_cache_entry_t *next = txn->staged->next;
+        free(txn->staged);
+        txn->staged = next;
+    }
+    free(txn);
+}
+
+// Возврат уже записанных ключей пространства имен к значениям из кэша; вызывается под nvs_mutex
+static void nvs_txn_restore(nvs_handle_t handle, nvs_txn_t txn, const char *namespace, const nvs_cache_entry_t *failed)
+{
+    // Отсутствие ключа в кэше означает отсутствие во flash, только если пространство имен загружено целиком
+    bool loaded = cache_namespace_loaded(namespace);
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (const nvs_cache_entry_t *entry = txn->staged; entry != failed; entry = entry->next)
+    {
+        if (strcmp(entry->namespace, namespace) != 0)
+        {
+            continue;
+        }
+
+        nvs_cache_entry_t **link = cache_find(namespace, entry->key);
+        if (link == NULL && !loaded)
+        {
+            ESP_LOGE(TAG, "Previous value of %s/%s unknown, not restored", namespace, entry->key);
+            continue;
+        }
+
+        esp_err_t err = (link != NULL) ? nvs_write_value(handle, entry->key, (*link)->data, (*link)->length, (*link)->type)
+                                       : nvs_erase_key(handle, entry->key);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+        {
+            ESP_LOGE(TAG, "Failed to restore %s/%s: %s", namespace, entry->key, esp_err_to_name(err));
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+
+    nvs_commit_counted(handle);
+}
+
+// Первое изменение транзакции в этом пространстве имен
+static bool nvs_txn_namespace_first(nvs_txn_t txn, const nvs_cache_entry_t *entry)
+{
+    for (const nvs_cache_entry_t *prev = txn->staged; prev != entry; prev = prev->next)
+    {
+        if (strcmp(prev->namespace, entry->namespace) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Запись изменений одного пространства имен; при ошибке они уже отменены. Вызывается под nvs_mutex
+static esp_err_t nvs_txn_write_namespace(nvs_txn_t txn, const char *namespace, uint32_t *keys)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    for (nvs_cache_entry_t *entry = txn->staged; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->namespace, namespace) != 0)
+        {
+            continue;
+        }
+
+        if (entry->type == NVS_TYPE_ANY)
+        {
+            err = nvs_erase_key(handle, entry->key);
+            if (err == ESP_ERR_NVS_NOT_FOUND)
+            {
+                err = ESP_OK;
+            }
+        }
+        else
+        {
+            xSemaphoreTake(cache_mutex, portMAX_DELAY);
+            nvs_cache_entry_t **link = cache_find(namespace, entry->key);
+            bool retype = (link != NULL && (*link)->type != entry->type);
+            xSemaphoreGive(cache_mutex);
+
+            if (retype)
+            {
+                nvs_erase_key(handle, entry->key);
+            }
+            err = nvs_write_value(handle, entry->key, entry->data, entry->length, entry->type);
+        }
+
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Transaction %s failed on key %s: %s, rolling back", namespace, entry->key, esp_err_to_name(err));
+            stats.failures++;
+            nvs_txn_restore(handle, txn, namespace, entry);
+            break;
+        }
+        (*keys)++;
+    }
+
+    if (err == ESP_OK)
+    {
+        err = nvs_commit_counted(handle);
+        if (err != ESP_OK)
+        {
+            // nvs_set_* уже записали значения во flash, а кэш хранит прежние
+            ESP_LOGE(TAG, "Transaction %s commit failed: %s, rolling back", namespace, esp_err_to_name(err));
+            stats.failures++;
+            nvs_txn_restore(handle, txn, namespace, NULL);
+        }
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t nvs_txn_commit(nvs_txn_t txn)
+{
+    if (txn == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (txn->staged == NULL)
+    {
+        nvs_txn_rollback(txn);
+        return ESP_OK;
+    }
+
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        nvs_txn_rollback(txn);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Прежние значения нужны в кэше для отката при ошибке записи
+    for (nvs_cache_entry_t *entry = txn->staged; entry != NULL; entry = entry->next)
+    {
+        if (nvs_txn_namespace_first(txn, entry) && !cache_namespace_loaded(entry->namespace))
+        {
+            cache_load_namespace(entry->namespace);
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+    uint32_t keys = 0;
+    uint32_t namespaces = 0;
+    esp_err_t err = ESP_OK;
+
+    nvs_cache_entry_t *failed = NULL;
+    for (nvs_cache_entry_t *entry = txn->staged; entry != NULL; entry = entry->next)
+    {
+        if (!nvs_txn_namespace_first(txn, entry))
+        {
+            continue;
+        }
+
+        err = nvs_txn_write_namespace(txn, entry->namespace, &keys);
+        if (err != ESP_OK)
+        {
+            failed = entry;
+            break;
+        }
+        namespaces++;
+    }
+
+    // Пространства имен, записанные до ошибки, тоже возвращаются к прежним значениям
+    for (nvs_cache_entry_t *entry = txn->staged; failed != NULL && entry != failed; entry = entry->next)
+    {
+        nvs_handle_t handle;
+        if (!nvs_txn_namespace_first(txn, entry) || nvs_open(entry->namespace, NVS_READWRITE, &handle) != ESP_OK)
+        {
+            continue;
+        }
+        nvs_txn_restore(handle, txn, entry->namespace, NULL);
+        nvs_close(handle);
+    }
+
+    if (err == ESP_OK)
+    {
+        // Записанные значения замещают и чистые, и ожидающие записи копии в кэше
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+        while (txn->staged != NULL)
+        {
+            nvs_cache_entry_t *entry = txn->staged;
+            txn->staged = entry->next;
+
+            nvs_cache_entry_t **link = cache_find(entry->namespace, entry->key);
+            if (link != NULL)
+            {
+                nvs_cache_entry_t *old = *link;
+                *link = old->next;
+                free(old);
+            }
+
+            if (entry->type == NVS_TYPE_ANY)
+            {
+                free(entry);
+                continue;
+            }
+
+            entry->dirty = false;
+            entry->next = cache_list;
+            cache_list = entry;
+        }
+        stats.transactions++;
+        xSemaphoreGive(cache_mutex);
+
+        ESP_LOGI(TAG, "Transaction %s: %lu keys, %lu commits in %lld us", txn->namespace, keys, namespaces, esp_timer_get_time() - start);
+    }
+
+    nvs_mutex_unlock();
+    nvs_txn_rollback(txn); // Освобождает то, что не перешло в кэш
+    return err;
+}
+
+void nvs_settings_get_stats(nvs_settings_stats_t *out_stats)
+{
+    if (out_stats == NULL || cache_mutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out_stats = stats;
+    xSemaphoreGive(cache_mutex);
+}
+
+static esp_err_t cache_load(const char *namespace, const char *key, void *out_data, size_t *length, nvs_type_t type)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.reads++;
+    nvs_cache_entry_t **link = cache_find(namespace, key);
+    if (link != NULL && (*link)->type == type)
+    {
+        nvs_cache_entry_t *entry = *link;
+        stats.hits++;
+        if (out_data != NULL && *length < entry->length)
+        {
+            err = ESP_ERR_INVALID_SIZE;
+        }
+        else
+        {
+            if (out_data != NULL)
+            {
+                memcpy(out_data, entry->data, entry->length);
+            }
+            err = ESP_OK;
+        }
+        *length = entry->length;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    return err;
+}
+
+esp_err_t nvs_load_data(const char *namespace, const char *key, void *out_data, size_t *length, nvs_type_t type)
+{
+    if (namespace == NULL || key == NULL || length == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (cache_mutex != NULL)
+    {
+        // Пространство имен читается из flash один раз, дальше - только из памяти
+        if (!cache_namespace_loaded(namespace) && nvs_mutex_lock(portMAX_DELAY))
+        {
+            if (!cache_namespace_loaded(namespace))
+            {
+                cache_load_namespace(namespace);
+            }
+            nvs_mutex_unlock();
+        }
+
+        esp_err_t cached = cache_load(namespace, key, out_data, length, type);
+        if (cached != ESP_ERR_NVS_NOT_FOUND || cache_namespace_loaded(namespace))
+        {
+            return cached;
+        }
+    }
+
+    // Пространство имен не поместилось в кэш
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    int64_t start = esp_timer_get_time();
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(namespace, NVS_READONLY, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_read_value(handle, key, out_data, length, type);
+        nvs_close(handle);
+    }
+
+    stats.read_us += esp_timer_get_time() - start;
+    nvs_mutex_unlock();
+    return err;
+}
+
+esp_err_t nvs_foreach_data(const char *namespace, nvs_data_cb_t callback, void *ctx)
+{
+    if (namespace == NULL || callback == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Перебор идет по flash, отложенные значения должны попасть туда раньше
+    esp_err_t err = nvs_settings_flush();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    nvs_handle_t handle;
+    err = nvs_open(namespace, NVS_READONLY, &handle);
+    if (err != ESP_OK)
+    {
+        nvs_mutex_unlock();
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_OK : err;
+    }
+
+    nvs_iterator_t it = NULL;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, namespace, NVS_TYPE_ANY, &it);
+    while (res == ESP_OK)
+    {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        size_t length = 0;
+        err = nvs_read_value(handle, info.key, NULL, &length, info.type);
+
+        void *data = (err == ESP_OK) ? malloc(length) : NULL;
+        if (data == NULL)
+        {
+            err = (err == ESP_OK) ? ESP_ERR_NO_MEM : err;
+            break;
+        }
+
+        err = nvs_read_value(handle, info.key, data, &length, info.type);
+        if (err == ESP_OK)
+        {
+            err = callback(info.key, info.type, data, length, ctx);
+        }
+        free(data);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    nvs_close(handle);
+    nvs_mutex_unlock();
+
+    return (res == ESP_OK) ? err : ESP_OK;
+}
+
+void nvs_cache_invalidate(const char *namespace)
+{
+    if (namespace == NULL || cache_mutex == NULL)
+    {
+        return;
+    }
+
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        return;
+    }
+
+    cache_drop(namespace, NULL);
+    cache_namespace_unmark(namespace);
+
+    nvs_mutex_unlock();
+}
+
+esp_err_t nvs_delete_data(const char *namespace, const char *key)
+{
+    if (namespace == NULL || key == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    cache_drop(namespace, key);
+
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        nvs_mutex_unlock();
+        return err;
+    }
+
+    err = nvs_erase_key(handle, key);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        nvs_close(handle);
+        nvs_mutex_unlock();
+        return err;
+    }
+
+    err = nvs_commit_counted(handle);
+    nvs_close(handle);
+    nvs_mutex_unlock();
+    return err;
+}
+
+esp_err_t nvs_clear_namespace(const char *namespace)
+{
+    if (namespace == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!nvs_mutex_lock(portMAX_DELAY))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    cache_drop(namespace, NULL);
+
     nvs_handle_t handle;
     esp_err_t err;
 
@@ -503,7 +1582,7 @@ esp_err_t nvs_clear_namespace(const char *namespace)
         return err;
     }
 
-    err = nvs_commit(handle);
+    err = nvs_commit_counted(handle);
     nvs_close(handle);
     nvs_mutex_unlock();
     return err;
@@ -538,7 +1617,7 @@ esp_err_t nvs_set_flag(const char *key, bool value)
         return err;
     }
 
-    err = nvs_commit(handle);
+    err = nvs_commit_counted(handle);
     nvs_close(handle);
     nvs_mutex_unlock();
     return err;
@@ -604,7 +1683,7 @@ esp_err_t nvs_clear_flag(const char *key)
         return err;
     }
 
-    err = nvs_commit(handle);
+    err = nvs_commit_counted(handle);
     nvs_close(handle);
     nvs_mutex_unlock();
     return err;
@@ -10,6 +10,38 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Счетчики кэша настроек
+ */
+typedef struct
+{
+    uint32_t writes;          // Вызовы nvs_save_data
+    uint32_t coalesced;       // Значения, заменившие еще не записанные
+    uint32_t unchanged;       // Запись значения, которое уже в кэше
+    uint32_t flushes;         // Сбросы кэша во flash
+    uint32_t commits;         // Вызовы nvs_commit
+    uint32_t failures;        // Ключи, которые не удалось записать
+    uint32_t reads;           // Вызовы nvs_load_data
+    uint32_t hits;            // Чтения, обслуженные из памяти
+    uint32_t namespace_loads; // Пространства имен, прочитанные из flash целиком
+    uint32_t read_us;         // Суммарное время чтения из flash, мкс
+    uint32_t transactions;    // Примененные транзакции
+} nvs_settings_stats_t;
+
+/**
+ * @brief Транзакция: изменения нескольких ключей, по умолчанию одного пространства имен
+ */
+typedef struct nvs_txn *nvs_txn_t;
+
+/**
+ * @brief Обработчик значения для nvs_foreach_data()
+ *
+ * Вызывается под блокировкой хранилища: функции nvs_settings, кроме nvs_txn_*, из него вызывать нельзя.
+ *
+ * @return esp_err_t ESP_OK для продолжения перебора, иначе перебор прекращается с этим кодом
+ */
+typedef esp_err_t (*nvs_data_cb_t)(const char *key, nvs_type_t type, const void *data, size_t length, void *ctx);
+
 /**
  * @brief Инициализация NVS хранилища
  * 
@@ -24,6 +56,10 @@ void nvs_storage_deinit(void);
 
 /**
  * @brief Сохранение данных в NVS
+ *
+ * Значение попадает в кэш и записывается во flash фоновой задачей после паузы в изменениях
+ * (не позже NVS_FLUSH_MAX_DELAY_MS) или при esp_restart(). Повторные изменения ключа
+ * до записи дают один commit. nvs_load_data() сразу возвращает новое значение.
  * 
  * @param namespace Пространство имен
  * @param key Ключ данных
@@ -34,8 +70,99 @@ void nvs_storage_deinit(void);
  */
 esp_err_t nvs_save_data(const char *namespace, const char *key, const void *data, size_t length, nvs_type_t type);
 
+/**
+ * @brief Немедленная запись всех отложенных значений, один commit на пространство имен
+ *
+ * Нужна, когда значение должно пережить отключение питания сразу после сохранения.
+ *
+ * @return esp_err_t ESP_OK при успешной записи, иначе код последней ошибки
+ */
+esp_err_t nvs_settings_flush(void);
+
+/**
+ * @brief Получение счетчиков кэша настроек
+ *
+ * @param out_stats Указатель для возвращаемых счетчиков
+ */
+void nvs_settings_get_stats(nvs_settings_stats_t *out_stats);
+
+/**
+ * @brief Начало транзакции
+ *
+ * Изменения накапливаются в памяти и записываются во flash только в nvs_txn_commit().
+ * Транзакция завершается вызовом nvs_txn_commit() или nvs_txn_rollback().
+ *
+ * @param namespace Пространство имен
+ * @param out_txn Указатель для возвращаемой транзакции
+ * @return esp_err_t ESP_OK при успешном создании, иначе код ошибки
+ */
+esp_err_t nvs_txn_begin(const char *namespace, nvs_txn_t *out_txn);
+
+/**
+ * @brief Смена пространства имен для следующих изменений транзакции
+ *
+ * Все пространства имен транзакции записываются в nvs_txn_commit(); при ошибке
+ * в любом из них возвращаются прежние значения во всех.
+ *
+ * @param txn Транзакция
+ * @param namespace Пространство имен
+ * @return esp_err_t ESP_OK при успешной смене, иначе код ошибки
+ */
+esp_err_t nvs_txn_use_namespace(nvs_txn_t txn, const char *namespace);
+
+/**
+ * @brief Добавление значения в транзакцию, аргументы как у nvs_save_data()
+ *
+ * @param txn Транзакция
+ * @param key Ключ данных
+ * @param data Указатель на данные
+ * @param length Размер данных в байтах
+ * @param type Тип данных NVS
+ * @return esp_err_t ESP_OK при успешном добавлении, иначе код ошибки
+ */
+esp_err_t nvs_txn_set_data(nvs_txn_t txn, const char *key, const void *data, size_t length, nvs_type_t type);
+
+/**
+ * @brief Типизированные варианты nvs_txn_set_data()
+ */
+esp_err_t nvs_txn_set_str(nvs_txn_t txn, const char *key, const char *value);
+esp_err_t nvs_txn_set_u8(nvs_txn_t txn, const char *key, uint8_t value);
+esp_err_t nvs_txn_set_u32(nvs_txn_t txn, const char *key, uint32_t value);
+esp_err_t nvs_txn_set_i32(nvs_txn_t txn, const char *key, int32_t value);
+esp_err_t nvs_txn_set_blob(nvs_txn_t txn, const char *key, const void *data, size_t length);
+
+/**
+ * @brief Удаление ключа в составе транзакции
+ *
+ * @param txn Транзакция
+ * @param key Ключ для удаления
+ * @return esp_err_t ESP_OK при успешном добавлении, иначе код ошибки
+ */
+esp_err_t nvs_txn_erase(nvs_txn_t txn, const char *key);
+
+/**
+ * @brief Запись всех изменений транзакции: одно открытие и один commit на пространство имен
+ *
+ * При ошибке записи уже измененные ключи возвращаются к прежним значениям.
+ * Транзакция освобождается в любом случае.
+ *
+ * @param txn Транзакция
+ * @return esp_err_t ESP_OK при успешной записи, иначе код ошибки
+ */
+esp_err_t nvs_txn_commit(nvs_txn_t txn);
+
+/**
+ * @brief Отмена транзакции без записи во flash
+ *
+ * @param txn Транзакция (может быть NULL)
+ */
+void nvs_txn_rollback(nvs_txn_t txn);
+
 /**
  * @brief Загрузка данных из NVS
+ *
+ * При первом обращении пространство имен целиком читается в память,
+ * следующие чтения из него flash не затрагивают.
  * 
  * @param namespace Пространство имен
  * @param key Ключ данных
@@ -46,6 +173,29 @@ esp_err_t nvs_save_data(const char *namespace, const char *key, const void *data
  */
 esp_err_t nvs_load_data(const char *namespace, const char *key, void *out_data, size_t *length, nvs_type_t type);
 
+/**
+ * @brief Перебор всех значений пространства имен во flash
+ *
+ * Отложенные значения предварительно записываются, поэтому перебор видит и их.
+ *
+ * @param namespace Пространство имен
+ * @param callback Обработчик значения
+ * @param ctx Аргумент обработчика
+ * @return esp_err_t ESP_OK после перебора всех значений (в том числе пустого пространства имен),
+ *         код ошибки обработчика или чтения
+ */
+esp_err_t nvs_foreach_data(const char *namespace, nvs_data_cb_t callback, void *ctx);
+
+/**
+ * @brief Сброс кэша пространства имен
+ *
+ * Нужен для пространств имен, которые кроме nvs_settings пишутся напрямую через nvs_set_*():
+ * следующее чтение снова загрузит их с flash. Отложенные значения пространства имен отбрасываются.
+ *
+ * @param namespace Пространство имен
+ */
+void nvs_cache_invalidate(const char *namespace);
+
 /**
  * @brief Удаление данных из NVS по ключу
  * 
@@ -0,0 +1,340 @@
+#include "settings.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Settings";
+
+static const setting_desc_t settings_table[SETTING_COUNT] = {
+#define SETTING_DESC(id, ns, key, type, min, max, def) [SETTING_##id] = {ns, key, type, min, max, def},
+    SETTINGS_SCHEMA(SETTING_DESC)
+#undef SETTING_DESC
+};
+
+const setting_desc_t *settings_desc(setting_id_t id)
+{
+    if (id < 0 || id >= SETTING_COUNT)
+    {
+        return NULL;
+    }
+    return &settings_table[id];
+}
+
+static nvs_type_t setting_nvs_type(setting_type_t type)
+{
+    switch (type)
+    {
+    case SETTING_TYPE_U16:
+        return NVS_TYPE_U16;
+    case SETTING_TYPE_BOOL:
+    case SETTING_TYPE_GPIO:
+        return NVS_TYPE_U8;
+    default:
+        return NVS_TYPE_STR;
+    }
+}
+
+static bool setting_in_range(const setting_desc_t *desc, int32_t value)
+{
+    if (value < desc->min || value > desc->max)
+    {
+        return false;
+    }
+    if (desc->type == SETTING_TYPE_GPIO && !GPIO_IS_VALID_OUTPUT_GPIO(value))
+    {
+        return false;
+    }
+    return true;
+}
+
+// Разбор текста из JSON или из строки, сохраненной прежней версией
+static esp_err_t setting_parse_text(const setting_desc_t *desc, const char *text, int32_t *out_value)
+{
+    if (desc->type == SETTING_TYPE_BOOL)
+    {
+        if (strcmp(text, "true") == 0)
+        {
+            *out_value = 1;
+        }
+        else if (strcmp(text, "false") == 0)
+        {
+            *out_value = 0;
+        }
+        else
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    }
+
+    char *end = NULL;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || !setting_in_range(desc, value))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out_value = value;
+    return ESP_OK;
+}
+
+// Числовое значение в кодировке схемы: u16 или u8
+static esp_err_t setting_load_raw(const setting_desc_t *desc, int32_t *out_value)
+{
+    esp_err_t err;
+
+    if (setting_nvs_type(desc->type) == NVS_TYPE_U16)
+    {
+        uint16_t raw = 0;
+        size_t len = sizeof(raw);
+        err = nvs_load_data(desc->namespace, desc->key, &raw, &len, NVS_TYPE_U16);
+        *out_value = raw;
+    }
+    else
+    {
+        uint8_t raw = 0;
+        size_t len = sizeof(raw);
+        err = nvs_load_data(desc->namespace, desc->key, &raw, &len, NVS_TYPE_U8);
+        *out_value = raw;
+    }
+    return err;
+}
+
+static esp_err_t setting_save_raw(const setting_desc_t *desc, int32_t value)
+{
+    if (setting_nvs_type(desc->type) == NVS_TYPE_U16)
+    {
+        uint16_t raw = value;
+        return nvs_save_data(desc->namespace, desc->key, &raw, sizeof(raw), NVS_TYPE_U16);
+    }
+
+    uint8_t raw = value;
+    return nvs_save_data(desc->namespace, desc->key, &raw, sizeof(raw), NVS_TYPE_U8);
+}
+
+static esp_err_t setting_load_int(const setting_desc_t *desc, int32_t *out_value)
+{
+    int32_t value = 0;
+    esp_err_t err = setting_load_raw(desc, &value);
+    if (err == ESP_OK)
+    {
+        if (!setting_in_range(desc, value))
+        {
+            ESP_LOGW(TAG, "Stored %s/%s=%ld is out of range", desc->namespace, desc->key, value);
+            return ESP_ERR_INVALID_STATE;
+        }
+        *out_value = value;
+        return ESP_OK;
+    }
+    if (err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        return err;
+    }
+
+    // Прежние версии хранили все настройки строками: разбор один раз, дальше - число
+    char text[12] = {0};
+    size_t len = sizeof(text);
+    if (nvs_load_data(desc->namespace, desc->key, text, &len, NVS_TYPE_STR) != ESP_OK)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    if (setting_parse_text(desc, text, &value) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Legacy %s/%s='%s' is invalid, dropped", desc->namespace, desc->key, text);
+        nvs_delete_data(desc->namespace, desc->key);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    err = setting_save_raw(desc, value);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to migrate %s/%s: %s", desc->namespace, desc->key, esp_err_to_name(err));
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Migrated %s/%s from string to %ld", desc->namespace, desc->key, value);
+    }
+
+    *out_value = value;
+    return ESP_OK;
+}
+
+esp_err_t settings_get_int(setting_id_t id, int32_t *out_value)
+{
+    const setting_desc_t *desc = settings_desc(id);
+    if (desc == NULL || desc->type == SETTING_TYPE_STR || out_value == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out_value = desc->def;
+    return setting_load_int(desc, out_value);
+}
+
+bool settings_get_bool(setting_id_t id)
+{
+    int32_t value = 0;
+    settings_get_int(id, &value);
+    return value != 0;
+}
+
+esp_err_t settings_get_str(setting_id_t id, char *out, size_t out_len)
+{
+    const setting_desc_t *desc = settings_desc(id);
+    if (desc == NULL || desc->type != SETTING_TYPE_STR || out == NULL || out_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    out[0] = '\0';
+    size_t len = out_len;
+    return nvs_load_data(desc->namespace, desc->key, out, &len, NVS_TYPE_STR);
+}
+
+esp_err_t settings_txn_set_text(nvs_txn_t txn, setting_id_t id, const char *text)
+{
+    const setting_desc_t *desc = settings_desc(id);
+    if (desc == NULL || text == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (text[0] == '\0')
+    {
+        return nvs_txn_erase(txn, desc->key);
+    }
+
+    if (desc->type == SETTING_TYPE_STR)
+    {
+        size_t len = strlen(text);
+        if (len < desc->min || len > desc->max)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return nvs_txn_set_str(txn, desc->key, text);
+    }
+
+    int32_t value = 0;
+    esp_err_t err = setting_parse_text(desc, text, &value);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (setting_nvs_type(desc->type) == NVS_TYPE_U16)
+    {
+        uint16_t raw = value;
+        return nvs_txn_set_data(txn, desc->key, &raw, sizeof(raw), NVS_TYPE_U16);
+    }
+    return nvs_txn_set_u8(txn, desc->key, value);
+}
+
+esp_err_t settings_get_text(setting_id_t id, char *out, size_t out_len)
+{
+    const setting_desc_t *desc = settings_desc(id);
+    if (desc == NULL || out == NULL || out_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (desc->type == SETTING_TYPE_STR)
+    {
+        return settings_get_str(id, out, out_len);
+    }
+
+    int32_t value = desc->def;
+    esp_err_t err = setting_load_int(desc, &value);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (desc->type == SETTING_TYPE_BOOL)
+    {
+        snprintf(out, out_len, "%s", value ? "true" : "false");
+    }
+    else
+    {
+        snprintf(out, out_len, "%ld", value);
+    }
+    return ESP_OK;
+}
+
+esp_err_t settings_check_value(const char *namespace, const char *key, nvs_type_t type, const void *data, size_t length)
+{
+    const setting_desc_t *desc = NULL;
+    for (int id = 0; id < SETTING_COUNT; id++)
+    {
+        if (strcmp(settings_table[id].namespace, namespace) == 0 && strcmp(settings_table[id].key, key) == 0)
+        {
+            desc = &settings_table[id];
+            break;
+        }
+    }
+
+    if (desc == NULL)
+    {
+        return ESP_OK;
+    }
+
+    if (type == NVS_TYPE_STR)
+    {
+        const char *text = data;
+        if (length == 0 || text[length - 1] != '\0')
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (desc->type == SETTING_TYPE_STR)
+        {
+            return (length - 1 >= desc->min && length - 1 <= desc->max) ? ESP_OK : ESP_ERR_INVALID_ARG;
+        }
+
+        int32_t value;
+        return setting_parse_text(desc, text, &value);
+    }
+
+    // Значение может лежать в буфере без выравнивания
+    int32_t value;
+    if (type == NVS_TYPE_U16 && setting_nvs_type(desc->type) == NVS_TYPE_U16 && length == sizeof(uint16_t))
+    {
+        uint16_t raw;
+        memcpy(&raw, data, sizeof(raw));
+        value = raw;
+    }
+    else if (type == NVS_TYPE_U8 && setting_nvs_type(desc->type) == NVS_TYPE_U8 && length == sizeof(uint8_t))
+    {
+        value = *(const uint8_t *)data;
+    }
+    else
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return setting_in_range(desc, value) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void settings_error_text(setting_id_t id, char *out, size_t out_len)
+{
+    const setting_desc_t *desc = settings_desc(id);
+    if (desc == NULL)
+    {
+        snprintf(out, out_len, "invalid value provided");
+        return;
+    }
+
+    switch (desc->type)
+    {
+    case SETTING_TYPE_STR:
+        snprintf(out, out_len, "%s too long (max %ld characters)", desc->key, desc->max);
+        break;
+    case SETTING_TYPE_U16:
+        snprintf(out, out_len, "invalid %s provided (must be %ld-%ld)", desc->key, desc->min, desc->max);
+        break;
+    default:
+        snprintf(out, out_len, "invalid %s provided", desc->key);
+        break;
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "esp_err.h"
+#include "nvs_settings.h"
+#include "settings_schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Тип значения настройки
+ */
+typedef enum
+{
+    SETTING_TYPE_STR,
+    SETTING_TYPE_BOOL,
+    SETTING_TYPE_U16,
+    SETTING_TYPE_GPIO, // Номер вывода, пригодного для выхода
+} setting_type_t;
+
+/**
+ * @brief Идентификаторы настроек: SETTING_<id> из SETTINGS_SCHEMA
+ */
+typedef enum
+{
+#define SETTING_ENUM(id, ns, key, type, min, max, def) SETTING_##id,
+    SETTINGS_SCHEMA(SETTING_ENUM)
+#undef SETTING_ENUM
+    SETTING_COUNT
+} setting_id_t;
+
+/**
+ * @brief Описание настройки из схемы
+ */
+typedef struct
+{
+    const char *namespace;
+    const char *key; // Ключ NVS и поле JSON
+    setting_type_t type;
+    int32_t min;
+    int32_t max;
+    int32_t def;
+} setting_desc_t;
+
+/**
+ * @brief Описание настройки
+ *
+ * @param id Идентификатор настройки
+ * @return const setting_desc_t* Описание или NULL для неизвестного id
+ */
+const setting_desc_t *settings_desc(setting_id_t id);
+
+/**
+ * @brief Значение числовой или логической настройки
+ *
+ * Значения, сохраненные прежними версиями строкой, один раз переводятся в числовой вид.
+ *
+ * @param id Идентификатор настройки
+ * @param out_value Указатель для значения; при отсутствии или ошибке - значение по умолчанию
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND если значение не сохранено, иначе код ошибки
+ */
+esp_err_t settings_get_int(setting_id_t id, int32_t *out_value);
+
+/**
+ * @brief Значение логической настройки, false если не сохранено
+ *
+ * @param id Идентификатор настройки
+ * @return bool Значение настройки
+ */
+bool settings_get_bool(setting_id_t id);
+
+/**
+ * @brief Значение строковой настройки
+ *
+ * @param id Идентификатор настройки
+ * @param out Буфер для строки
+ * @param out_len Размер буфера
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND если значение не сохранено, иначе код ошибки
+ */
+esp_err_t settings_get_str(setting_id_t id, char *out, size_t out_len);
+
+/**
+ * @brief Проверка текстового значения (из JSON) и добавление его в транзакцию
+ *
+ * Пустая строка удаляет значение.
+ *
+ * @param txn Транзакция пространства имен настройки
+ * @param id Идентификатор настройки
+ * @param text Значение в текстовом виде
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG если значение не проходит проверку схемы, иначе код ошибки
+ */
+esp_err_t settings_txn_set_text(nvs_txn_t txn, setting_id_t id, const char *text);
+
+/**
+ * @brief Значение настройки в текстовом виде (для JSON)
+ *
+ * @param id Идентификатор настройки
+ * @param out Буфер для строки
+ * @param out_len Размер буфера
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND если значение не сохранено, иначе код ошибки
+ */
+esp_err_t settings_get_text(setting_id_t id, char *out, size_t out_len);
+
+/**
+ * @brief Проверка значения NVS по схеме перед записью в обход settings_txn_set_text()
+ *
+ * Ключи, которых нет в схеме, не проверяются. Строка для числовой настройки
+ * допускается, если это корректное значение в прежнем строковом виде.
+ *
+ * @param namespace Пространство имен
+ * @param key Ключ
+ * @param type Тип значения NVS
+ * @param data Значение
+ * @param length Размер значения в байтах (для строк - с терминатором)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG если значение не проходит проверку схемы
+ */
+esp_err_t settings_check_value(const char *namespace, const char *key, nvs_type_t type, const void *data, size_t length);
+
+/**
+ * @brief Текст ошибки проверки для ответа портала
+ *
+ * @param id Идентификатор настройки
+ * @param out Буфер для строки
+ * @param out_len Размер буфера
+ */
+void settings_error_text(setting_id_t id, char *out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETTINGS_H */
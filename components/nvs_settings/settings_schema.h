@@ -0,0 +1,26 @@
+#ifndef SETTINGS_SCHEMA_H
+#define SETTINGS_SCHEMA_H
+
+/**
+ * @brief Описание всех настроек устройства
+ *
+ * X(id, namespace, key, type, min, max, default)
+ *
+ * key - одновременно ключ NVS и поле JSON портала.
+ * Для строк min/max - допустимая длина без терминатора, default не используется.
+ * Для BOOL, U16 и GPIO значение хранится в NVS числом (u8/u16/u8).
+ */
+#define SETTINGS_SCHEMA(X)                                                  \
+    X(DEVICE_HOSTNAME, "device", "hostname", SETTING_TYPE_STR, 0, 63, 0)    \
+    X(LEDSTRIP_LEDNUM, "ledstrip", "lednum", SETTING_TYPE_U16, 1, 512, 60)  \
+    X(LEDSTRIP_LEDPIN, "ledstrip", "ledpin", SETTING_TYPE_GPIO, 0, 48, 0)   \
+    X(LEDSTRIP_HOSTNAME, "ledstrip", "hostname", SETTING_TYPE_STR, 0, 63, 0) \
+    X(MQTT_ENABLE, "mqtt", "enable", SETTING_TYPE_BOOL, 0, 1, 0)            \
+    X(MQTT_SERVER, "mqtt", "server", SETTING_TYPE_STR, 0, 31, 0)            \
+    X(MQTT_PORT, "mqtt", "port", SETTING_TYPE_U16, 1, 65535, 1883)          \
+    X(MQTT_USER, "mqtt", "user", SETTING_TYPE_STR, 0, 31, 0)                \
+    X(MQTT_PASSWORD, "mqtt", "password", SETTING_TYPE_STR, 0, 31, 0)        \
+    X(MQTT_JSON, "mqtt", "json", SETTING_TYPE_BOOL, 0, 1, 0)                \
+    X(WIFI_STANDALONE, "wifi", "standalone", SETTING_TYPE_BOOL, 0, 1, 0)
+
+#endif /* SETTINGS_SCHEMA_H */
@@ -0,0 +1,390 @@
+#include "settings_snapshot.h"
+#include "settings.h"
+#include "nvs_settings.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_wifi_types.h"
+#include <string.h>
+
+static const char *TAG = "Snapshot";
+
+typedef struct
+{
+    const char *namespace;
+    const char *skip_key; // Данные конкретного устройства, в снимок не входят
+    bool uncached;        // Пишется в обход nvs_settings, кэш после импорта сбрасывается
+} snapshot_namespace_t;
+
+// DWNVS_STA и DWNVS_AP - конфигурации Wi-Fi из wifi_driver (dwnvs.c)
+static const snapshot_namespace_t snapshot_namespaces[] = {
+    {"device", NULL, false},
+    {"ledstrip", NULL, false},
+    {"mqtt", NULL, false},
+    {"wifi", NULL, false},
+    {"network", NULL, true}, // ip_info пишет dwnvs_save_ipinfo()
+    {"apoint", NULL, false},
+    {"DWNVS_STA", "fast_connect", true}, // BSSID и аренда DHCP
+    {"DWNVS_AP", NULL, true},
+};
+
+#define SNAPSHOT_NAMESPACES (sizeof(snapshot_namespaces) / sizeof(snapshot_namespaces[0]))
+
+// Структуры IDF сохраняются как есть, их раскладка зависит от версии IDF:
+// снимок другой сборки с иной длиной не применяется
+typedef struct
+{
+    const char *namespace;
+    const char *key;
+    size_t length;
+} snapshot_blob_t;
+
+static const snapshot_blob_t snapshot_blobs[] = {
+    {"DWNVS_STA", "sta_config", sizeof(wifi_sta_config_t)},
+    {"DWNVS_AP", "ap_config", sizeof(wifi_ap_config_t)},
+};
+
+#define SNAPSHOT_BLOBS (sizeof(snapshot_blobs) / sizeof(snapshot_blobs[0]))
+
+// Запись снимка, разобранная из блока
+typedef struct
+{
+    char namespace[NVS_NS_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    const uint8_t *data; // Без выравнивания
+    size_t length;
+} snapshot_record_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t size;
+    size_t used;
+    uint16_t count;
+    const snapshot_namespace_t *ns;
+} snapshot_writer_t;
+
+static const snapshot_namespace_t *snapshot_find_namespace(const char *namespace)
+{
+    for (size_t i = 0; i < SNAPSHOT_NAMESPACES; i++)
+    {
+        if (strcmp(snapshot_namespaces[i].namespace, namespace) == 0)
+        {
+            return &snapshot_namespaces[i];
+        }
+    }
+    return NULL;
+}
+
+static bool snapshot_skipped(const snapshot_namespace_t *ns, const char *key)
+{
+    return ns->skip_key != NULL && strcmp(ns->skip_key, key) == 0;
+}
+
+static uint32_t snapshot_crc(const settings_snapshot_header_t *header, const uint8_t *records)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(settings_snapshot_header_t, crc));
+    return esp_rom_crc32_le(crc, records, header->length);
+}
+
+static esp_err_t snapshot_put(snapshot_writer_t *writer, const void *data, size_t length)
+{
+    if (writer->size - writer->used < length)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(writer->buf + writer->used, data, length);
+    writer->used += length;
+    return ESP_OK;
+}
+
+static esp_err_t snapshot_put_name(snapshot_writer_t *writer, const char *name)
+{
+    uint8_t length = strlen(name);
+    esp_err_t err = snapshot_put(writer, &length, sizeof(length));
+    return (err == ESP_OK) ? snapshot_put(writer, name, length) : err;
+}
+
+static esp_err_t snapshot_export_value(const char *key, nvs_type_t type, const void *data, size_t length, void *ctx)
+{
+    snapshot_writer_t *writer = ctx;
+
+    if (snapshot_skipped(writer->ns, key))
+    {
+        return ESP_OK;
+    }
+    if (length > UINT16_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t raw_type = type;
+    uint8_t raw_length[2] = {length & 0xFF, length >> 8};
+
+    esp_err_t err = snapshot_put_name(writer, writer->ns->namespace);
+    if (err == ESP_OK)
+        err = snapshot_put_name(writer, key);
+    if (err == ESP_OK)
+        err = snapshot_put(writer, &raw_type, sizeof(raw_type));
+    if (err == ESP_OK)
+        err = snapshot_put(writer, raw_length, sizeof(raw_length));
+    if (err == ESP_OK)
+        err = snapshot_put(writer, data, length);
+
+    if (err == ESP_OK)
+    {
+        writer->count++;
+    }
+    return err;
+}
+
+esp_err_t settings_snapshot_export(void *out, size_t out_size, size_t *out_length)
+{
+    if (out == NULL || out_length == NULL || out_size < sizeof(settings_snapshot_header_t))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    snapshot_writer_t writer = {
+        .buf = out,
+        .size = out_size,
+        .used = sizeof(settings_snapshot_header_t),
+    };
+
+    for (size_t i = 0; i < SNAPSHOT_NAMESPACES; i++)
+    {
+        writer.ns = &snapshot_namespaces[i];
+        esp_err_t err = nvs_foreach_data(writer.ns->namespace, snapshot_export_value, &writer);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to export %s: %s", writer.ns->namespace, esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    settings_snapshot_header_t header = {
+        .magic = SETTINGS_SNAPSHOT_MAGIC,
+        .version = SETTINGS_SNAPSHOT_VERSION,
+        .count = writer.count,
+        .length = writer.used - sizeof(header),
+    };
+    header.crc = snapshot_crc(&header, writer.buf + sizeof(header));
+    memcpy(out, &header, sizeof(header));
+
+    *out_length = writer.used;
+    ESP_LOGI(TAG, "Exported %u values, %u bytes", writer.count, (unsigned)writer.used);
+    return ESP_OK;
+}
+
+static esp_err_t snapshot_read_name(const uint8_t **pos, const uint8_t *end, char *out, size_t out_size)
+{
+    if (*pos >= end)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t length = **pos;
+    (*pos)++;
+    if (length == 0 || length >= out_size || (size_t)(end - *pos) < length)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(out, *pos, length);
+    out[length] = '\0';
+    *pos += length;
+    return ESP_OK;
+}
+
+static esp_err_t snapshot_read_record(const uint8_t **pos, const uint8_t *end, snapshot_record_t *record)
+{
+    esp_err_t err = snapshot_read_name(pos, end, record->namespace, sizeof(record->namespace));
+    if (err == ESP_OK)
+    {
+        err = snapshot_read_name(pos, end, record->key, sizeof(record->key));
+    }
+    if (err != ESP_OK || end - *pos < 3)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    record->type = (*pos)[0];
+    record->length = (*pos)[1] | ((*pos)[2] << 8);
+    *pos += 3;
+
+    if ((size_t)(end - *pos) < record->length)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    record->data = *pos;
+    *pos += record->length;
+    return ESP_OK;
+}
+
+// Проверка записи до начала транзакции: в снимке может быть только то, что экспорт мог туда положить
+static esp_err_t snapshot_check_record(const snapshot_record_t *record)
+{
+    const snapshot_namespace_t *ns = snapshot_find_namespace(record->namespace);
+    if (ns == NULL || snapshot_skipped(ns, record->key))
+    {
+        ESP_LOGE(TAG, "%s/%s is not part of a snapshot", record->namespace, record->key);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (record->type)
+    {
+    case NVS_TYPE_U8:
+    case NVS_TYPE_I8:
+        return (record->length == sizeof(uint8_t)) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    case NVS_TYPE_U16:
+    case NVS_TYPE_I16:
+        return (record->length == sizeof(uint16_t)) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    case NVS_TYPE_U32:
+    case NVS_TYPE_I32:
+        return (record->length == sizeof(uint32_t)) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    case NVS_TYPE_U64:
+    case NVS_TYPE_I64:
+        return (record->length == sizeof(uint64_t)) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    case NVS_TYPE_STR:
+        // Ровно один терминатор в конце, иначе длина в NVS разойдется с длиной в снимке
+        if (record->length == 0 || memchr(record->data, '\0', record->length) != record->data + record->length - 1)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    case NVS_TYPE_BLOB:
+        for (size_t i = 0; i < SNAPSHOT_BLOBS; i++)
+        {
+            if (strcmp(snapshot_blobs[i].namespace, record->namespace) == 0 && strcmp(snapshot_blobs[i].key, record->key) == 0)
+            {
+                return (record->length == snapshot_blobs[i].length) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+            }
+        }
+        return (record->length > 0) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static esp_err_t snapshot_erase_value(const char *key, nvs_type_t type, const void *data, size_t length, void *ctx)
+{
+    return nvs_txn_erase((nvs_txn_t)ctx, key);
+}
+
+esp_err_t settings_snapshot_import(const void *data, size_t length)
+{
+    if (data == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    settings_snapshot_header_t header;
+    if (length < sizeof(header))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != SETTINGS_SNAPSHOT_MAGIC)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (header.version != SETTINGS_SNAPSHOT_VERSION)
+    {
+        ESP_LOGE(TAG, "Unsupported snapshot version %u", header.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.length != length - sizeof(header))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *records = (const uint8_t *)data + sizeof(header);
+    const uint8_t *end = records + header.length;
+    if (snapshot_crc(&header, records) != header.crc)
+    {
+        ESP_LOGE(TAG, "Snapshot CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    snapshot_record_t record = {0};
+    uint16_t count = 0;
+    for (const uint8_t *pos = records; pos < end; count++)
+    {
+        esp_err_t err = snapshot_read_record(&pos, end, &record);
+        if (err == ESP_OK)
+        {
+            err = snapshot_check_record(&record);
+        }
+        if (err == ESP_OK)
+        {
+            err = settings_check_value(record.namespace, record.key, record.type, record.data, record.length);
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Invalid record %u (%s/%s): %s", count, record.namespace, record.key, esp_err_to_name(err));
+            return err;
+        }
+    }
+    if (count != header.count)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Полная замена: сначала удаление всех ключей, затем значения снимка поверх
+    nvs_txn_t txn;
+    esp_err_t err = nvs_txn_begin(snapshot_namespaces[0].namespace, &txn);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    for (size_t i = 0; i < SNAPSHOT_NAMESPACES && err == ESP_OK; i++)
+    {
+        err = nvs_txn_use_namespace(txn, snapshot_namespaces[i].namespace);
+        if (err == ESP_OK)
+        {
+            err = nvs_foreach_data(snapshot_namespaces[i].namespace, snapshot_erase_value, txn);
+        }
+    }
+
+    for (const uint8_t *pos = records; pos < end && err == ESP_OK;)
+    {
+        snapshot_read_record(&pos, end, &record);
+        err = nvs_txn_use_namespace(txn, record.namespace);
+        if (err == ESP_OK)
+        {
+            err = nvs_txn_set_data(txn, record.key, record.data, record.length, record.type);
+        }
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to prepare snapshot: %s", esp_err_to_name(err));
+        nvs_txn_rollback(txn);
+        return err;
+    }
+
+    err = nvs_txn_commit(txn);
+
+    // Транзакция загрузила в кэш и пространства имен, которые dwnvs.c пишет через nvs_set_blob()
+    for (size_t i = 0; i < SNAPSHOT_NAMESPACES; i++)
+    {
+        if (snapshot_namespaces[i].uncached)
+        {
+            nvs_cache_invalidate(snapshot_namespaces[i].namespace);
+        }
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to apply snapshot: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Snapshot applied: %u values in %lld ms", count, (esp_timer_get_time() - start) / 1000);
+    return ESP_OK;
+}
@@ -0,0 +1,67 @@
+#ifndef SETTINGS_SNAPSHOT_H
+#define SETTINGS_SNAPSHOT_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SETTINGS_SNAPSHOT_MAGIC 0x50414E53 // "SNAP"
+#define SETTINGS_SNAPSHOT_VERSION 1
+
+// Снимок должен помещаться в один входящий кадр WebSocket портала
+#ifndef SETTINGS_SNAPSHOT_MAX_SIZE
+#define SETTINGS_SNAPSHOT_MAX_SIZE 1000
+#endif
+
+/**
+ * @brief Заголовок снимка настроек, little-endian
+ *
+ * За заголовком следуют length байт записей:
+ * u8 длина имени пространства, имя, u8 длина ключа, ключ, u8 nvs_type_t, u16 длина значения, значение.
+ * Строки хранятся с терминатором. crc - CRC-32 (как zlib.crc32) первых 12 байт заголовка и записей.
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;  // Число записей
+    uint32_t length; // Размер записей в байтах
+    uint32_t crc;
+} settings_snapshot_header_t;
+
+/**
+ * @brief Снимок всех настроек устройства одним блоком
+ *
+ * В снимок входят пространства имен device, ledstrip, mqtt, wifi, network, apoint
+ * и конфигурации Wi-Fi из dwnvs; данные, уникальные для устройства, пропускаются.
+ *
+ * @param out Буфер для снимка
+ * @param out_size Размер буфера
+ * @param out_length Указатель для размера снимка
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_SIZE если снимок не помещается в буфер, иначе код ошибки
+ */
+esp_err_t settings_snapshot_export(void *out, size_t out_size, size_t *out_length);
+
+/**
+ * @brief Применение снимка настроек одной транзакцией
+ *
+ * Снимок проверяется целиком (версия, CRC, схема настроек) до записи во flash.
+ * Пространства имен снимка заменяются полностью: ключи, которых нет в снимке, удаляются.
+ * Новые настройки действуют после перезагрузки.
+ *
+ * @param data Снимок
+ * @param length Размер снимка
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_VERSION, ESP_ERR_INVALID_CRC,
+ *         ESP_ERR_INVALID_SIZE или ESP_ERR_INVALID_ARG для некорректного снимка, иначе код ошибки записи
+ */
+esp_err_t settings_snapshot_import(const void *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETTINGS_SNAPSHOT_H */
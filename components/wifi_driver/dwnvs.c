@@ -5,6 +5,7 @@
 #include "esp_log.h"
 #include <string.h>
 #include "freertos/semphr.h"
+#include "dwnvs.h"
 
 #define WIFISTA_NAMESPACE "DWNVS_STA"
 #define WIFIAP_NAMESPACE "DWNVS_AP"
@@ -186,6 +187,13 @@ esp_err_t dwnvs_delete_sta_config(void)
         return err;
     }
 
+    // Данные быстрого подключения без конфигурации не нужны
+    err = nvs_erase_key(nvs_handle, "fast_connect");
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGW(TAG, "Failed to erase fast connect data: %s", esp_err_to_name(err));
+    }
+
     ESP_LOGI(TAG, "STA config deleted");
 
     err = nvs_commit(nvs_handle);
@@ -199,6 +207,102 @@ esp_err_t dwnvs_delete_sta_config(void)
     return err;
 }
 //=================================================================
+esp_err_t dwnvs_save_fast_connect(const dwnvs_fast_connect_t *fast)
+{
+    if (fast == NULL)
+    {
+        ESP_LOGE(TAG, "Fast connect data is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!dwnvs_mutex_lock(portMAX_DELAY))
+    {
+        ESP_LOGE(TAG, "Failed to acquire NVS mutex");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+
+    err = nvs_open(WIFISTA_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open NVS handle: %s", esp_err_to_name(err));
+        dwnvs_mutex_unlock();
+        return err;
+    }
+
+    err = nvs_set_blob(nvs_handle, "fast_connect", fast, sizeof(dwnvs_fast_connect_t));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to save fast connect blob: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        dwnvs_mutex_unlock();
+        return err;
+    }
+
+    err = nvs_commit(nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to commit NVS: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+    dwnvs_mutex_unlock();
+    return err;
+}
+
+esp_err_t dwnvs_load_fast_connect(dwnvs_fast_connect_t *fast)
+{
+    if (fast == NULL)
+    {
+        ESP_LOGE(TAG, "Fast connect pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!dwnvs_mutex_lock(portMAX_DELAY))
+    {
+        ESP_LOGE(TAG, "Failed to acquire NVS mutex");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+    size_t required_size = sizeof(dwnvs_fast_connect_t);
+
+    err = nvs_open(WIFISTA_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open NVS handle: %s", esp_err_to_name(err));
+        dwnvs_mutex_unlock();
+        return err;
+    }
+
+    memset(fast, 0, sizeof(dwnvs_fast_connect_t));
+
+    err = nvs_get_blob(nvs_handle, "fast_connect", fast, &required_size);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to read fast connect blob: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        dwnvs_mutex_unlock();
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_ERR_NVS_NOT_FOUND : err;
+    }
+
+    if (required_size != sizeof(dwnvs_fast_connect_t))
+    {
+        ESP_LOGE(TAG, "Fast connect size mismatch: expected %d, got %d",
+                 sizeof(dwnvs_fast_connect_t), required_size);
+        nvs_close(nvs_handle);
+        dwnvs_mutex_unlock();
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    nvs_close(nvs_handle);
+    dwnvs_mutex_unlock();
+    return ESP_OK;
+}
+//=================================================================
 esp_err_t dwnvs_save_ap_config(const wifi_ap_config_t *ap_config)
 {
     if (ap_config == NULL)
@@ -35,10 +35,41 @@ extern "C"
     /**
      * @brief Удаление конфигурации STA из NVS
      *
+     * Вместе с конфигурацией удаляются и данные быстрого подключения.
+     *
      * @return esp_err_t ESP_OK при успешном удалении, иначе код ошибки
      */
     esp_err_t dwnvs_delete_sta_config(void);
 
+    /**
+     * @brief Данные последнего успешного подключения STA
+     *
+     * Позволяют подключиться к той же точке доступа без сканирования всех каналов.
+     */
+    typedef struct
+    {
+        uint8_t ssid[32];            // Сеть, к которой относится запись
+        uint8_t bssid[6];            // MAC точки доступа
+        uint8_t channel;             // Основной канал точки доступа
+        esp_netif_ip_info_t ip_info; // Полученная по DHCP аренда
+    } dwnvs_fast_connect_t;
+
+    /**
+     * @brief Сохранение данных быстрого подключения в NVS
+     *
+     * @param fast Указатель на данные последнего успешного подключения
+     * @return esp_err_t ESP_OK при успешном сохранении, иначе код ошибки
+     */
+    esp_err_t dwnvs_save_fast_connect(const dwnvs_fast_connect_t *fast);
+
+    /**
+     * @brief Загрузка данных быстрого подключения из NVS
+     *
+     * @param fast Указатель на структуру для загрузки данных
+     * @return esp_err_t ESP_OK при успешной загрузке, ESP_ERR_NVS_NOT_FOUND если данные отсутствуют, иначе код ошибки
+     */
+    esp_err_t dwnvs_load_fast_connect(dwnvs_fast_connect_t *fast);
+
     /**
      * @brief Сохранение конфигурации AP в NVS
      *
@@ -3,6 +3,8 @@
 #include "esp_log.h"
 #include "freertos/semphr.h"
 #include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_mac.h"
 #include "dwnvs.h"
 #include "mdns_service.h"
 #include "esp_http_client.h"
@@ -10,9 +12,16 @@
 #define DISCONNECT_BY_USER (BIT1)
 #define SCAN_IN_PROGRESS_BIT (BIT2)
 #define INTERNET_CHECK_TIMEOUT_MS 3000
+#ifndef INTERNET_CHECK_URL
 #define INTERNET_CHECK_URL "http://connectivitycheck.gstatic.com/generate_204"
-static uint16_t ap_count = 0;
-static wifi_ap_record_t *ap_list = NULL;
+#endif
+#define INTERNET_CHECK_PERIOD_MS 60000 // Период проверки, пока интернет доступен
+#define INTERNET_RETRY_PERIOD_MS 10000 // Период проверки после неудачи
+#define INTERNET_TASK_STACK 4096
+#define RECONNECT_JITTER_PERCENT 25 // Разброс задержки переподключения, ±%
+#define RECONNECT_BUSY_RETRY_MS 100 // Повтор, если мьютекс Wi-Fi занят
+static dw_scan_entry_t scan_list[DW_SCAN_MAX_RESULTS]; // Уникальные сети по убыванию RSSI
+static uint16_t scan_count = 0;
 static wifi_mode_t wifi_current_mode = WIFI_MODE_NULL;
 static esp_event_handler_instance_t sta_wifi_event = NULL;
 static esp_event_handler_instance_t sta_ip_event = NULL;
@@ -26,6 +35,42 @@ static SemaphoreHandle_t wifi_mutex = NULL;
 static EventGroupHandle_t wifi_group = NULL;
 static const char *TAG = "DWIFI";
 static const char *TAGM = "DWIFI_M";
+typedef struct
+{
+    uint16_t first_ms; // Задержка первой попытки
+    uint16_t step_ms;  // Задержка второй попытки, далее удваивается
+    uint16_t max_ms;   // Потолок задержки
+} reconnect_policy_t;
+typedef struct
+{
+    uint32_t scheduled;
+    uint32_t probes;
+    uint32_t probes_dropped;
+    int64_t latency_total_us;
+    int64_t latency_max_us;
+    int64_t handler_max_us;
+} reconnect_stats_t;
+ESP_EVENT_DEFINE_BASE(DW_LOOP_PROBE_EVENT);
+static esp_timer_handle_t reconnect_timer = NULL;
+static esp_event_handler_instance_t loop_probe_event = NULL;
+static const reconnect_policy_t *reconnect_current_policy = NULL;
+static uint32_t reconnect_attempts = 0;
+static reconnect_stats_t reconnect_stats = {0};
+static portMUX_TYPE reconnect_lock = portMUX_INITIALIZER_UNLOCKED;
+#ifdef DWNVS_STORAGE_H
+static dwnvs_fast_connect_t fast_record = {0}; // Последнее успешное подключение
+#endif
+static bool fast_connect_pinned = false;  // В конфигурации драйвера закреплены BSSID и канал
+static bool fast_connect_pending = false; // Первое подключение после закрепления ещё не завершено
+static bool sta_has_ip = false;
+static int64_t connect_started_us = 0; // Начало подключения для замера времени до IP
+static TaskHandle_t internet_task = NULL;
+static char internet_check_url[128] = INTERNET_CHECK_URL;
+static esp_err_t internet_result = ESP_ERR_INVALID_STATE; // Результат последней проверки
+static int64_t internet_checked_us = 0;                   // Время последней проверки, 0 - не было
+static portMUX_TYPE internet_lock = portMUX_INITIALIZER_UNLOCKED;
+static dw_internet_cb_t internet_cb = NULL; // Вызывается задачей проверки при смене результата
+static volatile bool internet_cb_running = false; // internet_cb выполняется, под internet_lock
 //=================================================================
 static wifi_mode_t change_wifi_mode(wifi_mode_t mode, bool state)
 {
@@ -280,6 +325,327 @@ static void wifi_mutex_unlock(void)
     }
 }
 //=================================================================
+// Политика переподключения по причине отключения, NULL - не переподключаться
+static const reconnect_policy_t *reconnect_policy(wifi_err_reason_t reason)
+{
+    // Задержка первой попытки, шаг удвоения и потолок задержки, мс
+    static const reconnect_policy_t ap_not_found = {2000, 2000, 60000};
+    static const reconnect_policy_t handshake = {0, 500, 8000};
+    static const reconnect_policy_t signal_lost = {1000, 1000, 30000};
+    static const reconnect_policy_t temporary = {1000, 1000, 15000};
+    static const reconnect_policy_t overloaded = {2000, 4000, 60000};
+    static const reconnect_policy_t unexpected = {2000, 2000, 30000};
+
+    switch (reason)
+    {
+        // Ошибки аутентификации - не переподключаемся автоматически
+    case WIFI_REASON_AUTH_EXPIRE:             // 2
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:  // 15
+    case WIFI_REASON_AUTH_FAIL:               // 202
+    case WIFI_REASON_802_1X_AUTH_FAILED:      // 23
+    case WIFI_REASON_AKMP_INVALID:            // 20
+    case WIFI_REASON_PAIRWISE_CIPHER_INVALID: // 19
+    case WIFI_REASON_GROUP_CIPHER_INVALID:    // 18
+    case WIFI_REASON_BAD_CIPHER_OR_AKM:       // 29
+    case WIFI_REASON_INVALID_PMKID:           // 49
+    case WIFI_REASON_IE_IN_4WAY_DIFFERS:      // 17
+        return NULL;
+    // Точка не найдена - редкие попытки, пока AP не появится
+    case WIFI_REASON_NO_AP_FOUND:                       // 201
+    case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY: // 210
+    case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD: // 211
+    case WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:     // 212
+        ESP_LOGW(TAG, "AP not found - will retry when AP becomes available");
+        return &ap_not_found;
+    // Таймауты - первая попытка немедленно
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:        // 204
+    case WIFI_REASON_GROUP_KEY_UPDATE_TIMEOUT: // 16
+    case WIFI_REASON_SA_QUERY_TIMEOUT:         // 209
+        ESP_LOGI(TAG, "Handshake timeout - immediate reconnect");
+        return &handshake;
+    // Потеря сигнала
+    case WIFI_REASON_BEACON_TIMEOUT: // 200
+    case WIFI_REASON_TIMEOUT:        // 39
+        ESP_LOGI(TAG, "Signal lost - reconnect with delay");
+        return &signal_lost;
+    // Роуминг и временные проблемы
+    case WIFI_REASON_ROAMING:                 // 207
+    case WIFI_REASON_BSS_TRANSITION_DISASSOC: // 12
+    case WIFI_REASON_PEER_INITIATED:          // 46
+    case WIFI_REASON_AP_INITIATED:            // 47
+    case WIFI_REASON_AP_TSF_RESET:            // 206
+        ESP_LOGI(TAG, "Temporary disconnection - reconnect with delay");
+        return &temporary;
+    // Перегрузка AP
+    case WIFI_REASON_ASSOC_TOOMANY:        // 5
+    case WIFI_REASON_NOT_ENOUGH_BANDWIDTH: // 33
+        ESP_LOGI(TAG, "AP overloaded - reconnect with exponential delay");
+        return &overloaded;
+    // Неопределенные причины
+    case WIFI_REASON_UNSPECIFIED:                // 1
+    case WIFI_REASON_DISASSOC_DUE_TO_INACTIVITY: // 4
+    case WIFI_REASON_CONNECTION_FAIL:            // 205
+    default:
+        ESP_LOGW(TAG, "Unexpected disconnect reason %d - reconnect with delay", reason);
+        return &unexpected;
+    }
+}
+//=================================================================
+// Экспоненциальная задержка с разбросом, чтобы устройства после сбоя AP не подключались одновременно
+static uint32_t reconnect_next_delay(const reconnect_policy_t *policy, uint32_t attempt)
+{
+    uint32_t delay = policy->first_ms;
+    if (attempt > 0)
+    {
+        uint32_t shift = attempt - 1;
+        if (shift > 16)
+        {
+            shift = 16;
+        }
+        delay = (uint32_t)policy->step_ms << shift;
+        if (delay > policy->max_ms)
+        {
+            delay = policy->max_ms;
+        }
+    }
+    uint32_t spread = delay * RECONNECT_JITTER_PERCENT / 100;
+    if (spread > 0)
+    {
+        delay = delay - spread + esp_random() % (2 * spread + 1);
+    }
+    return delay;
+}
+//=================================================================
+static void reconnect_schedule(const reconnect_policy_t *policy)
+{
+    if (reconnect_timer == NULL)
+    {
+        ESP_LOGE(TAG, "Reconnect timer is not created");
+        return;
+    }
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_current_policy = policy;
+    uint32_t attempt = reconnect_attempts++;
+    reconnect_stats.scheduled++;
+    portEXIT_CRITICAL(&reconnect_lock);
+
+    uint32_t delay = reconnect_next_delay(policy, attempt);
+    // Более свежее отключение заменяет уже запланированную попытку
+    esp_timer_stop(reconnect_timer);
+    esp_err_t err = esp_timer_start_once(reconnect_timer, (uint64_t)delay * 1000);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to schedule reconnect: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Reconnect attempt %lu scheduled in %lu ms", attempt + 1, delay);
+}
+//=================================================================
+static void reconnect_cancel(void)
+{
+    if (reconnect_timer != NULL)
+    {
+        esp_timer_stop(reconnect_timer);
+    }
+}
+//=================================================================
+// Подключение восстановлено: сброс счётчика попыток и вывод замеров цикла событий
+static void reconnect_reset(void)
+{
+    reconnect_cancel();
+    portENTER_CRITICAL(&reconnect_lock);
+    uint32_t attempts = reconnect_attempts;
+    reconnect_stats_t stats = reconnect_stats;
+    reconnect_attempts = 0;
+    memset(&reconnect_stats, 0, sizeof(reconnect_stats));
+    portEXIT_CRITICAL(&reconnect_lock);
+
+    if (attempts == 0)
+    {
+        return;
+    }
+    ESP_LOGI(TAG, "Reconnected after %lu attempts (%lu scheduled)", attempts, stats.scheduled);
+    ESP_LOGI(TAG, "Event loop latency: avg %lld us, max %lld us over %lu probes (%lu dropped), disconnect handler max %lld us",
+             stats.probes ? stats.latency_total_us / stats.probes : 0, stats.latency_max_us,
+             stats.probes, stats.probes_dropped, stats.handler_max_us);
+}
+//=================================================================
+static void reconnect_stats_handler_time(int64_t elapsed_us)
+{
+    portENTER_CRITICAL(&reconnect_lock);
+    if (elapsed_us > reconnect_stats.handler_max_us)
+    {
+        reconnect_stats.handler_max_us = elapsed_us;
+    }
+    portEXIT_CRITICAL(&reconnect_lock);
+}
+//=================================================================
+// Замер задержки цикла событий: время между публикацией пробы и её обработкой
+static void loop_probe_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    int64_t latency = esp_timer_get_time() - *(int64_t *)event_data;
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_stats.probes++;
+    reconnect_stats.latency_total_us += latency;
+    if (latency > reconnect_stats.latency_max_us)
+    {
+        reconnect_stats.latency_max_us = latency;
+    }
+    portEXIT_CRITICAL(&reconnect_lock);
+}
+//=================================================================
+static void loop_probe_post(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (esp_event_post(DW_LOOP_PROBE_EVENT, 0, &now, sizeof(now), 0) != ESP_OK)
+    {
+        // Очередь цикла событий переполнена - это тоже показатель
+        portENTER_CRITICAL(&reconnect_lock);
+        reconnect_stats.probes_dropped++;
+        portEXIT_CRITICAL(&reconnect_lock);
+    }
+}
+//=================================================================
+// Выполняется в задаче esp_timer, поэтому тоже не ждёт мьютекс
+static void reconnect_timer_cb(void *arg)
+{
+    loop_probe_post();
+    if (!wifi_mutex_lock(0))
+    {
+        // Мьютекс занят сканированием или сменой режима - повторим позже
+        esp_timer_start_once(reconnect_timer, RECONNECT_BUSY_RETRY_MS * 1000);
+        return;
+    }
+    if (!auto_reconnect_enabled || connect_func == NULL)
+    {
+        wifi_mutex_unlock();
+        return;
+    }
+    ESP_LOGI(TAG, "Attempting to reconnect...");
+    esp_err_t err = connect_func();
+    wifi_mutex_unlock();
+    if (err != ESP_OK)
+    {
+        // Событие отключения не придёт, следующую попытку планируем сами
+        ESP_LOGE(TAG, "Reconnect failed: %s", esp_err_to_name(err));
+        reconnect_schedule(reconnect_current_policy);
+    }
+}
+//=================================================================
+static void internet_store(esp_err_t result)
+{
+    portENTER_CRITICAL(&internet_lock);
+    internet_result = result;
+    internet_checked_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&internet_lock);
+}
+//=================================================================
+static esp_err_t internet_probe(void)
+{
+    esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (!sta_netif)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_netif_ip_info_t ip_info;
+    if (esp_netif_get_ip_info(sta_netif, &ip_info) != ESP_OK || ip_info.ip.addr == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    char url[sizeof(internet_check_url)];
+    portENTER_CRITICAL(&internet_lock);
+    memcpy(url, internet_check_url, sizeof(url));
+    portEXIT_CRITICAL(&internet_lock);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = INTERNET_CHECK_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client)
+    {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return ESP_FAIL;
+    }
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = esp_http_client_perform(client);
+    int status_code = esp_http_client_get_status_code(client);
+    esp_http_client_cleanup(client);
+    int64_t elapsed_ms = (esp_timer_get_time() - start) / 1000;
+    if (err == ESP_OK && status_code == 204)
+    {
+        ESP_LOGI(TAG, "✅ Internet connection verified in %lld ms", elapsed_ms);
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "❌ Internet check failed in %lld ms: HTTP %d, err %s", elapsed_ms, status_code, esp_err_to_name(err));
+    return ESP_ERR_INVALID_RESPONSE;
+}
+//=================================================================
+// Фоновая проверка доступности интернета: по расписанию и по событиям сети
+static void internet_monitor_task(void *arg)
+{
+    uint32_t period_ms = INTERNET_RETRY_PERIOD_MS;
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(period_ms));
+        esp_err_t result = internet_probe();
+        esp_err_t previous = dw_internet_status(NULL);
+        internet_store(result);
+
+        if (result != previous)
+        {
+            // Пока флаг поднят, dw_set_internet_callback() ждёт, и получатель не может освободить ресурсы
+            portENTER_CRITICAL(&internet_lock);
+            dw_internet_cb_t cb = internet_cb;
+            internet_cb_running = (cb != NULL);
+            portEXIT_CRITICAL(&internet_lock);
+
+            if (cb != NULL)
+            {
+                cb(result);
+
+                portENTER_CRITICAL(&internet_lock);
+                internet_cb_running = false;
+                portEXIT_CRITICAL(&internet_lock);
+            }
+        }
+        period_ms = (result == ESP_OK) ? INTERNET_CHECK_PERIOD_MS : INTERNET_RETRY_PERIOD_MS;
+    }
+}
+//=================================================================
+void dw_internet_check_request(void)
+{
+    if (internet_task != NULL)
+    {
+        xTaskNotifyGive(internet_task);
+    }
+}
+//=================================================================
+void dw_set_internet_callback(dw_internet_cb_t cb)
+{
+    portENTER_CRITICAL(&internet_lock);
+    internet_cb = cb;
+    portEXIT_CRITICAL(&internet_lock);
+
+    // Прежний колбэк мог быть уже прочитан задачей проверки; из самого колбэка не ждём
+    if (xTaskGetCurrentTaskHandle() == internet_task)
+    {
+        return;
+    }
+    while (internet_cb_running)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+//=================================================================
+void dw_set_internet_check_url(const char *url)
+{
+    portENTER_CRITICAL(&internet_lock);
+    strlcpy(internet_check_url, url ? url : INTERNET_CHECK_URL, sizeof(internet_check_url));
+    portEXIT_CRITICAL(&internet_lock);
+    dw_internet_check_request();
+}
+//=================================================================
 esp_err_t dw_resources_init(void)
 {
     // Инициализация сетевого стека
@@ -329,6 +695,28 @@ esp_err_t dw_resources_init(void)
             return ESP_ERR_NO_MEM;
         }
     }
+    if (reconnect_timer == NULL)
+    {
+        const esp_timer_create_args_t timer_args = {
+            .callback = reconnect_timer_cb,
+            .name = "wifi_reconnect",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &reconnect_timer);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to create reconnect timer: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    if (internet_task == NULL)
+    {
+        if (xTaskCreate(internet_monitor_task, "inet_monitor", INTERNET_TASK_STACK, NULL, tskIDLE_PRIORITY + 1, &internet_task) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create internet monitor task");
+            internet_task = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
     return ESP_OK;
 }
 //=================================================================
@@ -339,12 +727,7 @@ void dw_wifi_cleanup(void)
     {
         ESP_LOGE(TAG, "CRITICAL: Failed to acquire WiFi mutex in cleanup - potential memory leak!");
         // Принудительная очистка без мьютекса (рискованно, но лучше чем ничего)
-        if (ap_list)
-        {
-            free(ap_list);
-            ap_list = NULL;
-        }
-        ap_count = 0;
+        scan_count = 0;
         // Если мьютекс не удалось захватить, но он создан, нужно его удалить
         // ВАЖНО: Это может быть небезопасно, если другой поток всё ещё использует его.
         // Предполагаем, что в момент очистки других активных потоков нет.
@@ -356,13 +739,9 @@ void dw_wifi_cleanup(void)
         return;
     }
 
+    reconnect_cancel();
     // Безопасная очистка с мьютексом
-    if (ap_list)
-    {
-        free(ap_list);
-        ap_list = NULL;
-        ap_count = 0;
-    }
+    scan_count = 0;
     // Удаляем мьютекс только после очистки других ресурсов
     if (wifi_mutex)
     {
@@ -501,11 +880,105 @@ esp_err_t dw_access_point_stop(void)
     return result;
 }
 //=================================================================
+#ifdef DWNVS_STORAGE_H
+// Направленное подключение к последней успешной точке: без сканирования всех каналов
+static void fast_connect_apply(wifi_sta_config_t *sta)
+{
+    fast_connect_pinned = false;
+    fast_connect_pending = false;
+    if (sta->bssid_set)
+    {
+        return; // BSSID задан явно
+    }
+    if (dwnvs_load_fast_connect(&fast_record) != ESP_OK)
+    {
+        memset(&fast_record, 0, sizeof(fast_record));
+        return;
+    }
+    if (fast_record.channel == 0 ||
+        strncmp((const char *)fast_record.ssid, (const char *)sta->ssid, sizeof(sta->ssid)) != 0)
+    {
+        ESP_LOGI(TAG, "No fast connect data for SSID: %.*s", 32, sta->ssid);
+        return;
+    }
+    memcpy(sta->bssid, fast_record.bssid, sizeof(sta->bssid));
+    sta->bssid_set = true;
+    sta->channel = fast_record.channel;
+    fast_connect_pinned = true;
+    fast_connect_pending = true;
+    ESP_LOGI(TAG, "Fast connect to " MACSTR " on channel %u", MAC2STR(fast_record.bssid), fast_record.channel);
+}
+//=================================================================
+// Запоминает точку доступа и аренду, запись во флеш только при изменении
+static void fast_connect_save(const wifi_sta_config_t *sta, const esp_netif_ip_info_t *ip_info)
+{
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK)
+    {
+        return;
+    }
+    dwnvs_fast_connect_t record = {0};
+    memcpy(record.ssid, sta->ssid, sizeof(record.ssid));
+    memcpy(record.bssid, ap_info.bssid, sizeof(record.bssid));
+    record.channel = ap_info.primary;
+    record.ip_info = *ip_info;
+    if (memcmp(&record, &fast_record, sizeof(record)) == 0)
+    {
+        return;
+    }
+    esp_err_t err = dwnvs_save_fast_connect(&record);
+    if (err == ESP_OK)
+    {
+        fast_record = record;
+        ESP_LOGI(TAG, "Fast connect data saved: " MACSTR " channel %u", MAC2STR(record.bssid), record.channel);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to save fast connect data: %s", esp_err_to_name(err));
+    }
+}
+#endif
+//=================================================================
+// Снимает закрепление BSSID и канала: следующая попытка выполнит полное сканирование
+static esp_err_t fast_connect_unpin(void)
+{
+    fast_connect_pinned = false;
+    fast_connect_pending = false;
+    wifi_config_t wifi_config = {0};
+    esp_err_t err = esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    wifi_config.sta.bssid_set = false;
+    memset(wifi_config.sta.bssid, 0, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = 0;
+    return esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+//=================================================================
 static void dw_sta_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
+    int64_t handler_start = esp_timer_get_time();
+    bool should_reconnect = false;
     if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
     {
+        ip_event_got_ip_t *got_ip = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "Got IP");
+        reconnect_reset();
+        if (connect_started_us != 0)
+        {
+#ifdef DWNVS_STORAGE_H
+            bool lease_reused = (fast_record.ip_info.ip.addr != 0 && fast_record.ip_info.ip.addr == got_ip->ip_info.ip.addr);
+#else
+            bool lease_reused = false;
+#endif
+            ESP_LOGI(TAG, "Time to IP: %lld ms (%s connect, %s lease)", (handler_start - connect_started_us) / 1000,
+                     fast_connect_pending ? "fast" : "full", lease_reused ? "reused" : "new");
+            connect_started_us = 0;
+        }
+        fast_connect_pending = false;
+        sta_has_ip = true;
+        dw_internet_check_request();
         // Проверяем, доступен ли мьютекс
         if (wifi_mutex != NULL)
         {
@@ -519,9 +992,17 @@ static void dw_sta_event_handler(void *arg, esp_event_base_t event_base, int32_t
                     ESP_LOGI(TAG, "Wi-Fi config retrieved successfully");
                     if (wifi_config.sta.ssid[0] != '\0')
                     {
+                        fast_connect_save(&wifi_config.sta, &got_ip->ip_info);
                         // Сохраняем только STA-часть
                         wifi_sta_config_t wifi_sta_config = {0};
                         memcpy(&wifi_sta_config, &wifi_config.sta, sizeof(wifi_sta_config));
+                        if (fast_connect_pinned)
+                        {
+                            // Закрепление BSSID - временное, в NVS хранится исходная конфигурация
+                            wifi_sta_config.bssid_set = false;
+                            memset(wifi_sta_config.bssid, 0, sizeof(wifi_sta_config.bssid));
+                            wifi_sta_config.channel = 0;
+                        }
                         err = dwnvs_save_sta_config(&wifi_sta_config);
                         if (err == ESP_OK)
                         {
@@ -563,6 +1044,16 @@ static void dw_sta_event_handler(void *arg, esp_event_base_t event_base, int32_t
     {
         wifi_event_sta_disconnected_t *disconn = (wifi_event_sta_disconnected_t *)event_data;
         ESP_LOGW(TAG, "Disconnected. Reason: %s (code: %d)", wifi_reason_to_string(disconn->reason), disconn->reason);
+        bool had_ip = sta_has_ip;
+        sta_has_ip = false;
+        if (had_ip)
+        {
+            internet_store(ESP_ERR_INVALID_STATE);
+        }
+        if (had_ip && connect_started_us == 0)
+        {
+            connect_started_us = handler_start;
+        }
         if (disconn->reason == WIFI_REASON_ASSOC_LEAVE)
         {
             // Явное отключение пользователем
@@ -599,128 +1090,59 @@ static void dw_sta_event_handler(void *arg, esp_event_base_t event_base, int32_t
                     // Явное отключение отключает авто-переподключение
                     auto_reconnect_enabled = false;
                     connect_func = NULL;
+                    reconnect_cancel();
                 }
                 wifi_mutex_unlock();
             }
         }
         else
         {
-            // Автоматическое отключение - решаем, переподключаться ли
-            if (wifi_mutex != NULL && wifi_mutex_lock(pdMS_TO_TICKS(1000)))
+            // Автоматическое отключение - решаем, переподключаться ли. Без ожидания мьютекса:
+            // обработчик работает в задаче цикла событий и не должен её задерживать
+            const reconnect_policy_t *policy = reconnect_policy(disconn->reason);
+            if (fast_connect_pinned && !had_ip && policy != NULL)
             {
-                bool should_reconnect = false;
-                uint32_t reconnect_delay = 0;
-                // Проверяем, включено ли авто-переподключение
-                if (!auto_reconnect_enabled)
+                // Точка не ответила по закреплённому BSSID - дальше только полное сканирование,
+                // первое подключение повторяем сразу
+                bool first_connect = fast_connect_pending;
+                ESP_LOGW(TAG, "Fast connect failed, falling back to full scan");
+                esp_err_t err = fast_connect_unpin();
+                if (err == ESP_OK && first_connect)
                 {
-                    ESP_LOGI(TAG, "Auto-reconnect is disabled, not attempting to reconnect.");
-                    connect_func = NULL; // Убедимся, что переподключение не произойдёт
+                    err = esp_wifi_connect();
+                    should_reconnect = (err == ESP_OK);
                 }
-                else
+                if (err != ESP_OK)
                 {
-                    switch (disconn->reason)
-                    {
-                        // Ошибки аутентификации - не переподключаемся автоматически
-                    case WIFI_REASON_AUTH_EXPIRE:             // 2
-                    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:  // 15
-                    case WIFI_REASON_AUTH_FAIL:               // 202
-                    case WIFI_REASON_802_1X_AUTH_FAILED:      // 23
-                    case WIFI_REASON_AKMP_INVALID:            // 20
-                    case WIFI_REASON_PAIRWISE_CIPHER_INVALID: // 19
-                    case WIFI_REASON_GROUP_CIPHER_INVALID:    // 18
-                    case WIFI_REASON_BAD_CIPHER_OR_AKM:       // 29
-                    case WIFI_REASON_INVALID_PMKID:           // 49
-                    case WIFI_REASON_IE_IN_4WAY_DIFFERS:      // 17
-                        ESP_LOGE(TAG, "Authentication failed - manual intervention required");
-                        connect_func = NULL;
-                        auto_reconnect_enabled = false; // Отключаем на всякий случай
-                        break;
-                    // Точка не найдена - не переподключаемся
-                    case WIFI_REASON_NO_AP_FOUND:                       // 201
-                    case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY: // 210
-                    case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD: // 211
-                    case WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:     // 212
-                        ESP_LOGW(TAG, "AP not found - will retry when AP becomes available");
-                        // Все равно пытаемся переподключиться через некоторое время
-                        should_reconnect = true;
-                        reconnect_delay = 2000; // 5 секунд для "AP not found"
-                        break;
-                    // Таймауты - переподключаемся немедленно
-                    case WIFI_REASON_HANDSHAKE_TIMEOUT:        // 204
-                    case WIFI_REASON_GROUP_KEY_UPDATE_TIMEOUT: // 16
-                    case WIFI_REASON_SA_QUERY_TIMEOUT:         // 209
-                        ESP_LOGI(TAG, "Handshake timeout - immediate reconnect");
-                        should_reconnect = true;
-                        reconnect_delay = 0;
-                        break;
-                    // Потеря сигнала - переподключаемся с небольшой задержкой
-                    case WIFI_REASON_BEACON_TIMEOUT: // 200
-                    case WIFI_REASON_TIMEOUT:        // 39
-                        ESP_LOGI(TAG, "Signal lost - reconnect with delay");
-                        should_reconnect = true;
-                        reconnect_delay = 1000; // 1 секунда
-                        break;
-                    // Роуминг и временные проблемы
-                    case WIFI_REASON_ROAMING:                 // 207
-                    case WIFI_REASON_BSS_TRANSITION_DISASSOC: // 12
-                    case WIFI_REASON_PEER_INITIATED:          // 46
-                    case WIFI_REASON_AP_INITIATED:            // 47
-                    case WIFI_REASON_AP_TSF_RESET:            // 206
-                        ESP_LOGI(TAG, "Temporary disconnection - reconnect with delay");
-                        should_reconnect = true;
-                        reconnect_delay = 1000; // 2 секунды
-                        break;
-                    // Перегрузка AP
-                    case WIFI_REASON_ASSOC_TOOMANY:        // 5
-                    case WIFI_REASON_NOT_ENOUGH_BANDWIDTH: // 33
-                        ESP_LOGI(TAG, "AP overloaded - reconnect with exponential delay");
-                        should_reconnect = true;
-                        reconnect_delay = 2000; // 5 секунд
-                        break;
-                    // Неопределенные причины
-                    case WIFI_REASON_UNSPECIFIED:                // 1
-                    case WIFI_REASON_DISASSOC_DUE_TO_INACTIVITY: // 4
-                    case WIFI_REASON_CONNECTION_FAIL:            // 205
-                    default:
-                        ESP_LOGW(TAG, "Unexpected disconnect reason %d - reconnect with delay", disconn->reason);
-                        should_reconnect = true;
-                        reconnect_delay = 2000; // 3 секунды по умолчанию
-                        break;
-                    }
-                    // Выполняем переподключение если нужно
-                    if (should_reconnect && connect_func)
-                    {
-                        if (reconnect_delay > 0)
-                        {
-                            ESP_LOGI(TAG, "Scheduling reconnect in %lu ms", reconnect_delay);
-                            // ВАЖНО: Захват мьютекса не должен быть активен во время vTaskDelay!
-                            // Поэтому разблокируем его перед задержкой и захватим снова после.
-                            wifi_mutex_unlock();
-                            vTaskDelay(pdMS_TO_TICKS(reconnect_delay));
-                            if (!wifi_mutex_lock(pdMS_TO_TICKS(1000)))
-                            {
-                                ESP_LOGE(TAG, "Failed to re-acquire WiFi mutex after delay for reconnect");
-                                return; // Выходим, если не удалось захватить мьютекс снова
-                            }
-                        }
-                        ESP_LOGI(TAG, "Attempting to reconnect...");
-                        esp_err_t err = connect_func();
-
-                        arg = (void *)&should_reconnect;
-
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "Reconnect failed: %s", esp_err_to_name(err));
-                        }
-                    }
+                    ESP_LOGE(TAG, "Full scan fallback failed: %s", esp_err_to_name(err));
                 }
-                wifi_mutex_unlock();
+            }
+            if (should_reconnect)
+            {
+                arg = (void *)&should_reconnect;
+            }
+            else if (!auto_reconnect_enabled || connect_func == NULL)
+            {
+                ESP_LOGI(TAG, "Auto-reconnect is disabled, not attempting to reconnect.");
             }
             else
             {
-                ESP_LOGW(TAG, "Failed to acquire WiFi mutex in disconnect handler");
+                if (policy == NULL)
+                {
+                    ESP_LOGE(TAG, "Authentication failed - manual intervention required");
+                    connect_func = NULL;
+                    auto_reconnect_enabled = false; // Отключаем на всякий случай
+                }
+                else
+                {
+                    reconnect_schedule(policy);
+                    // Пользовательский обработчик узнаёт, что переподключение уже запланировано
+                    should_reconnect = true;
+                    arg = (void *)&should_reconnect;
+                }
             }
         }
+        reconnect_stats_handler_time(esp_timer_get_time() - handler_start);
     }
     if (user_sta_event_handler)
     {
@@ -772,6 +1194,18 @@ esp_err_t dw_station_connect_with_auto_reconnect(const wifi_sta_config_t *sta_co
         sta_ip_event = NULL;
     }
     // Регистрируем обработчики событий
+    if (loop_probe_event == NULL)
+    {
+        err = esp_event_handler_instance_register(DW_LOOP_PROBE_EVENT,
+                                                  ESP_EVENT_ANY_ID,
+                                                  &loop_probe_handler,
+                                                  NULL,
+                                                  &loop_probe_event);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Failed to register event loop probe: %s", esp_err_to_name(err));
+        }
+    }
     err = esp_event_handler_instance_register(WIFI_EVENT,
                                               ESP_EVENT_ANY_ID,
                                               &dw_sta_event_handler,
@@ -827,6 +1261,9 @@ esp_err_t dw_station_connect_with_auto_reconnect(const wifi_sta_config_t *sta_co
         return ESP_ERR_INVALID_ARG; // Ошибка, если конфигурация не указана и dwnvs не используется
 #endif
     }
+#ifdef DWNVS_STORAGE_H
+    fast_connect_apply(&wifi_config.sta);
+#endif
     err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
     if (err != ESP_OK)
     {
@@ -834,6 +1271,12 @@ esp_err_t dw_station_connect_with_auto_reconnect(const wifi_sta_config_t *sta_co
         result = err;
         goto cleanup;
     }
+    // Новое подключение начинает отсчёт попыток и времени до IP заново
+    connect_started_us = esp_timer_get_time();
+    reconnect_cancel();
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_attempts = 0;
+    portEXIT_CRITICAL(&reconnect_lock);
     // Сохраняем пользовательский обработчик событий
     user_sta_event_handler = event;
     connect_func = &esp_wifi_connect;
@@ -903,6 +1346,7 @@ esp_err_t dw_station_stop(void)
         // Отключаем авто-переподключение
         auto_reconnect_enabled = false;
         connect_func = NULL; // Очищаем функцию подключения
+        reconnect_cancel();
         wifi_mutex_unlock(); // Разблокируем мьютекс перед вызовом esp_wifi_disconnect
         return esp_wifi_disconnect();
     }
@@ -910,6 +1354,55 @@ esp_err_t dw_station_stop(void)
     return ESP_ERR_NOT_FOUND;
 }
 //=================================================================
+// Вставка с дедупликацией по SSID: остаётся самая сильная точка сети,
+// при переполнении вытесняется самая слабая сеть
+static void scan_list_insert(const wifi_ap_record_t *record)
+{
+    if (record->ssid[0] == '\0')
+    {
+        return; // Скрытая сеть
+    }
+    int pos = -1;
+    for (int i = 0; i < scan_count; i++)
+    {
+        if (strncmp(scan_list[i].ssid, (const char *)record->ssid, sizeof(record->ssid)) == 0)
+        {
+            if (scan_list[i].rssi >= record->rssi)
+            {
+                return;
+            }
+            pos = i;
+            break;
+        }
+    }
+    if (pos < 0)
+    {
+        if (scan_count < DW_SCAN_MAX_RESULTS)
+        {
+            pos = scan_count++;
+        }
+        else if (record->rssi > scan_list[scan_count - 1].rssi)
+        {
+            pos = scan_count - 1;
+        }
+        else
+        {
+            return;
+        }
+    }
+    // Поднимаем запись на место по убыванию RSSI
+    while (pos > 0 && scan_list[pos - 1].rssi < record->rssi)
+    {
+        scan_list[pos] = scan_list[pos - 1];
+        pos--;
+    }
+    dw_scan_entry_t *entry = &scan_list[pos];
+    strlcpy(entry->ssid, (const char *)record->ssid, sizeof(entry->ssid));
+    entry->rssi = record->rssi;
+    entry->channel = record->primary;
+    entry->authmode = record->authmode;
+}
+//=================================================================
 static void ds_scan_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE)
@@ -922,27 +1415,18 @@ static void ds_scan_event_handler(void *arg, esp_event_base_t event_base, int32_
             {
                 if (wifi_mutex_lock(pdMS_TO_TICKS(1000)))
                 {
-                    if (ap_list)
-                    {
-                        free(ap_list);
-                        ap_list = NULL;
-                    }
-                    ap_count = 0;
-                    ap_count = scan_done_event->number;
-                    if (ap_count > 0)
+                    // Записи забираем по одной: драйвер освобождает каждую сразу,
+                    // общий массив на все найденные точки не выделяется
+                    wifi_ap_record_t record;
+                    uint16_t raw_count = 0;
+                    scan_count = 0;
+                    while (esp_wifi_scan_get_ap_record(&record) == ESP_OK)
                     {
-                        ap_list = malloc(sizeof(wifi_ap_record_t) * ap_count);
-                        if (ap_list)
-                        {
-                            esp_wifi_scan_get_ap_records(&ap_count, ap_list);
-                            ESP_LOGI(TAG, "Scan done: %d APs found", ap_count);
-                        }
-                        else
-                        {
-                            ESP_LOGE(TAG, "Failed to allocate memory for AP list");
-                            ap_count = 0;
-                        }
+                        raw_count++;
+                        scan_list_insert(&record);
                     }
+                    esp_wifi_clear_ap_list();
+                    ESP_LOGI(TAG, "Scan done: %u APs found, %u unique networks kept", raw_count, scan_count);
                     // СБРОС ФЛАГА СКАНИРОВАНИЯ
                     xEventGroupClearBits(wifi_group, SCAN_IN_PROGRESS_BIT);
                     wifi_mutex_unlock();
@@ -992,12 +1476,7 @@ esp_err_t dw_station_scan_start(esp_event_handler_t event, void *arg)
     // Устанавливаем флаг сканирования
     xEventGroupSetBits(wifi_group, SCAN_IN_PROGRESS_BIT);
     // Подготовка данных внутри критической секции
-    if (ap_list)
-    {
-        free(ap_list);
-        ap_list = NULL;
-        ap_count = 0;
-    }
+    scan_count = 0;
     target_mode = change_wifi_mode(WIFI_MODE_STA, true);
     // Сохраняем обработчики событий
     user_scan_event_handler = saved_user_handler;
@@ -1079,9 +1558,10 @@ esp_err_t dw_station_scan_start(esp_event_handler_t event, void *arg)
     return err;
 }
 //=================================================================
-esp_err_t dw_station_scan_result(uint16_t *out_count, wifi_ap_record_t **out_list)
+esp_err_t dw_station_scan_page(uint16_t offset, dw_scan_entry_t *out_list, uint16_t max_count,
+                               uint16_t *out_count, uint16_t *out_total)
 {
-    if (out_count == NULL)
+    if (out_list == NULL && max_count > 0)
     {
         return ESP_ERR_INVALID_ARG;
     }
@@ -1095,42 +1575,28 @@ esp_err_t dw_station_scan_result(uint16_t *out_count, wifi_ap_record_t **out_lis
     {
         return ESP_ERR_TIMEOUT;
     }
-    esp_err_t result = ESP_OK;
-    if (ap_list == NULL || ap_count == 0)
+    uint16_t count = 0;
+    if (offset < scan_count)
     {
-        *out_count = 0;
-        if (out_list)
-            *out_list = NULL;
-        goto cleanup;
-    }
-    *out_count = ap_count;
-    if (out_list)
-    {
-        size_t size = sizeof(wifi_ap_record_t) * ap_count;
-        wifi_ap_record_t *copy = malloc(size);
-        if (!copy)
+        count = scan_count - offset;
+        if (count > max_count)
         {
-            result = ESP_ERR_NO_MEM;
-            *out_list = NULL;
+            count = max_count;
         }
-        else
+        if (count > 0)
         {
-            memcpy(copy, ap_list, size);
-            *out_list = copy;
+            memcpy(out_list, &scan_list[offset], sizeof(dw_scan_entry_t) * count);
         }
     }
-cleanup:
-    wifi_mutex_unlock();
-    return result;
-}
-//=================================================================
-esp_err_t dw_free_scan_result(wifi_ap_record_t *scan_list)
-{
-    if (scan_list == NULL)
+    if (out_count)
     {
-        return ESP_ERR_INVALID_ARG;
+        *out_count = count;
+    }
+    if (out_total)
+    {
+        *out_total = scan_count;
     }
-    free(scan_list);
+    wifi_mutex_unlock();
     return ESP_OK;
 }
 //=================================================================
@@ -1212,42 +1678,20 @@ esp_err_t dw_set_hostname_to_netif(wifi_interface_t wifi_interface, const char *
 //=================================================================
 esp_err_t dw_check_internet_connection(void)
 {
-    esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    if (!sta_netif)
-    {
-        ESP_LOGE(TAG, "STA netif not found");
-        return ESP_ERR_NOT_FOUND;
-    }
-    esp_netif_ip_info_t ip_info;
-    if (esp_netif_get_ip_info(sta_netif, &ip_info) != ESP_OK || ip_info.ip.addr == 0)
-    {
-        ESP_LOGW(TAG, "No valid IP address assigned");
-        return ESP_ERR_INVALID_STATE;
-    }
-    esp_http_client_config_t config = {
-        .url = INTERNET_CHECK_URL,
-        .method = HTTP_METHOD_GET,
-        .timeout_ms = INTERNET_CHECK_TIMEOUT_MS,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client)
-    {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
-    }
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
-    if (err == ESP_OK && status_code == 204)
-    {
-        ESP_LOGI(TAG, "✅ Internet connection verified");
-        return ESP_OK;
-    }
-    else
+    return dw_internet_status(NULL);
+}
+//=================================================================
+esp_err_t dw_internet_status(uint32_t *age_ms)
+{
+    portENTER_CRITICAL(&internet_lock);
+    esp_err_t result = internet_result;
+    int64_t checked_us = internet_checked_us;
+    portEXIT_CRITICAL(&internet_lock);
+    if (age_ms)
     {
-        ESP_LOGW(TAG, "❌ Internet check failed: HTTP %d, err %s", status_code, esp_err_to_name(err));
-        return ESP_ERR_INVALID_RESPONSE;
+        *age_ms = checked_us ? (uint32_t)((esp_timer_get_time() - checked_us) / 1000) : UINT32_MAX;
     }
+    return result;
 }
 //=================================================================
 bool dw_is_scanning(void)
@@ -1269,6 +1713,7 @@ void dw_station_set_auto_reconnect(bool enable)
         if (!enable)
         {
             connect_func = NULL;
+            reconnect_cancel();
         }
         ESP_LOGI(TAG, "Auto-reconnect %s", enable ? "enabled" : "disabled");
         wifi_mutex_unlock();
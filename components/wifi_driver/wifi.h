@@ -5,11 +5,26 @@
 #include "esp_netif.h"
 #include "esp_err.h"
 
+#ifndef DW_SCAN_MAX_RESULTS
+#define DW_SCAN_MAX_RESULTS 20 // Число хранимых сетей после сканирования
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+    /**
+     * @brief Сеть из результатов сканирования
+     */
+    typedef struct
+    {
+        char ssid[33];
+        int8_t rssi;
+        uint8_t channel;
+        wifi_auth_mode_t authmode;
+    } dw_scan_entry_t;
+
     /**
      * @brief Инициализация Wi-Fi ресурсов
      *
@@ -55,7 +70,12 @@ extern "C"
      * @return esp_err_t ESP_OK при успешном начале подключения, код ошибки в случае неудачи
      *
      * @note Функция автоматически пытается восстановить соединение при разрывах *только если*
-     *       auto_reconnect установлен в true.
+     *       auto_reconnect установлен в true. Попытки планируются таймером esp_timer с
+     *       экспоненциальной задержкой и случайным разбросом, зависящими от причины разрыва;
+     *       при ошибке аутентификации переподключение отключается.
+     * @note Если для сети сохранены данные последнего подключения (dwnvs_fast_connect_t), сначала
+     *       выполняется направленное подключение к известным BSSID и каналу; при неудаче - полное
+     *       сканирование. Время до получения IP выводится в журнал.
      * @note Если sta_config == NULL, используется минимальная конфигурация по умолчанию
      */
     esp_err_t dw_station_connect_with_auto_reconnect(const wifi_sta_config_t *sta_config, esp_event_handler_t event, void *arg, bool auto_reconnect);
@@ -101,7 +121,7 @@ extern "C"
      * @brief Начало сканирования доступных точек доступа
      *
      * Инициирует асинхронное сканирование Wi-Fi сетей в окружающей среде.
-     * Результаты сканирования доступны через dw_station_scan_result().
+     * Результаты сканирования доступны через dw_station_scan_page().
      *
      * @param event Указатель на пользовательский обработчик событий сканирования (может быть NULL)
      * @param arg Аргумент для пользовательского обработчика событий
@@ -112,48 +132,81 @@ extern "C"
     esp_err_t dw_station_scan_start(esp_event_handler_t event, void *arg);
 
     /**
-     * @brief Получение результатов сканирования
+     * @brief Получение страницы результатов сканирования
      *
-     * Копирует результаты последнего сканирования в пользовательский буфер.
-     * Память для результатов выделяется внутри функции и должна быть освобождена
-     * с помощью dw_free_scan_result().
+     * Результаты хранятся без дубликатов по SSID (остаётся самая сильная точка сети),
+     * отсортированы по убыванию RSSI и ограничены DW_SCAN_MAX_RESULTS сетями.
+     * Скрытые сети пропускаются.
      *
-     * @param out_count Указатель для возврата количества найденных точек доступа
-     * @param out_list Указатель для возврата массива записей точек доступа
+     * @param offset Индекс первой сети страницы
+     * @param out_list Буфер для страницы (может быть NULL, если max_count == 0)
+     * @param max_count Размер буфера в записях
+     * @param out_count Указатель для возврата числа скопированных записей (может быть NULL)
+     * @param out_total Указатель для возврата общего числа сетей (может быть NULL)
      * @return esp_err_t ESP_OK при успешном получении результатов, код ошибки в случае неудачи
-     *
-     * @warning Выделенная память должна быть освобождена с помощью dw_free_scan_result()
      */
-    esp_err_t dw_station_scan_result(uint16_t *out_count, wifi_ap_record_t **out_list);
-
-    /**
-     * @brief Освобожение памяти результатов сканирования
-     *
-     * Освобождает память, выделенную функцией dw_station_scan_result().
-     *
-     * @param scan_list Указатель на массив записей точек доступа для освобождения
-     * @return esp_err_t ESP_OK при успешном освобождении, ESP_ERR_INVALID_ARG если указатель NULL
-     */
-    esp_err_t dw_free_scan_result(wifi_ap_record_t *scan_list);
+    esp_err_t dw_station_scan_page(uint16_t offset, dw_scan_entry_t *out_list, uint16_t max_count,
+                                   uint16_t *out_count, uint16_t *out_total);
 
     /**
      * @brief Проверка наличия интернет-соединения
      *
-     * Выполняет HTTP-запрос к публичному серверу для проверки доступности интернета.
-     * Требует, чтобы устройство уже имело валидный IP-адрес в режиме STA.
+     * Возвращает результат последней фоновой проверки без обращения к сети. Проверку выполняет
+     * отдельная задача: HTTP-запрос к публичному серверу по расписанию и после получения IP.
      *
      * @return esp_err_t
      *         - ESP_OK: интернет доступен;
-     *         - ESP_ERR_INVALID_STATE: нет IP-адреса или STA не активен;
+     *         - ESP_ERR_INVALID_STATE: нет IP-адреса, STA не активен или проверки ещё не было;
      *         - ESP_ERR_NOT_FOUND: сетевой интерфейс STA не найден;
      *         - ESP_ERR_INVALID_RESPONSE: сервер недоступен или вернул ошибку;
      *         - другие: ошибки инициализации HTTP-клиента.
      *
-     * @note Функция блокирующая. Не вызывать из обработчиков прерываний или событий.
-     * @note Требует подключения компонента esp_http_client в проекте.
+     * @note Функция не блокирует, её можно вызывать из обработчиков событий и HTTP-сервера.
      */
     esp_err_t dw_check_internet_connection(void);
 
+    /**
+     * @brief Кэшированный результат проверки интернета и его возраст
+     *
+     * @param age_ms Время с последней проверки, мс (UINT32_MAX, если проверки не было). Может быть NULL
+     * @return esp_err_t Результат последней проверки, как у dw_check_internet_connection()
+     */
+    esp_err_t dw_internet_status(uint32_t *age_ms);
+
+    /**
+     * @brief Внеочередная фоновая проверка интернета
+     *
+     * Будит задачу проверки и сразу возвращает управление.
+     */
+    void dw_internet_check_request(void);
+
+    /**
+     * @brief Функция, получающая новый результат проверки интернета
+     *
+     * Вызывается из задачи проверки, когда результат отличается от предыдущего
+     * (например, первая проверка после получения IP). Не должна блокировать надолго.
+     */
+    typedef void (*dw_internet_cb_t)(esp_err_t result);
+
+    /**
+     * @brief Установка функции уведомления о смене результата проверки интернета
+     *
+     * Возвращается после завершения уже начатого вызова прежней функции,
+     * поэтому после dw_set_internet_callback(NULL) её ресурсы можно освобождать.
+     *
+     * @param cb Функция или NULL, чтобы отключить уведомления
+     */
+    void dw_set_internet_callback(dw_internet_cb_t cb);
+
+    /**
+     * @brief Замена адреса проверки интернета
+     *
+     * Сервер должен отвечать кодом 204. Позволяет подставить локальный HTTP-сервер в тестах.
+     *
+     * @param url Адрес проверки (до 127 символов) или NULL для адреса по умолчанию
+     */
+    void dw_set_internet_check_url(const char *url);
+
     /**
      * @brief Очистка всех Wi-Fi ресурсов
      *
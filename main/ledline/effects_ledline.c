@@ -3,15 +3,17 @@
 #include "server/modules/data_parser.h"
 #include "nvs_settings.h"
 #include "esp_err.h"
-
-#define ITEMS_COUNT (3)
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 
 #define LEDLINE_REFRESH (BIT0)
 #define LEDLINE_CLEAR (BIT1)
 
+#define SCENE_VERSION 1
+#define SCENE_SAVE_DELAY_MS 2000 // Тишина после последнего изменения перед записью сцены
+
 static const char *TAG = "Led effects";
 
-QueueHandle_t mqttQueue = NULL;
 static EventGroupHandle_t ledlineEvent = NULL;
 //=================================================================
 typedef bool (*topic_manager_func_t)(void *data);
@@ -27,14 +29,15 @@ static bool color_manager(void *data);
 static bool brightness_manager(void *data);
 static bool mode_manager(void *data);
 static bool pause_manager(void *data);
-
-static topic_manager_t topic_manager[] = {
-    {"state", state_manager},
-    {"color", color_manager},
-    {"brightness", brightness_manager},
-    {"mode", mode_manager},
-    {"pause", pause_manager}};
-static uint8_t topic_manager_count = sizeof(topic_manager) / sizeof(topic_manager_t);
+static bool json_manager(void *data);
+
+static topic_manager_t topic_manager[LEDLINE_COMMAND_COUNT] = {
+    [LEDLINE_COMMAND_STATE] = {"state", state_manager},
+    [LEDLINE_COMMAND_COLOR] = {"color", color_manager},
+    [LEDLINE_COMMAND_BRIGHTNESS] = {"brightness", brightness_manager},
+    [LEDLINE_COMMAND_MODE] = {"mode", mode_manager},
+    [LEDLINE_COMMAND_PAUSE] = {"pause", pause_manager},
+    [LEDLINE_COMMAND_JSON] = {"json", json_manager}};
 //=================================================================
 typedef uint8_t (*effect_manager_func_t)(void);
 
@@ -46,7 +49,6 @@ typedef struct
     const effect_manager_func_t effect_init;
 } effect_manager_t;
 
-static uint8_t static_effect_init(void);
 static uint8_t static_effect(void);
 
 static uint8_t gradient_effect_init(void);
@@ -56,7 +58,7 @@ static uint8_t rainbow_effect_init(void);
 static uint8_t gradient_effect(void);
 
 static effect_manager_t effect_manager[] = {
-    {"static", true, static_effect, static_effect_init},
+    {"static", true, static_effect, NULL},
     {"gradient", true, gradient_effect, gradient_effect_init},
     {"rainbow", true, gradient_effect, rainbow_effect_init}};
 static uint8_t effect_manager_count = sizeof(effect_manager) / sizeof(effect_manager_t);
@@ -74,16 +76,117 @@ hsv_t target_color = {0};
 uint8_t current_brightness = 0;
 uint8_t stored_brightness = 0;
 
+// Сцена целиком хранится одной записью NVS, поля добавляются только с новой версией
+typedef struct __attribute__((packed))
+{
+    uint8_t version;
+    uint8_t state; // 1 - включена
+    uint8_t pause;
+    uint8_t mode; // Индекс в effect_manager
+    uint16_t hue; // Цвет эффекта без яркости
+    uint8_t sat;
+    uint8_t brightness; // Яркость во включённом состоянии
+} scene_t;
+
+static int64_t scene_changed_us = 0; // Время последнего несохранённого изменения, 0 - сохранено
+static bool scene_legacy_keys = false; // Сцена прочитана из ключей color/brightness, их нужно удалить
+static int64_t command_latency_max_us = 0; // Наибольшее время от приёма до применения команды
+
+// Атрибуты, изменённые командами кадра (биты ledline_command_t); публикуются один раз после применения
+static uint32_t state_changed = 0;
+
+#define STATE_CHANGED(command) (1u << (command))
+
 //=================================================================
-static bool state_manager(void *data)
+static void scene_mark_changed(void)
 {
-    if (data == NULL)
-        return true;
+    scene_changed_us = esp_timer_get_time();
+}
 
-    const char *state = (char *)data;
-    mqtt_publish_state("state", state);
+//=================================================================
+// Запись сцены одним blob, вызывается из задачи эффектов после серии изменений
+static void scene_save(void)
+{
+    effect_manager_t *effect = current_effect ? current_effect : stored_effect;
+
+    scene_t scene = {
+        .version = SCENE_VERSION,
+        .state = current_state,
+        .pause = current_pause,
+        .mode = effect ? (uint8_t)(effect - effect_manager) : 0,
+        .hue = target_color.hue,
+        .sat = target_color.sat,
+        .brightness = stored_brightness,
+    };
+
+    esp_err_t err = nvs_save_data("ledline", "scene", &scene, sizeof(scene), NVS_TYPE_BLOB);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to save scene: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Scene saved: %s, mode %s", scene.state ? "enable" : "disable", effect_manager[scene.mode].effect);
 
-    if (strcmp(state, "enable") == 0)
+    // Старые ключи удаляются только после того, как сцена оказалась во flash
+    if (scene_legacy_keys && nvs_settings_flush() == ESP_OK)
+    {
+        nvs_delete_data("ledline", "color");
+        nvs_delete_data("ledline", "brightness");
+        scene_legacy_keys = false;
+        ESP_LOGI(TAG, "Legacy color and brightness keys removed");
+    }
+}
+
+//=================================================================
+// Сцена до появления blob: цвет и яркость лежали отдельными ключами
+static void scene_load_legacy(scene_t *scene)
+{
+    uint32_t color = 0x00A849B3; // RGB_COLOR_DEFAULT()
+    size_t color_size = sizeof(color);
+    nvs_load_data("ledline", "color", &color, &color_size, NVS_TYPE_U32);
+
+    uint8_t brightness = 255;
+    size_t brightness_size = sizeof(brightness);
+    nvs_load_data("ledline", "brightness", &brightness, &brightness_size, NVS_TYPE_U8);
+
+    hsv_t hsv = color_to_hsv(color);
+
+    scene->version = SCENE_VERSION;
+    scene->state = 1; // Без сохранённой сцены лента включается сразу после подачи питания
+    scene->pause = 0;
+    scene->mode = 0;
+    scene->hue = hsv.hue;
+    scene->sat = hsv.sat;
+    scene->brightness = brightness;
+}
+
+//=================================================================
+static void scene_load(scene_t *scene)
+{
+    int64_t start = esp_timer_get_time();
+    size_t size = sizeof(*scene);
+
+    esp_err_t err = nvs_load_data("ledline", "scene", scene, &size, NVS_TYPE_BLOB);
+    if (err != ESP_OK || size != sizeof(*scene) || scene->version != SCENE_VERSION)
+    {
+        ESP_LOGW(TAG, "Scene not found (%s), using color and brightness keys", esp_err_to_name(err));
+        scene_load_legacy(scene);
+        scene_changed_us = esp_timer_get_time(); // Перенос в новый формат при первом сохранении
+        scene_legacy_keys = true;
+    }
+
+    if (scene->mode >= effect_manager_count)
+    {
+        scene->mode = 0;
+    }
+
+    ESP_LOGI(TAG, "Scene loaded in %lld us", esp_timer_get_time() - start);
+}
+
+//=================================================================
+static void scene_set_state(bool enable)
+{
+    if (enable)
     {
         if (current_effect == NULL && stored_effect != NULL)
         {
@@ -100,7 +203,7 @@ static bool state_manager(void *data)
         target_color.val = current_brightness;
         current_state = true;
     }
-    else if (strcmp(state, "disable") == 0)
+    else
     {
         current_brightness = 0;
         target_color.val = 0;
@@ -108,23 +211,21 @@ static bool state_manager(void *data)
     }
 
     ESP_LOGI(TAG, "New state brightness: val - %d", current_brightness);
-
-    return true;
+    state_changed |= STATE_CHANGED(LEDLINE_COMMAND_STATE);
+    scene_mark_changed();
 }
 
 //=================================================================
-static bool color_manager(void *data)
+// Цвет всегда показывается статичным эффектом
+static void scene_set_color(hsv_t color)
 {
-    if (data == NULL)
-        return true;
-
-    mqtt_publish_state("mode", "static");
-
-    const char *color_str = (char *)data;
-    mqtt_publish_state("color", color_str);
+    effect_manager_t *effect = current_effect ? current_effect : stored_effect;
+    if (effect != &effect_manager[0])
+    {
+        state_changed |= STATE_CHANGED(LEDLINE_COMMAND_MODE);
+    }
 
-    uint32_t color_int = color_from_hex(color_str);
-    target_color = color_to_hsv(color_int);
+    target_color = color;
     target_color.val = current_brightness;
 
     if (current_state == true)
@@ -139,48 +240,36 @@ static bool color_manager(void *data)
     ESP_LOGI(TAG, "New current color: HUE - %d, SAT - %d, VOL - %d",
              target_color.hue, target_color.sat, target_color.val);
 
-    nvs_save_data("ledline", "color", (void *)&color_int, sizeof(color_int), NVS_TYPE_U32);
-
-    return true;
+    state_changed |= STATE_CHANGED(LEDLINE_COMMAND_COLOR);
+    scene_mark_changed();
 }
 
 //=================================================================
-static bool brightness_manager(void *data)
+static void scene_set_brightness(uint8_t brightness)
 {
-    if (data == NULL)
-        return true;
-
-    const char *brightness_str = (char *)data;
-    mqtt_publish_state("brightness", brightness_str);
-
-    uint8_t brightness_percent = atoi(brightness_str);
-    current_brightness = (uint8_t)((brightness_percent * 255) / 100);
+    current_brightness = brightness;
     target_color.val = current_brightness;
     stored_brightness = current_brightness;
 
-    ESP_LOGI(TAG, "New brightness: val - %d, percent - %d", current_brightness, brightness_percent);
+    ESP_LOGI(TAG, "New brightness: val - %d", current_brightness);
 
-    nvs_save_data("ledline", "brightness", (void *)&current_brightness, sizeof(current_brightness), NVS_TYPE_U8);
-
-    return true;
+    state_changed |= STATE_CHANGED(LEDLINE_COMMAND_BRIGHTNESS);
+    scene_mark_changed();
 }
 
 //=================================================================
-static bool mode_manager(void *data)
+static bool scene_set_mode(const char *mode_str, size_t len)
 {
-    if (data == NULL)
-        return true;
-
-    const char *mode_str = (char *)data;
-    mqtt_publish_state("mode", mode_str);
-
-    current_pause = false;
-    mqtt_publish_state("pause", "disable");
-
     for (uint8_t m = 0; m < effect_manager_count; m++)
     {
-        if (strcmp(mode_str, effect_manager[m].effect) == 0)
+        if (strlen(effect_manager[m].effect) == len && strncmp(mode_str, effect_manager[m].effect, len) == 0)
         {
+            if (current_pause)
+            {
+                current_pause = false;
+                state_changed |= STATE_CHANGED(LEDLINE_COMMAND_PAUSE);
+            }
+
             if (current_state == true)
             {
                 current_effect = &effect_manager[m];
@@ -196,10 +285,81 @@ static bool mode_manager(void *data)
             }
 
             ESP_LOGI(TAG, "New current mode: %s", effect_manager[m].effect);
-            break;
+            // Эффекты меняют цвет (градиент сдвигает оттенок), публикуется и он
+            state_changed |= STATE_CHANGED(LEDLINE_COMMAND_MODE) | STATE_CHANGED(LEDLINE_COMMAND_COLOR);
+            scene_mark_changed();
+            return true;
         }
     }
 
+    ESP_LOGW(TAG, "Unknown mode: %.*s", (int)len, mode_str);
+    return false;
+}
+
+//=================================================================
+static void scene_set_pause(bool pause)
+{
+    current_pause = pause;
+
+    state_changed |= STATE_CHANGED(LEDLINE_COMMAND_PAUSE);
+    scene_mark_changed();
+}
+
+//=================================================================
+static bool state_manager(void *data)
+{
+    if (data == NULL)
+        return true;
+
+    const char *state = (char *)data;
+
+    if (strcmp(state, "enable") == 0)
+    {
+        scene_set_state(true);
+    }
+    else if (strcmp(state, "disable") == 0)
+    {
+        scene_set_state(false);
+    }
+
+    return true;
+}
+
+//=================================================================
+static bool color_manager(void *data)
+{
+    if (data == NULL)
+        return true;
+
+    const char *color_str = (char *)data;
+    scene_set_color(color_to_hsv(color_from_hex(color_str)));
+
+    return true;
+}
+
+//=================================================================
+static bool brightness_manager(void *data)
+{
+    if (data == NULL)
+        return true;
+
+    const char *brightness_str = (char *)data;
+
+    uint8_t brightness_percent = atoi(brightness_str);
+    scene_set_brightness((uint8_t)((brightness_percent * 255) / 100));
+
+    return true;
+}
+
+//=================================================================
+static bool mode_manager(void *data)
+{
+    if (data == NULL)
+        return true;
+
+    const char *mode_str = (char *)data;
+    scene_set_mode(mode_str, strlen(mode_str));
+
     return true;
 }
 
@@ -210,20 +370,205 @@ static bool pause_manager(void *data)
         return true;
 
     const char *pause_str = (char *)data;
-    mqtt_publish_state("pause", pause_str);
 
     if (strcmp(pause_str, "enable") == 0)
     {
-        current_pause = true;
+        scene_set_pause(true);
     }
     else if (strcmp(pause_str, "disable") == 0)
     {
-        current_pause = false;
+        scene_set_pause(false);
+    }
+
+    return true;
+}
+
+//=================================================================
+// Число из примитива JSON, допускается дробная часть ("h": 300.5)
+static bool json_get_float(const request_t *req, int tok, float *out)
+{
+    char text[16];
+
+    if (tok < 0 || request_is_string(req, tok) || request_is_object(req, tok))
+    {
+        return false;
+    }
+
+    int len = request_token_len(req, tok);
+    if (len <= 0 || len >= sizeof(text))
+    {
+        return false;
+    }
+
+    memcpy(text, request_token_ptr(req, tok), len);
+    text[len] = '\0';
+
+    char *end = NULL;
+    *out = strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+//=================================================================
+// Цвет команды JSON-схемы: {"h": 0-360, "s": 0-100} или {"r", "g", "b"}
+static bool json_get_color(const request_t *req, int tok, hsv_t *color)
+{
+    float h, s;
+    if (json_get_float(req, request_find(req, tok, "h"), &h) &&
+        json_get_float(req, request_find(req, tok, "s"), &s))
+    {
+        if (h < 0 || h > 360 || s < 0 || s > 100)
+        {
+            return false;
+        }
+
+        color->hue = (uint16_t)(h + 0.5f) % 360;
+        color->sat = (uint8_t)(s * 255 / 100 + 0.5f);
+        return true;
+    }
+
+    int r, g, b;
+    if (request_get_int(req, request_find(req, tok, "r"), &r) == ESP_OK &&
+        request_get_int(req, request_find(req, tok, "g"), &g) == ESP_OK &&
+        request_get_int(req, request_find(req, tok, "b"), &b) == ESP_OK &&
+        r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255)
+    {
+        *color = color_to_hsv((r << 16) | (g << 8) | b);
+        return true;
+    }
+
+    return false;
+}
+
+//=================================================================
+// Команда JSON-схемы Home Assistant: все атрибуты одним сообщением
+static bool json_manager(void *data)
+{
+    // Разбор только в задаче команд, токены не занимают её стек
+    static request_t request;
+
+    if (data == NULL)
+        return true;
+
+    const char *json = (char *)data;
+    if (request_parse(&request, json, strlen(json)) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Invalid JSON command: %s", json);
+        return true;
+    }
+
+    int state = request_find(&request, 0, "state");
+    if (request_equals(&request, state, "OFF"))
+    {
+        scene_set_state(false);
+        return true;
+    }
+
+    int color_tok = request_find(&request, 0, "color");
+    if (request_is_object(&request, color_tok))
+    {
+        hsv_t color = {0};
+        if (json_get_color(&request, color_tok, &color))
+        {
+            scene_set_color(color);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Invalid JSON color: %.*s",
+                     request_token_len(&request, color_tok), request_token_ptr(&request, color_tok));
+        }
+    }
+
+    // Эффект после цвета: явно заданный эффект важнее статичного цвета
+    int effect = request_find(&request, 0, "effect");
+    if (request_is_string(&request, effect))
+    {
+        scene_set_mode(request_token_ptr(&request, effect), request_token_len(&request, effect));
+    }
+
+    int brightness = 0;
+    if (request_get_int(&request, request_find(&request, 0, "brightness"), &brightness) == ESP_OK)
+    {
+        scene_set_brightness(brightness < 0 ? 0 : (brightness > 255 ? 255 : brightness));
+    }
+
+    if (request_equals(&request, state, "ON"))
+    {
+        scene_set_state(true);
     }
 
     return true;
 }
 
+//=================================================================
+// Состояние для JSON-схемы Home Assistant (color_mode "hs")
+static void scene_publish_json(void)
+{
+    effect_manager_t *effect = current_effect ? current_effect : stored_effect;
+    char buf[160];
+    json_gen_str_t jstr;
+
+    json_gen_str_start(&jstr, buf, sizeof(buf), NULL, NULL);
+    json_gen_start_object(&jstr);
+    json_gen_obj_set_string(&jstr, "state", current_state ? "ON" : "OFF");
+    json_gen_obj_set_int(&jstr, "brightness", stored_brightness);
+    json_gen_obj_set_string(&jstr, "color_mode", "hs");
+    json_gen_push_object(&jstr, "color");
+    json_gen_obj_set_int(&jstr, "h", target_color.hue);
+    json_gen_obj_set_float(&jstr, "s", target_color.sat * 100.0f / 255);
+    json_gen_pop_object(&jstr);
+    json_gen_obj_set_string(&jstr, "effect", effect ? effect->effect : effect_manager[0].effect);
+    json_gen_end_object(&jstr);
+    json_gen_str_end(&jstr);
+
+    mqtt_publish_state("json", buf);
+}
+
+//=================================================================
+// Публикация изменённых атрибутов: одно сообщение JSON или по топику на атрибут
+static void scene_publish(void)
+{
+    if (state_changed == 0)
+    {
+        return;
+    }
+
+    if (mqtt_ledline_json_enabled())
+    {
+        scene_publish_json();
+        state_changed = 0;
+        return;
+    }
+
+    char text[8];
+    effect_manager_t *effect = current_effect ? current_effect : stored_effect;
+
+    if (state_changed & STATE_CHANGED(LEDLINE_COMMAND_STATE))
+    {
+        mqtt_publish_state("state", current_state ? "enable" : "disable");
+    }
+    if (state_changed & STATE_CHANGED(LEDLINE_COMMAND_COLOR))
+    {
+        hsv_t color = {.hue = target_color.hue, .sat = target_color.sat, .val = 255};
+        snprintf(text, sizeof(text), "#%06lX", color_from_hsv(color) & 0x00FFFFFF);
+        mqtt_publish_state("color", text);
+    }
+    if (state_changed & STATE_CHANGED(LEDLINE_COMMAND_BRIGHTNESS))
+    {
+        snprintf(text, sizeof(text), "%d", (stored_brightness * 100 + 127) / 255);
+        mqtt_publish_state("brightness", text);
+    }
+    if (state_changed & STATE_CHANGED(LEDLINE_COMMAND_MODE))
+    {
+        mqtt_publish_state("mode", effect ? effect->effect : effect_manager[0].effect);
+    }
+    if (state_changed & STATE_CHANGED(LEDLINE_COMMAND_PAUSE))
+    {
+        mqtt_publish_state("pause", current_pause ? "enable" : "disable");
+    }
+
+    state_changed = 0;
+}
+
 //=================================================================
 static void ledstrip_write_buffer(const hsv_t *buffer)
 {
@@ -237,14 +582,7 @@ static void ledstrip_write_buffer(const hsv_t *buffer)
 //=================================================================
 static void task_effect_ledline(void *pvParameters)
 {
-    if (ledlineEvent == NULL)
-    {
-        ledlineEvent = xEventGroupCreate();
-        if (ledlineEvent == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to create portal event status");
-        }
-    }
+    bool first_frame = true;
 
     while (1)
     {
@@ -252,6 +590,11 @@ static void task_effect_ledline(void *pvParameters)
         if (bits & LEDLINE_REFRESH)
         {
             ledstrip_write_buffer(led_buffer);
+            if (first_frame)
+            {
+                first_frame = false;
+                ESP_LOGI(TAG, "First frame at %lld ms since boot", esp_timer_get_time() / 1000);
+            }
         }
         else if (bits & LEDLINE_CLEAR)
         {
@@ -263,72 +606,60 @@ static void task_effect_ledline(void *pvParameters)
 }
 
 //=================================================================
-static void task_mqtt_ledline(void *pvParameters)
+// Счётчики приёма команд и состояние кучи после серии изменений
+static void ingest_log_stats(void)
 {
-    mqtt_data_t data_message = {0};
-    TickType_t xLastWakeTime = 0;
+    mqtt_ingest_stats_t stats;
+    mqtt_ingest_get_stats(&stats);
+
+    ESP_LOGI(TAG, "MQTT ingest: %lu commands, %lu merged, %lu dropped, max latency %lld ms; "
+                  "heap free %u, largest block %u, min free %u",
+             stats.received, stats.merged, stats.dropped, command_latency_max_us / 1000,
+             heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    command_latency_max_us = 0;
+}
 
-    mqttQueue = xQueueCreate(8, sizeof(mqtt_data_t));
-    if (mqttQueue == NULL)
+//=================================================================
+// Последние значения команд применяются один раз за кадр
+static void apply_commands(void)
+{
+    mqtt_command_t commands[LEDLINE_COMMAND_COUNT];
+    uint8_t count = mqtt_command_take_all(commands);
+    if (count == 0)
     {
-        ESP_LOGE(TAG, "Failed to create MQTT queue");
         return;
     }
 
+    for (uint8_t i = 0; i < count; i++)
+    {
+        topic_manager[commands[i].command].manager_func(commands[i].payload);
+    }
+
+    int64_t latency = esp_timer_get_time() - commands[0].received_us;
+    if (latency > command_latency_max_us)
+    {
+        command_latency_max_us = latency;
+    }
+}
+
+//=================================================================
+static void task_mqtt_ledline(void *pvParameters)
+{
+    TickType_t xLastWakeTime = 0;
+
     while (1)
     {
         xLastWakeTime = xTaskGetTickCount();
-        if (xQueueReceive(mqttQueue, &data_message, 5 / portTICK_PERIOD_MS) == pdTRUE)
-        {
-            if (topic_list != NULL && topic_count > 0)
-            {
-                bool func_executed = false;
-                for (uint8_t i = 0; i < topic_count && !func_executed; i++)
-                {
-                    char *items[ITEMS_COUNT] = {0};
-                    uint8_t count = split_string(data_message.topic, items, ITEMS_COUNT, '/');
-
-                    if (count > 0 && items[count - 1] != NULL)
-                    {
-                        for (uint8_t j = 0; j < topic_manager_count && !func_executed; j++)
-                        {
-                            if (topic_manager[j].topic != NULL &&
-                                strcmp(items[count - 1], topic_manager[j].topic) == 0)
-                            {
-                                if (topic_manager[j].manager_func != NULL &&
-                                    data_message.data != NULL &&
-                                    topic_manager[j].manager_func(data_message.data))
-                                {
-                                    free(data_message.data);
-                                    data_message.data = NULL;
-                                }
-
-                                func_executed = true;
-                            }
-                        }
-                    }
-
-                    for (int k = 0; k < ITEMS_COUNT; k++)
-                    {
-                        if (items[k] != NULL)
-                        {
-                            free(items[k]);
-                        }
-                    }
-                }
-
-                if (!func_executed && data_message.data != NULL)
-                {
-                    free(data_message.data);
-                    data_message.data = NULL;
-                }
-            }
 
-            // Освобождение topic, если оно было
-            if (data_message.topic != NULL)
-            {
-                free(data_message.topic);
-            }
+        apply_commands();
+        scene_publish();
+
+        if (scene_changed_us != 0 && esp_timer_get_time() - scene_changed_us > SCENE_SAVE_DELAY_MS * 1000LL)
+        {
+            scene_changed_us = 0;
+            scene_save();
+            ingest_log_stats();
         }
 
         if (current_effect != NULL && current_effect->effect_func != NULL)
@@ -349,7 +680,8 @@ static void task_mqtt_ledline(void *pvParameters)
 void start_effects_ledline(void)
 {
 
-    led_buffer = malloc(sizeof(hsv_t) * leds_num);
+    // Буфер с нуля: сцена плавно проявляется из темноты
+    led_buffer = calloc(leds_num, sizeof(hsv_t));
 
     if (led_buffer == NULL)
     {
@@ -357,53 +689,46 @@ void start_effects_ledline(void)
         return;
     }
 
-    uint32_t read_color = 0;
-    size_t color_size = sizeof(read_color);
-    esp_err_t color_result = nvs_load_data("ledline", "color", &read_color, &color_size, NVS_TYPE_U32);
-
-    if (color_result == ESP_OK)
-    {
-        target_color = color_to_hsv(read_color);
-        ESP_LOGI(TAG, "Color loaded from NVS: 0x%06X", read_color);
-    }
-    else if (color_result == ESP_ERR_NVS_NOT_FOUND)
-    {
-        target_color = color_to_hsv(0x00A849B3); // RGB_COLOR_DEFAULT()
-        ESP_LOGW(TAG, "Color not found in NVS, using default color.");
-    }
-    else
-    {
-        target_color = color_to_hsv(0x00A849B3);
-        ESP_LOGE(TAG, "Failed to load color from NVS: %s", esp_err_to_name(color_result));
-    }
+    scene_t scene;
+    scene_load(&scene);
 
-    uint8_t read_brightness = 0;
-    size_t brightness_size = sizeof(read_brightness);
-    esp_err_t brightness_result = nvs_load_data("ledline", "brightness", &read_brightness, &brightness_size, NVS_TYPE_U8);
+    target_color.hue = scene.hue;
+    target_color.sat = scene.sat;
+    stored_brightness = scene.brightness;
+    current_pause = scene.pause;
 
-    if (brightness_result == ESP_OK)
+    stored_effect = &effect_manager[scene.mode];
+    if (stored_effect->effect_init)
     {
-        stored_brightness = read_brightness;
-        ESP_LOGI(TAG, "Brightness loaded from NVS: %d", stored_brightness);
+        stored_effect->effect_init();
     }
-    else if (brightness_result == ESP_ERR_NVS_NOT_FOUND)
-    {
-        stored_brightness = 255;
-        ESP_LOGW(TAG, "Brightness not found in NVS, using color's value: %d", stored_brightness);
-    }
-    else
+
+    if (scene.state)
     {
-        stored_brightness = 255;
-        ESP_LOGE(TAG, "Failed to load brightness from NVS: %s", esp_err_to_name(brightness_result));
+        current_effect = stored_effect;
+        stored_effect = NULL;
+        current_brightness = stored_brightness;
+        current_state = true;
     }
+    target_color.val = current_brightness;
 
-    ESP_LOGI(TAG, "Initial state: HUE=%d, SAT=%d, VAL=%d",
+    ESP_LOGI(TAG, "Initial state: %s, mode %s, HUE=%d, SAT=%d, VAL=%d",
+             current_state ? "enable" : "disable", (current_effect ? current_effect : stored_effect)->effect,
              target_color.hue, target_color.sat, target_color.val);
 
-    stored_effect = &effect_manager[0];
-
     led_strip_clear(led_strip);
 
+    // Эффект рисуется с первого цикла, группа событий нужна до запуска задач
+    if (ledlineEvent == NULL)
+    {
+        ledlineEvent = xEventGroupCreate();
+        if (ledlineEvent == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create portal event status");
+            return;
+        }
+    }
+
     xTaskCreate(task_effect_ledline, "task_effect_ledline", 4096, NULL, 5, NULL);
 
     xTaskCreate(task_mqtt_ledline, "task_mqtt_ledline", 4096, NULL, 4, NULL);
@@ -426,14 +751,6 @@ static bool fill_buffer_from_target_interpolate(const hsv_t *target)
 }
 
 //=================================================================
-static uint8_t static_effect_init(void)
-{
-    char color_str[16] = {0};
-    snprintf(color_str, sizeof(color_str), "#%06lX", color_from_hsv(target_color) & 0x00FFFFFF);
-    mqtt_publish_state("color", color_str);
-    return 0;
-}
-
 static uint8_t static_effect(void)
 {
     uint8_t delay = 20;
@@ -31,7 +31,6 @@ extern "C"
 
     // Support functions
     uint32_t color_from_hex(const char *hex_str);
-    uint8_t split_string(const char *input, char **output_array, int array_size, char delimiter);
     hsv_t color_to_hsv(uint32_t color);
     uint32_t color_from_hsv(hsv_t hsv);
     bool color_hsv_equal(const hsv_t *a, const hsv_t *b);
@@ -25,50 +25,6 @@ uint32_t color_from_hex(const char *hex_str)
     return color & 0x00FFFFFF;
 }
 
-//=================================================================
-uint8_t split_string(const char *input, char **output_array, int array_size, char delimiter)
-{
-    if (!input || !output_array || array_size <= 0)
-    {
-        return 0;
-    }
-
-    int count = 0;
-    const char *start = input;
-    const char *end = input;
-
-    while (*end && count < array_size)
-    {
-        if (*end == delimiter)
-        {
-            int len = end - start;
-            output_array[count] = malloc(len + 1);
-            if (output_array[count] != NULL)
-            {
-                strncpy(output_array[count], start, len);
-                output_array[count][len] = '\0';
-                count++;
-                start = end + 1;
-            }
-        }
-        end++;
-    }
-
-    if (count < array_size && start < end)
-    {
-        int len = end - start;
-        output_array[count] = malloc(len + 1);
-        if (output_array[count] != NULL)
-        {
-            strncpy(output_array[count], start, len);
-            output_array[count][len] = '\0';
-            count++;
-        }
-    }
-
-    return count;
-}
-
 //=================================================================
 hsv_t color_to_hsv(uint32_t color)
 {
@@ -70,48 +70,12 @@ esp_err_t ledline_resources_init(void)
 {
     ESP_LOGI(TAG, "Initializing LED strip resources...");
 
-    uint32_t lednum = 60;
-    uint32_t ledpin = GPIO_NUM_0;
-
-    char lednum_str[8] = {0};
-    char ledpin_str[8] = {0};
-
-    size_t lednum_size = sizeof(lednum_str);
-    size_t ledpin_size = sizeof(ledpin_str);
-
-    esp_err_t result = nvs_load_data("ledstrip", "lednum", lednum_str, &lednum_size, NVS_TYPE_STR);
-
-    if (result == ESP_OK && lednum_size > 0 && lednum_str[0] != '\0')
-    {
-        int temp_lednum = atoi(lednum_str);
-        if (temp_lednum > 0) {
-            lednum = temp_lednum;
-            ESP_LOGI(TAG, "Loaded LED count from NVS: %d", lednum);
-        } else {
-            ESP_LOGW(TAG, "Invalid LED count loaded from NVS: %s, using default: %d", lednum_str, lednum);
-        }
-    }
-    else
-    {
-        ESP_LOGI(TAG, "Using default LED count: %d", lednum);
-    }
-
-    result = nvs_load_data("ledstrip", "ledpin", ledpin_str, &ledpin_size, NVS_TYPE_STR);
-
-    if (result == ESP_OK && ledpin_size > 0 && ledpin_str[0] != '\0')
-    {
-        int temp_ledpin = atoi(ledpin_str);
-        if (GPIO_IS_VALID_OUTPUT_GPIO(temp_ledpin)) {
-            ledpin = temp_ledpin;
-            ESP_LOGI(TAG, "Loaded LED pin from NVS: %d", ledpin);
-        } else {
-            ESP_LOGW(TAG, "Invalid LED pin loaded from NVS: %s, using default: %d", ledpin_str, ledpin);
-        }
-    }
-    else
-    {
-        ESP_LOGI(TAG, "Using default LED pin: %d", ledpin);
-    }
+    // Значения уже проверены схемой, при отсутствии - значения по умолчанию
+    int32_t lednum = 0;
+    int32_t ledpin = 0;
+    settings_get_int(SETTING_LEDSTRIP_LEDNUM, &lednum);
+    settings_get_int(SETTING_LEDSTRIP_LEDPIN, &ledpin);
+    ESP_LOGI(TAG, "LED count %ld, LED pin %ld", lednum, ledpin);
 
     leds_num = lednum;
 
@@ -119,13 +83,13 @@ esp_err_t ledline_resources_init(void)
     led_strip = ledline_create(leds_num, ledpin);
     if (led_strip == NULL)
     {
-        ESP_LOGE(TAG, "Failed to create LED strip with %d LEDs", lednum);
+        ESP_LOGE(TAG, "Failed to create LED strip with %ld LEDs", lednum);
         return ESP_FAIL;
     }
 
     start_effects_ledline();
 
-    ESP_LOGI(TAG, "LED strip resources initialized successfully with %d LEDs", lednum);
+    ESP_LOGI(TAG, "LED strip resources initialized successfully with %ld LEDs", lednum);
     return ESP_OK;
 }
 //=================================================================
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "esp_err.h"
 #include "mqtt.h"
 #include "nvs_settings.h"
+#include "settings.h"
 #include "driver/gpio.h"
 
 #ifdef __cplusplus
@@ -16,8 +17,6 @@ extern "C"
 {
 #endif
 
-    extern QueueHandle_t mqttQueue;
-
     extern uint32_t leds_num;
     extern led_strip_handle_t led_strip;
     
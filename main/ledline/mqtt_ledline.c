@@ -2,93 +2,211 @@
 #include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
 #include "mqtt_ledline.h"
 #include "effects_ledline.h"
 
-int topic_count = 0;
-char **topic_list = NULL;
+#define TOPIC_SLOTS 16 // Размер хеш-таблицы команд, степень двойки
 
 static char hostname_str[32] = {0};
+static char topic_prefix[48] = {0}; // "<hostname>/ledline/", общая часть всех топиков
+static size_t topic_prefix_len = 0;
 static bool isSubscribed = false;
 static bool initialized = false;
+static bool json_enabled = false;
 
-static const char *default_topics[] = {
-    "ledline/state",
-    "ledline/color",
-    "ledline/brightness",
-    "ledline/mode",
-    "ledline/pause"};
-static const int default_topic_count = 5;
+// Последний уровень топика команды: <hostname>/ledline/<имя>
+static const char *command_names[LEDLINE_COMMAND_COUNT] = {
+    [LEDLINE_COMMAND_STATE] = "state",
+    [LEDLINE_COMMAND_COLOR] = "color",
+    [LEDLINE_COMMAND_BRIGHTNESS] = "brightness",
+    [LEDLINE_COMMAND_MODE] = "mode",
+    [LEDLINE_COMMAND_PAUSE] = "pause",
+    [LEDLINE_COMMAND_JSON] = "json"};
 
 static const char *TAG = "led_strip_mqtt";
 
+// Хеш-таблица имя команды -> команда, строится при подготовке подписки
+typedef struct
+{
+    uint32_t hash;
+    const char *name; // Строка из command_names, NULL - слот свободен
+    ledline_command_t command;
+} topic_slot_t;
+
+static topic_slot_t topic_slots[TOPIC_SLOTS];
+
 mqtt_client_handle_t mqttClient = NULL;
 
+// Почтовые ящики команд: новое значение заменяет ещё не применённое старое
+typedef struct
+{
+    bool pending;
+    uint32_t seq; // Порядок последнего обновления
+    int64_t received_us;
+    char payload[MQTT_COMMAND_PAYLOAD_MAX + 1];
+} command_mailbox_t;
+
+static command_mailbox_t mailboxes[LEDLINE_COMMAND_COUNT];
+static uint32_t mailbox_seq = 0;
+static mqtt_ingest_stats_t ingest_stats = {0};
+static portMUX_TYPE mailbox_lock = portMUX_INITIALIZER_UNLOCKED;
+
 //=================================================================
-static void ledline_set_mqtt_topics(void)
+uint8_t mqtt_command_take_all(mqtt_command_t *commands)
 {
-    if (topic_list != NULL)
+    uint32_t seq[LEDLINE_COMMAND_COUNT];
+    uint8_t count = 0;
+
+    taskENTER_CRITICAL(&mailbox_lock);
+    for (int i = 0; i < LEDLINE_COMMAND_COUNT; i++)
     {
-        for (int i = 0; i < topic_count; i++)
+        command_mailbox_t *mailbox = &mailboxes[i];
+        if (!mailbox->pending)
+        {
+            continue;
+        }
+
+        // Вставка по порядку приёма, сравнение устойчиво к переполнению счётчика
+        uint8_t pos = count;
+        while (pos > 0 && (int32_t)(seq[pos - 1] - mailbox->seq) > 0)
         {
-            free(topic_list[i]);
+            commands[pos] = commands[pos - 1];
+            seq[pos] = seq[pos - 1];
+            pos--;
         }
-        free(topic_list);
-        topic_list = NULL;
+
+        commands[pos].command = (ledline_command_t)i;
+        commands[pos].received_us = mailbox->received_us;
+        memcpy(commands[pos].payload, mailbox->payload, sizeof(commands[pos].payload));
+        seq[pos] = mailbox->seq;
+        mailbox->pending = false;
+        count++;
     }
+    taskEXIT_CRITICAL(&mailbox_lock);
 
-    if (strlen(hostname_str) == 0)
+    return count;
+}
+
+//=================================================================
+void mqtt_ingest_get_stats(mqtt_ingest_stats_t *stats)
+{
+    taskENTER_CRITICAL(&mailbox_lock);
+    *stats = ingest_stats;
+    taskEXIT_CRITICAL(&mailbox_lock);
+}
+
+//=================================================================
+// Кладёт сообщение в ящик команды; вызывается из задачи MQTT-клиента и никогда не ждёт
+static void mqtt_command_ingest(ledline_command_t command, const char *data, int data_len)
+{
+    if (data_len > MQTT_COMMAND_PAYLOAD_MAX)
     {
-        ESP_LOGE(TAG, "Hostname is empty, cannot create topics");
-        topic_count = 0;
+        ESP_LOGW(TAG, "Command payload too long (%d bytes), dropped", data_len);
+        taskENTER_CRITICAL(&mailbox_lock);
+        ingest_stats.dropped++;
+        taskEXIT_CRITICAL(&mailbox_lock);
         return;
     }
 
-    if (default_topic_count <= 0)
+    int64_t now = esp_timer_get_time();
+    command_mailbox_t *mailbox = &mailboxes[command];
+
+    taskENTER_CRITICAL(&mailbox_lock);
+    if (mailbox->pending)
     {
-        topic_count = 0;
-        return;
+        ingest_stats.merged++;
     }
+    memcpy(mailbox->payload, data, data_len);
+    mailbox->payload[data_len] = '\0';
+    mailbox->seq = ++mailbox_seq;
+    mailbox->received_us = now;
+    mailbox->pending = true;
+    ingest_stats.received++;
+    taskEXIT_CRITICAL(&mailbox_lock);
+}
 
-    topic_list = malloc(default_topic_count * sizeof(char *));
-    if (topic_list == NULL)
+//=================================================================
+// FNV-1a hash
+static uint32_t topic_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
     {
-        ESP_LOGE(TAG, "Failed to allocate memory for topic list");
-        topic_count = 0;
-        return;
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
     }
+    return hash;
+}
 
-    memset(topic_list, 0, default_topic_count * sizeof(char *));
+//=================================================================
+static void topic_slots_init(void)
+{
+    memset(topic_slots, 0, sizeof(topic_slots));
 
-    topic_count = default_topic_count;
-    for (int i = 0; i < default_topic_count; i++)
+    for (int i = 0; i < LEDLINE_COMMAND_COUNT; i++)
     {
-        if (default_topics[i] == NULL)
+        if (i == LEDLINE_COMMAND_JSON && !json_enabled)
         {
-            free(topic_list[i]);
-            topic_list[i] = NULL;
             continue;
         }
 
-        int full_topic_len = strlen(hostname_str) + strlen(default_topics[i]) + 2; // +1 для '/' +1 для '\0'
-        topic_list[i] = malloc(full_topic_len);
-        if (topic_list[i] != NULL)
-        {
-            int ret = snprintf(topic_list[i], full_topic_len, "%s/%s", hostname_str, default_topics[i]);
-            if (ret < 0 || ret >= full_topic_len)
-            {
-                ESP_LOGE(TAG, "Topic string construction failed for topic %d", i);
-                free(topic_list[i]);
-                topic_list[i] = NULL;
-                continue;
-            }
-            ESP_LOGI(TAG, "Topic %d: %s", i, topic_list[i]);
-        }
-        else
+        uint32_t hash = topic_hash(command_names[i], strlen(command_names[i]));
+        size_t slot = hash & (TOPIC_SLOTS - 1);
+
+        while (topic_slots[slot].name != NULL)
+            slot = (slot + 1) & (TOPIC_SLOTS - 1);
+
+        topic_slots[slot].hash = hash;
+        topic_slots[slot].name = command_names[i];
+        topic_slots[slot].command = (ledline_command_t)i;
+    }
+}
+
+//=================================================================
+// Команда по последнему уровню топика (без терминатора)
+static bool topic_lookup(const char *name, size_t len, ledline_command_t *command)
+{
+    uint32_t hash = topic_hash(name, len);
+    size_t slot = hash & (TOPIC_SLOTS - 1);
+
+    while (topic_slots[slot].name != NULL)
+    {
+        if (topic_slots[slot].hash == hash &&
+            strlen(topic_slots[slot].name) == len &&
+            memcmp(topic_slots[slot].name, name, len) == 0)
         {
-            ESP_LOGE(TAG, "Failed to allocate memory for topic %d", i);
+            *command = topic_slots[slot].command;
+            return true;
         }
+        slot = (slot + 1) & (TOPIC_SLOTS - 1);
+    }
+
+    return false;
+}
+
+//=================================================================
+static esp_err_t ledline_set_mqtt_topics(void)
+{
+    if (strlen(hostname_str) == 0)
+    {
+        ESP_LOGE(TAG, "Hostname is empty, cannot create topics");
+        return ESP_ERR_INVALID_STATE;
     }
+
+    int ret = snprintf(topic_prefix, sizeof(topic_prefix), "%s/ledline/", hostname_str);
+    if (ret < 0 || ret >= sizeof(topic_prefix))
+    {
+        ESP_LOGE(TAG, "Topic string construction failed");
+        topic_prefix[0] = '\0';
+        topic_prefix_len = 0;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    topic_prefix_len = ret;
+
+    topic_slots_init();
+    ESP_LOGI(TAG, "Command topics: %s+%s", topic_prefix, json_enabled ? ", JSON schema enabled" : "");
+    return ESP_OK;
 }
 
 //=================================================================
@@ -101,23 +219,20 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     {
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "MQTT Connected");
-        if (!isSubscribed && topic_list != NULL && topic_count > 0)
+        if (!isSubscribed && topic_prefix_len > 0)
         {
-            for (int i = 0; i < topic_count; i++)
+            // Одна подписка на все команды; топики состояния "<имя>/status" под "+" не попадают
+            char topic[sizeof(topic_prefix) + 1];
+            snprintf(topic, sizeof(topic), "%s+", topic_prefix);
+
+            esp_err_t err = mqtt_client_subscribe(client, topic, 0);
+            if (err != ESP_OK)
             {
-                if (topic_list[i] != NULL)
-                {
-                    esp_err_t err = mqtt_client_subscribe(client, topic_list[i], 0);
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "Failed to subscribe to topic %s, error: %s",
-                                 topic_list[i], esp_err_to_name(err));
-                    }
-                    else
-                    {
-                        ESP_LOGI(TAG, "Subscribed to topic: %s", topic_list[i]);
-                    }
-                }
+                ESP_LOGE(TAG, "Failed to subscribe to topic %s, error: %s", topic, esp_err_to_name(err));
+            }
+            else
+            {
+                ESP_LOGI(TAG, "Subscribed to topic: %s", topic);
             }
             isSubscribed = true;
         }
@@ -129,50 +244,14 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         break;
 
     case MQTT_EVENT_DATA:
-        if (event->topic != NULL && event->data != NULL)
+        if (event->topic != NULL && event->data != NULL &&
+            event->topic_len > topic_prefix_len &&
+            memcmp(event->topic, topic_prefix, topic_prefix_len) == 0)
         {
-            for (int i = 0; i < topic_count; i++)
+            ledline_command_t command;
+            if (topic_lookup(event->topic + topic_prefix_len, event->topic_len - topic_prefix_len, &command))
             {
-                if (topic_list[i] != NULL &&
-                    event->topic_len == strlen(topic_list[i]) &&
-                    strncmp(event->topic, topic_list[i], event->topic_len) == 0)
-                {
-                    mqtt_data_t data_message = {0};
-                    bool cleanup_needed = false;
-
-                    data_message.data = strndup(event->data, event->data_len);
-                    if (data_message.data == NULL)
-                    {
-                        ESP_LOGE(TAG, "Failed to allocate memory for data");
-                        cleanup_needed = true;
-                        goto cleanup;
-                    }
-
-                    data_message.topic = strndup(event->topic, event->topic_len);
-                    if (data_message.topic == NULL)
-                    {
-                        ESP_LOGE(TAG, "Failed to allocate memory for topic");
-                        cleanup_needed = true;
-                        goto cleanup;
-                    }
-
-                    BaseType_t result = xQueueSend(mqttQueue, &data_message, 50 / portTICK_PERIOD_MS);
-                    if (result != pdTRUE)
-                    {
-                        ESP_LOGW(TAG, "Failed to send message to queue, queue full");
-                        cleanup_needed = true;
-                        goto cleanup;
-                    }
-                    break;
-
-                cleanup:
-                    if (cleanup_needed)
-                    {
-                        free(data_message.data);
-                        free(data_message.topic);
-                    }
-                    break;
-                }
+                mqtt_command_ingest(command, event->data, event->data_len);
             }
         }
         break;
@@ -208,141 +287,99 @@ esp_err_t mqtt_ledline_resources_init(void)
         return ESP_ERR_INVALID_STATE;
     }
 
-    char enable_str[16] = {0};
-    size_t str_size = sizeof(enable_str);
-    esp_err_t result = nvs_load_data("mqtt", "enable", enable_str, &str_size, NVS_TYPE_STR);
-
-    if (result == ESP_OK)
+    if (!settings_get_bool(SETTING_MQTT_ENABLE))
     {
-        if (strcmp(enable_str, "true") == 0)
-        {
-            ESP_LOGI(TAG, "MQTT is enabled. Loading MQTT configuration...");
-
-            char server_str[64] = {0};
-            char port_str[8] = {0};
-            char user_str[32] = {0};
-            char password_str[64] = {0};
-            char temp_hostname_str[32] = {0};
-
-            str_size = sizeof(server_str);
-            esp_err_t server_result = nvs_load_data("mqtt", "server", server_str, &str_size, NVS_TYPE_STR);
-            if (server_result != ESP_OK || strlen(server_str) == 0)
-            {
-                ESP_LOGE(TAG, "Failed to load MQTT server from NVS: %s", esp_err_to_name(server_result));
-                return server_result != ESP_OK ? server_result : ESP_ERR_INVALID_ARG;
-            }
-            ESP_LOGI(TAG, "Loaded MQTT server: %s", server_str);
+        ESP_LOGI(TAG, "MQTT is disabled");
+        return ESP_OK;
+    }
 
-            str_size = sizeof(port_str);
-            esp_err_t port_result = nvs_load_data("mqtt", "port", port_str, &str_size, NVS_TYPE_STR);
-            if (port_result != ESP_OK || strlen(port_str) == 0)
-            {
-                ESP_LOGE(TAG, "Failed to load MQTT port from NVS: %s", esp_err_to_name(port_result));
-                return port_result != ESP_OK ? port_result : ESP_ERR_INVALID_ARG;
-            }
+    ESP_LOGI(TAG, "MQTT is enabled. Loading MQTT configuration...");
 
-            int port = atoi(port_str);
-            if (port <= 0 || port > 65535)
-            {
-                ESP_LOGE(TAG, "Invalid MQTT port: %s", port_str);
-                return ESP_ERR_INVALID_ARG;
-            }
-            ESP_LOGI(TAG, "Loaded MQTT port: %s", port_str);
+    char server_str[64] = {0};
+    char user_str[32] = {0};
+    char password_str[64] = {0};
+    char temp_hostname_str[32] = {0};
 
-            str_size = sizeof(user_str);
-            esp_err_t user_result = nvs_load_data("mqtt", "user", user_str, &str_size, NVS_TYPE_STR);
-            if (user_result != ESP_OK || strlen(user_str) == 0)
-            {
-                ESP_LOGE(TAG, "Failed to load MQTT user from NVS: %s", esp_err_to_name(user_result));
-                return user_result != ESP_OK ? user_result : ESP_ERR_INVALID_ARG;
-            }
+    esp_err_t server_result = settings_get_str(SETTING_MQTT_SERVER, server_str, sizeof(server_str));
+    if (server_result != ESP_OK || strlen(server_str) == 0)
+    {
+        ESP_LOGE(TAG, "Failed to load MQTT server from NVS: %s", esp_err_to_name(server_result));
+        return server_result != ESP_OK ? server_result : ESP_ERR_INVALID_ARG;
+    }
+    ESP_LOGI(TAG, "Loaded MQTT server: %s", server_str);
 
-            str_size = sizeof(password_str);
-            esp_err_t pass_result = nvs_load_data("mqtt", "password", password_str, &str_size, NVS_TYPE_STR);
-            if (pass_result != ESP_OK || strlen(password_str) == 0)
-            {
-                ESP_LOGE(TAG, "Failed to load MQTT password from NVS: %s", esp_err_to_name(pass_result));
-                return pass_result != ESP_OK ? pass_result : ESP_ERR_INVALID_ARG;
-            }
+    // Порт проверен схемой при сохранении, без значения - порт по умолчанию
+    int32_t port = 0;
+    settings_get_int(SETTING_MQTT_PORT, &port);
+    ESP_LOGI(TAG, "Loaded MQTT port: %ld", port);
 
-            str_size = sizeof(temp_hostname_str);
-            esp_err_t hostname_result = nvs_load_data("device", "hostname", temp_hostname_str, &str_size, NVS_TYPE_STR);
-            if (hostname_result != ESP_OK || strlen(temp_hostname_str) == 0)
-            {
-                ESP_LOGW(TAG, "Failed to load hostname from NVS: %s, using default",
-                         esp_err_to_name(hostname_result));
-                strncpy(temp_hostname_str, "esp32device", sizeof(temp_hostname_str) - 1);
-            }
-            else
-            {
-                ESP_LOGI(TAG, "Loaded hostname: %s", temp_hostname_str);
-            }
-
-            if (strlen(temp_hostname_str) == 0)
-            {
-                ESP_LOGE(TAG, "Hostname is empty, cannot proceed");
-                return ESP_ERR_INVALID_ARG;
-            }
+    esp_err_t user_result = settings_get_str(SETTING_MQTT_USER, user_str, sizeof(user_str));
+    if (user_result != ESP_OK || strlen(user_str) == 0)
+    {
+        ESP_LOGE(TAG, "Failed to load MQTT user from NVS: %s", esp_err_to_name(user_result));
+        return user_result != ESP_OK ? user_result : ESP_ERR_INVALID_ARG;
+    }
 
-            // Усечение hostname с предупреждением
-            if (strlen(temp_hostname_str) >= sizeof(hostname_str))
-            {
-                ESP_LOGW(TAG, "Hostname truncated from %d to %d chars", (int)strlen(temp_hostname_str), (int)(sizeof(hostname_str) - 1));
-            }
-            strncpy(hostname_str, temp_hostname_str, sizeof(hostname_str) - 1);
-            hostname_str[sizeof(hostname_str) - 1] = '\0';
+    esp_err_t pass_result = settings_get_str(SETTING_MQTT_PASSWORD, password_str, sizeof(password_str));
+    if (pass_result != ESP_OK || strlen(password_str) == 0)
+    {
+        ESP_LOGE(TAG, "Failed to load MQTT password from NVS: %s", esp_err_to_name(pass_result));
+        return pass_result != ESP_OK ? pass_result : ESP_ERR_INVALID_ARG;
+    }
 
-            char mqtt_uri[128] = {0};
-            int ret = snprintf(mqtt_uri, sizeof(mqtt_uri), "mqtt://%s:%s", server_str, port_str);
-            if (ret < 0 || ret >= sizeof(mqtt_uri))
-            {
-                ESP_LOGE(TAG, "MQTT URI buffer overflow");
-                return ESP_ERR_INVALID_ARG;
-            }
+    esp_err_t hostname_result = settings_get_str(SETTING_DEVICE_HOSTNAME, temp_hostname_str, sizeof(temp_hostname_str));
+    if (hostname_result != ESP_OK || strlen(temp_hostname_str) == 0)
+    {
+        ESP_LOGW(TAG, "Failed to load hostname from NVS: %s, using default",
+                 esp_err_to_name(hostname_result));
+        strncpy(temp_hostname_str, "esp32device", sizeof(temp_hostname_str) - 1);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Loaded hostname: %s", temp_hostname_str);
+    }
 
-            mqtt_config_t mqtt_config = {
-                .server_uri = mqtt_uri,
-                .client_id = hostname_str,
-                .username = user_str,
-                .password = password_str,
-                .auto_reconnect = true,
-            };
+    // Усечение hostname с предупреждением
+    if (strlen(temp_hostname_str) >= sizeof(hostname_str))
+    {
+        ESP_LOGW(TAG, "Hostname truncated from %d to %d chars", (int)strlen(temp_hostname_str), (int)(sizeof(hostname_str) - 1));
+    }
+    strncpy(hostname_str, temp_hostname_str, sizeof(hostname_str) - 1);
+    hostname_str[sizeof(hostname_str) - 1] = '\0';
 
-            ledline_set_mqtt_topics();
+    char mqtt_uri[128] = {0};
+    int ret = snprintf(mqtt_uri, sizeof(mqtt_uri), "mqtt://%s:%ld", server_str, port);
+    if (ret < 0 || ret >= sizeof(mqtt_uri))
+    {
+        ESP_LOGE(TAG, "MQTT URI buffer overflow");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-            if (topic_count == 0 || topic_list == NULL)
-            {
-                ESP_LOGE(TAG, "Failed to create MQTT topics");
-                vQueueDelete(mqttQueue);
-                mqttQueue = NULL;
-                return ESP_FAIL;
-            }
+    mqtt_config_t mqtt_config = {
+        .server_uri = mqtt_uri,
+        .client_id = hostname_str,
+        .username = user_str,
+        .password = password_str,
+        .auto_reconnect = true,
+    };
 
-            mqttClient = mqtt_client_start(&mqtt_config, mqtt_event_handler);
-            if (mqttClient == NULL)
-            {
-                ESP_LOGE(TAG, "Failed to start MQTT client");
-                vQueueDelete(mqttQueue);
-                mqttQueue = NULL;
-                return ESP_FAIL;
-            }
+    json_enabled = settings_get_bool(SETTING_MQTT_JSON);
 
-            initialized = true;
-            ESP_LOGI(TAG, "MQTT configuration loaded successfully");
-            return ESP_OK;
-        }
-        else
-        {
-            ESP_LOGI(TAG, "MQTT is disabled");
-            return ESP_OK;
-        }
+    if (ledline_set_mqtt_topics() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create MQTT topics");
+        return ESP_FAIL;
     }
-    else
+
+    mqttClient = mqtt_client_start(&mqtt_config, mqtt_event_handler);
+    if (mqttClient == NULL)
     {
-        ESP_LOGI(TAG, "MQTT configuration not found in NVS");
-        return ESP_OK;
+        ESP_LOGE(TAG, "Failed to start MQTT client");
+        return ESP_FAIL;
     }
 
+    initialized = true;
+    ESP_LOGI(TAG, "MQTT configuration loaded successfully");
     return ESP_OK;
 }
 
@@ -360,22 +397,22 @@ void mqtt_ledline_resources_deinit(void)
         mqttClient = NULL;
     }
 
-    if (topic_list != NULL)
-    {
-        for (int i = 0; i < topic_count; i++)
-        {
-            free(topic_list[i]);
-        }
-        free(topic_list);
-        topic_list = NULL;
-        topic_count = 0;
-    }
+    memset(topic_slots, 0, sizeof(topic_slots));
+    memset(topic_prefix, 0, sizeof(topic_prefix));
+    topic_prefix_len = 0;
+    json_enabled = false;
 
     isSubscribed = false;
     memset(hostname_str, 0, sizeof(hostname_str));
     initialized = false;
 }
 
+//=================================================================
+bool mqtt_ledline_json_enabled(void)
+{
+    return json_enabled;
+}
+
 //=================================================================
 esp_err_t mqtt_publish_state(const char *topic_suffix, const char *payload)
 {
@@ -384,35 +421,18 @@ esp_err_t mqtt_publish_state(const char *topic_suffix, const char *payload)
         return ESP_ERR_INVALID_STATE;
     }
 
-    bool is_valid_topic = false;
-    for (int i = 0; i < default_topic_count; i++)
-    {
-        if (strcmp(default_topics[i] + strlen("ledline/"), topic_suffix) == 0)
-        {
-            is_valid_topic = true;
-            break;
-        }
-    }
-
-    if (!is_valid_topic)
+    ledline_command_t command;
+    if (!topic_lookup(topic_suffix, strlen(topic_suffix), &command))
     {
         ESP_LOGW(TAG, "Invalid topic suffix: %s", topic_suffix);
         return ESP_ERR_INVALID_ARG;
     }
 
-    int full_topic_len = strlen(hostname_str) + strlen("ledline/") + strlen(topic_suffix) + strlen("/status") + 2; // '/' + '\0'
-    char *full_topic = malloc(full_topic_len);
-    if (full_topic == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to allocate memory for full topic");
-        return ESP_ERR_NO_MEM;
-    }
-
-    int ret = snprintf(full_topic, full_topic_len, "%s/ledline/%s/status", hostname_str, topic_suffix);
-    if (ret < 0 || ret >= full_topic_len)
+    char full_topic[sizeof(topic_prefix) + 20];
+    int ret = snprintf(full_topic, sizeof(full_topic), "%s%s/status", topic_prefix, topic_suffix);
+    if (ret < 0 || ret >= sizeof(full_topic))
     {
         ESP_LOGE(TAG, "Topic string construction failed");
-        free(full_topic);
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -421,11 +441,9 @@ esp_err_t mqtt_publish_state(const char *topic_suffix, const char *payload)
     if (msg_id < 0)
     {
         ESP_LOGE(TAG, "Failed to publish to topic: %s", full_topic);
-        free(full_topic);
         return ESP_FAIL;
     }
 
     ESP_LOGI(TAG, "Published to topic: %s, payload: %s", full_topic, payload);
-    free(full_topic);
     return ESP_OK;
-}
\ No newline at end of file
+}
@@ -12,22 +12,70 @@
 #include "driver/gpio.h"
 #include "ledline.h"
 
+// Длина самой длинной допустимой команды (JSON-схема Home Assistant), более длинные сообщения отбрасываются
+#ifndef MQTT_COMMAND_PAYLOAD_MAX
+#define MQTT_COMMAND_PAYLOAD_MAX 127
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+    // Команды ленты, топик команды - <hostname>/ledline/<имя>
+    typedef enum
+    {
+        LEDLINE_COMMAND_STATE,
+        LEDLINE_COMMAND_COLOR,
+        LEDLINE_COMMAND_BRIGHTNESS,
+        LEDLINE_COMMAND_MODE,
+        LEDLINE_COMMAND_PAUSE,
+        LEDLINE_COMMAND_JSON, // Все атрибуты одним сообщением, схема JSON Home Assistant
+        LEDLINE_COMMAND_COUNT
+    } ledline_command_t;
+
+    // Последнее значение команды, забранное из почтового ящика
+    typedef struct
+    {
+        ledline_command_t command;
+        int64_t received_us; // Время приёма, esp_timer_get_time()
+        char payload[MQTT_COMMAND_PAYLOAD_MAX + 1];
+    } mqtt_command_t;
+
+    // Счётчики приёма команд
     typedef struct
     {
-        char *topic;
-        void *data;
-    } mqtt_data_t;
+        uint32_t received; // Принято сообщений
+        uint32_t merged;   // Заменили ещё не применённое значение той же команды
+        uint32_t dropped;  // Длиннее MQTT_COMMAND_PAYLOAD_MAX
+    } mqtt_ingest_stats_t;
+
+    /**
+     * @brief Забирает все ожидающие команды, по одной на каждый ящик
+     *
+     * Новое сообщение команды заменяет непримененное старое, поэтому за один кадр
+     * применяется не больше LEDLINE_COMMAND_COUNT команд. Команды упорядочены
+     * по времени приёма.
+     *
+     * @param commands Массив на LEDLINE_COMMAND_COUNT элементов
+     * @return uint8_t Число команд
+     */
+    uint8_t mqtt_command_take_all(mqtt_command_t *commands);
+
+    void mqtt_ingest_get_stats(mqtt_ingest_stats_t *stats);
 
-    extern int topic_count;
-    extern char **topic_list;
-    
     esp_err_t mqtt_ledline_resources_init(void);
+
+    /**
+     * @brief Публикация состояния в <hostname>/ledline/<topic_suffix>/status
+     *
+     * @param topic_suffix Имя команды; "json" - только при включенной JSON-схеме
+     */
     esp_err_t mqtt_publish_state(const char *topic_suffix, const char *payload);
+
+    // Включен ли топик JSON-схемы (настройка mqtt/json); состояние тогда публикуется только в нем
+    bool mqtt_ledline_json_enabled(void);
+
     void mqtt_ledline_resources_deinit(void);
 
 #ifdef __cplusplus
@@ -20,8 +20,7 @@ static void sta_event_handler(void *arg, esp_event_base_t event_base, int32_t ev
     if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
     {
         char hostname[32] = {0};
-        size_t hostname_len = sizeof(hostname);
-        if (nvs_load_data("device", "hostname", hostname, &hostname_len, NVS_TYPE_STR) == ESP_OK)
+        if (settings_get_str(SETTING_DEVICE_HOSTNAME, hostname, sizeof(hostname)) == ESP_OK)
         {
             dw_set_hostname_to_netif(WIFI_IF_STA, hostname);
         }
@@ -68,6 +67,21 @@ static esp_err_t sta_connect_attempt(void)
 }
 
 //================================================================
+// Сбрасывает счётчик включений, если устройство проработало дольше порога
+static void task_boot_reset_clear(void *pvParameters)
+{
+    vTaskDelay(pdMS_TO_TICKS(BOOT_RESET_THRESHOLD_MS));
+
+    int reset_count = 0;
+    nvs_save_data("boot", "reset_count", &reset_count, sizeof(reset_count), NVS_TYPE_I32);
+    nvs_settings_flush();
+    ESP_LOGI(TAG, "Reset counter cleared at %lld ms", esp_timer_get_time() / 1000);
+
+    vTaskDelete(NULL);
+}
+
+//================================================================
+// Решение принимается сразу по сохранённому счётчику, ожидание порога идёт в фоне
 static bool check_factory_reset_mode()
 {
     int reset_count = 0;
@@ -83,17 +97,20 @@ static bool check_factory_reset_mode()
         ESP_LOGI(TAG, "Factory reset mode triggered!");
         reset_count = 0;
         nvs_save_data("boot", "reset_count", &reset_count, sizeof(reset_count), NVS_TYPE_I32);
+        nvs_settings_flush();
         return true;
     }
 
     reset_count++;
 
+    // Счётчик должен попасть во flash до следующего отключения питания
     nvs_save_data("boot", "reset_count", &reset_count, sizeof(reset_count), NVS_TYPE_I32);
+    nvs_settings_flush();
 
-    vTaskDelay(pdMS_TO_TICKS(BOOT_RESET_THRESHOLD_MS));
-
-    reset_count = 0;
-    nvs_save_data("boot", "reset_count", &reset_count, sizeof(reset_count), NVS_TYPE_I32);
+    if (xTaskCreate(task_boot_reset_clear, "boot_reset", 3072, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create reset counter task");
+    }
 
     return false;
 }
@@ -101,17 +118,33 @@ static bool check_factory_reset_mode()
 //================================================================
 void app_main(void)
 {
+    int64_t boot_start = esp_timer_get_time();
+
     nvs_storage_initialization();
+    int64_t boot_nvs = esp_timer_get_time();
+
+    // Свет восстанавливается до сети: сцена из NVS отрисовывается сразу
+    ledline_resources_init();
+    int64_t boot_leds = esp_timer_get_time();
 
     bool forced_launch = check_factory_reset_mode();
+    int64_t boot_reset = esp_timer_get_time();
 
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    ledline_resources_init();
     portal_start_with_sta_attempt("Ledline_config", "", forced_launch, sta_connect_attempt);
+    int64_t boot_portal = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "Boot phases (ms since start): app_main %lld, nvs %lld, leds %lld, reset check %lld, network %lld",
+             boot_start / 1000, boot_nvs / 1000, boot_leds / 1000, boot_reset / 1000, boot_portal / 1000);
+
+    nvs_settings_stats_t nvs_stats;
+    nvs_settings_get_stats(&nvs_stats);
+    ESP_LOGI(TAG, "Boot NVS reads: %lu, from cache %lu, namespaces loaded %lu, flash read time %lu us",
+             nvs_stats.reads, nvs_stats.hits, nvs_stats.namespace_loads, nvs_stats.read_us);
 
     while (1)
     {
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
-}
\ No newline at end of file
+}